@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace audio_tools {
+
+/**
+ * @brief Lightweight counter of the heap allocations which are done by the
+ * audio-tools containers (Vector, StrExt and the buffers). It can be used on
+ * the device to verify that a pipeline does not allocate any memory after
+ * the setup:
+ *
+ * AllocationCounter::reset();
+ * copier.copy();
+ * assert(AllocationCounter::allocations() == 0);
+ *
+ * The counters are not atomic: if multiple tasks are allocating at the same
+ * time the values are only approximate.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocationCounter {
+ public:
+  /// Records an allocation of the indicated number of bytes
+  static void recordAllocation(size_t bytes) {
+    Counters &c = counters();
+    c.allocations = c.allocations + 1;
+    c.bytes = c.bytes + bytes;
+  }
+
+  /// Number of allocations since the last reset
+  static uint32_t allocations() { return counters().allocations; }
+
+  /// Total number of allocated bytes since the last reset
+  static size_t bytes() { return counters().bytes; }
+
+  static void reset() {
+    Counters &c = counters();
+    c.allocations = 0;
+    c.bytes = 0;
+  }
+
+ protected:
+  struct Counters {
+    volatile uint32_t allocations = 0;
+    volatile size_t bytes = 0;
+  };
+
+  static Counters &counters() {
+    static Counters result;
+    return result;
+  }
+};
+
+}  // namespace audio_tools
@@ -21,7 +21,7 @@ class int24_t  {
   }
 
   int24_t(void *ptr) {
-      memcpy(value, ptr, 4);
+      memcpy(value, ptr, 3);
   }
 
   int24_t(const int16_t &in) {
@@ -68,7 +68,7 @@ class int24_t  {
 
   /// Standard Conversion to Int
   int toInt() const {
-    int newInt = (((0xFF & value[0]) << 16) | ((0xFF & value[1]) << 8) | (0xFF & value[2]));
+    int newInt = (((0xFF & value[2]) << 16) | ((0xFF & value[1]) << 8) | (0xFF & value[0]));
     if ((newInt & 0x00800000) > 0) {
       newInt |= 0xFF000000;
     } else {
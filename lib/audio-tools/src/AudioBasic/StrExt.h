@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AudioBasic/Str.h"
+#include "AudioBasic/AllocationCounter.h"
 
 namespace audio_tools {
 
@@ -113,12 +114,14 @@ class StrExt : public Str {
                 if (chars!=nullptr){
                     char* tmp = chars;
                     chars = new char[newSize+1];
+                    AllocationCounter::recordAllocation(newSize+1);
                     if (chars!=nullptr){
                         strcpy(chars,tmp);
                     }
                     delete [] tmp;
                 } else {
                     chars = new char[newSize+1];
+                    AllocationCounter::recordAllocation(newSize+1);
                     if (chars!=nullptr)
                         chars[0] = 0;
                 }
@@ -1,4 +1,5 @@
 #pragma once
+#include "AudioBasic/AllocationCounter.h"
 
 namespace audio_tools {
 
@@ -287,6 +288,7 @@ class Vector {
         T* oldData = p_data;
         int oldBufferLen = this->bufferLen;
         this->p_data = new T[newSize+1];
+        AllocationCounter::recordAllocation(sizeof(T)*(newSize+1));
         this->bufferLen = newSize;  
         if (oldData != nullptr) {
           if(copy && this->len > 0){
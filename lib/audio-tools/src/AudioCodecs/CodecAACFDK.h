@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AudioCodecs/AudioEncoded.h"
+#include "AudioTools/AudioTracer.h"
 #include "AACDecoderFDK.h"
 #include "AACEncoderFDK.h"
 
@@ -116,6 +117,10 @@ class AACDecoderFDK : public AudioDecoder  {
 /**
  * @brief Encodes PCM data to the AAC format and writes the result to a stream
  * This is basically just a wrapper using https://github.com/pschatzmann/arduino-fdk-aac
+ * The written PCM data is collected until we have a full encoder frame (e.g. 1024,
+ * 512 or 480 samples per channel), so that each call of the encoder processes exactly
+ * one frame and provides the access unit with one write to the output. Full frames
+ * are encoded directly from the written data w/o copying them.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -249,6 +254,7 @@ public:
     virtual void begin(AudioBaseInfo info) {
         LOGD(LOG_METHOD);
         enc->begin(info.channels,info.sample_rate, info.bits_per_sample);
+        setupFrame();
     }
 
     /**
@@ -262,23 +268,68 @@ public:
     virtual void begin(int input_channels=2, int input_sample_rate=44100, int input_bits_per_sample=16) {
         LOGD(LOG_METHOD);
         enc->begin(input_channels,input_sample_rate, input_bits_per_sample);
+        setupFrame();
     }
 
     // starts the processing
     void begin() {
         enc->begin();
+        setupFrame();
     }
     
-    // convert PCM data to AAC
+    // convert PCM data to AAC: we call the encoder only with full frames. If the encoder 
+    // fails we return the number of bytes that have been processed before the failed frame
     size_t write(const void *in_ptr, size_t in_size){
         LOGD("write %d bytes", (int)in_size);
-        return enc->write((uint8_t*)in_ptr, in_size);
+        if (frame_bytes==0) return enc->write((uint8_t*)in_ptr, in_size);
+        uint8_t *data = (uint8_t*) in_ptr;
+        size_t processed = 0;
+        // complete the frame which was started by the last write
+        if (frame_fill>0){
+            size_t len = min(in_size, frame_bytes - frame_fill);
+            memcpy(frame.data()+frame_fill, data, len);
+            frame_fill += len;
+            processed += len;
+            if (frame_fill<frame_bytes) return in_size;
+            frame_fill = 0;
+            if (!encodeFrame(frame.data(), frame_bytes)) return 0;
+        }
+        // encode the full frames directly from the provided data
+        while (in_size-processed >= frame_bytes){
+            if (!encodeFrame(data+processed, frame_bytes)) return processed;
+            processed += frame_bytes;
+        }
+        // keep the remainder for the next write
+        frame_fill = in_size-processed;
+        memcpy(frame.data(), data+processed, frame_fill);
+        return in_size;
     }
 
-    // release resources
+    // encodes the incomplete last frame, flushes the encoder and releases the resources
     void end(){
         LOGD(LOG_METHOD);
+        if (frame_bytes>0){
+            if (frame_fill>0) encodeFrame(frame.data(), frame_fill);
+            while (enc->flush());
+        }
         enc->end();
+        frame_fill = 0;
+        frame_bytes = 0;
+    }
+
+    /// Number of bytes of an encoder frame: available after begin()
+    size_t frameSize() {
+        return frame_bytes;
+    }
+
+    /// Time in us which was needed to encode the last frame: w/o the output to the sink
+    uint32_t encodeTimeUs() {
+        return last_encode_us;
+    }
+
+    /// Distribution of the encoding time per frame in us (p50/p99/max): w/o the output to the sink
+    LatencyHistogram &encodeTime() {
+        return encode_time;
     }
 
     UINT getParameter(const AACENC_PARAM param) {
@@ -304,6 +355,35 @@ public:
 
 protected:
     aac_fdk::AACEncoderFDK *enc=nullptr;
+    ScratchBuffer<uint8_t> frame;
+    size_t frame_bytes = 0;
+    size_t frame_fill = 0;
+    uint32_t last_encode_us = 0;
+    LatencyHistogram encode_time;
+
+    /// Allocates the buffer for one frame of int16_t input samples
+    void setupFrame() {
+        frame_fill = 0;
+        frame_bytes = enc->frameSamples() * sizeof(int16_t);
+        if (frame_bytes>0 && !frame.resize(frame_bytes)){
+            LOGE("Not enough memory for a frame of %d bytes", (int)frame_bytes);
+            frame_bytes = 0;
+        }
+        LOGI("frame size: %d bytes", (int)frame_bytes);
+    }
+
+    /// Encodes one frame and records the processing time which was measured by the driver
+    bool encodeFrame(uint8_t *data, size_t len) {
+        bool ok = enc->write(data, len) > 0;
+        last_encode_us = enc->encodeTimeUs();
+        encode_time.add(last_encode_us);
+        if (!ok) {
+            LOGE("encoding of %d bytes failed", (int)len);
+            return false;
+        }
+        LOGD("frame encoded in %u us", (unsigned)last_encode_us);
+        return true;
+    }
 
 };
 
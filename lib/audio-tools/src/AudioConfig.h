@@ -169,6 +169,7 @@
 #define USE_EFFECTS_SUITE
 #define USE_TIMER
 #define USE_I2S_ANALOG
+#define USE_ATOMIC
 
 #define PWM_FREQENCY 30000
 #define PIN_PWM_START 12
@@ -227,6 +228,7 @@ typedef uint32_t eps32_i2s_sample_rate_type;
 #define USE_TYPETRAITS
 #define USE_EFFECTS_SUITE
 #define USE_TIMER
+#define USE_ATOMIC
 
 #define PWM_FREQENCY 30000
 #define PIN_PWM_START 1
@@ -438,6 +440,7 @@ typedef uint32_t eps32_i2s_sample_rate_type;
 
 #ifdef IS_DESKTOP
 #define USE_URL_ARDUINO
+#define USE_ATOMIC
 #define FLUSH_OVERRIDE override
 #endif
 
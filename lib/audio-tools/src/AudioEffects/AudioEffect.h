@@ -8,6 +8,11 @@ namespace audio_tools {
 // we use int16_t for our effects
 typedef int16_t effect_t;
 
+/// Number of samples after which modulators (e.g. LFOs) are updated in the block processing
+#ifndef EFFECT_CONTROL_RATE
+#define EFFECT_CONTROL_RATE 32
+#endif
+
 /**
  * @brief Abstract Base class for Sound Effects
  * @author Phil Schatzmann
@@ -22,6 +27,14 @@ class AudioEffect  {
         /// calculates the effect output from the input
         virtual effect_t process(effect_t in) = 0;
 
+        /// calculates the effect output of n samples in place: the default implementation 
+        /// processes one sample after the other
+        virtual void process(effect_t *buffer, size_t n) {
+            for (size_t j=0;j<n;j++){
+                buffer[j] = process(buffer[j]);
+            }
+        }
+
         /// sets the effect active/inactive
         virtual void setActive(bool value){
             active_flag = value;
@@ -90,9 +103,14 @@ class Boost : public AudioEffect {
 
         effect_t process(effect_t input){
             if (!active()) return input;
-            int32_t result = effect_value * input;
-            // clip to int16_t            
-            return clip(result);
+            return boost(input);
+        }
+
+        void process(effect_t *buffer, size_t n){
+            if (!active()) return;
+            for (size_t j=0;j<n;j++){
+                buffer[j] = boost(buffer[j]);
+            }
         }
 
         Boost* clone() {
@@ -101,6 +119,12 @@ class Boost : public AudioEffect {
 
     protected:
         float effect_value;
+
+        inline effect_t boost(effect_t input){
+            int32_t result = effect_value * input;
+            // clip to int16_t            
+            return clip(result);
+        }
 };
 
 /**
@@ -143,6 +167,13 @@ class Distortion : public AudioEffect  {
             return clip(input,p_clip_threashold, max_input);
         }
 
+        void process(effect_t *buffer, size_t n){
+            if (!active()) return;
+            for (size_t j=0;j<n;j++){
+                buffer[j] = clip(buffer[j], p_clip_threashold, max_input);
+            }
+        }
+
         Distortion* clone() {
             return new Distortion(*this);
         }
@@ -188,9 +219,14 @@ class Fuzz : public AudioEffect  {
 
         effect_t process(effect_t input){
             if (!active()) return input;
-            float v = p_effect_value;
-            int32_t result = clip(v * input) ;
-            return map(result * v, -32768, +32767,-max_out, max_out);
+            return fuzz(input);
+        }
+
+        void process(effect_t *buffer, size_t n){
+            if (!active()) return;
+            for (size_t j=0;j<n;j++){
+                buffer[j] = fuzz(buffer[j]);
+            }
         }
 
         Fuzz *clone() {
@@ -201,6 +237,12 @@ class Fuzz : public AudioEffect  {
         float p_effect_value;
         uint16_t max_out;
 
+        inline effect_t fuzz(effect_t input){
+            float v = p_effect_value;
+            int32_t result = clip(v * input) ;
+            return map(result * v, -32768, +32767,-max_out, max_out);
+        }
+
 };
 
 /**
@@ -260,6 +302,38 @@ class Tremolo : public AudioEffect  {
             return clip(out);
         }
 
+        /// The saw tooth is linear between its turning points, so we just ramp the gain
+        void process(effect_t *buffer, size_t n) {
+            if (!active()) return;
+
+            // limit value to max 100% and calculate factors
+            float tremolo_depth = p_percent > 100 ? 1.0 : 0.01 * p_percent;
+            float signal_depth = (100.0 - p_percent) / 100.0;
+            float tremolo_factor = tremolo_depth / rate_count_half;
+
+            size_t j = 0;
+            while (j<n){
+                // number of samples until the saw tooth changes its direction
+                int32_t steps = inc > 0 ? rate_count_half - count : count;
+                if (steps < 1) steps = 1;
+                size_t len = min((size_t)steps, n - j);
+                float gain = signal_depth + (tremolo_factor * count);
+                float gain_inc = tremolo_factor * inc;
+                for (size_t i=0;i<len;i++){
+                    int32_t out = gain * buffer[j];
+                    buffer[j++] = clip(out);
+                    gain += gain_inc;
+                }
+
+                count += inc * (int32_t) len;
+                if (count>=rate_count_half){
+                    inc = -1;
+                } else if (count<=0) {
+                    inc = +1;
+                }
+            }
+        }
+
         Tremolo* clone() {
             return new Tremolo(*this);
         }
@@ -288,7 +362,20 @@ class Delay : public AudioEffect  {
             p_ms = duration_ms;
         }
 
-        Delay(const Delay &copy) = default;
+        Delay(const Delay &copy) {
+            // the copy gets its own history
+            sampleRate = copy.sampleRate;
+            p_percent = copy.p_percent;
+            p_ms = copy.p_ms;
+            copyParent((AudioEffect *)&copy);
+        }
+
+        /// we would need to copy the history: use clone() instead
+        Delay &operator=(const Delay &) = delete;
+
+        virtual ~Delay() {
+            if (p_history!=nullptr) delete[] p_history;
+        }
 
         void setDuration(int16_t ms){
             p_ms = ms;
@@ -310,12 +397,41 @@ class Delay : public AudioEffect  {
             if (!active()) return input;
 
             updateBufferSize();
-            // get value from buffer
-            int32_t value = (p_history->available()<sampleCount) ? input : p_history->read();
+            if (sampleCount==0) return input;
+            // get value from buffer: we use the input until the history is filled
+            int32_t value = history_count<sampleCount ? input : p_history[history_pos];
             // add actual input value
-            p_history->write(input);
+            p_history[history_pos] = input;
+            if (++history_pos==sampleCount) history_pos = 0;
+            if (history_count<sampleCount) history_count++;
             // mix input with result
-            return (value * p_percent / 100) + (input * (100-p_percent)/100); 
+            return mix(value, input); 
+        }
+
+        void process(effect_t *buffer, size_t n) {
+            if (!active()) return;
+
+            updateBufferSize();
+            if (sampleCount==0) return;
+            size_t j = 0;
+            // fill the history
+            while (j<n && history_count<sampleCount){
+                buffer[j] = process(buffer[j]);
+                j++;
+            }
+            // process the samples up to the end of the history
+            while (j<n){
+                size_t len = min(n - j, (size_t)(sampleCount - history_pos));
+                effect_t *p_delayed = p_history + history_pos;
+                for (size_t i=0;i<len;i++){
+                    effect_t input = buffer[j];
+                    int32_t value = p_delayed[i];
+                    p_delayed[i] = input;
+                    buffer[j++] = mix(value, input);
+                }
+                history_pos += len;
+                if (history_pos==sampleCount) history_pos = 0;
+            }
         }
 
         Delay *clone() {
@@ -323,18 +439,26 @@ class Delay : public AudioEffect  {
         }
 
     protected:
-        RingBuffer<effect_t>* p_history=nullptr;
+        effect_t* p_history=nullptr;
         uint8_t  p_percent;
         uint16_t p_ms;
         uint16_t sampleCount=0;
+        uint16_t history_pos=0;
+        uint16_t history_count=0;
         uint32_t sampleRate;
 
+        inline effect_t mix(int32_t value, int32_t input){
+            return (value * p_percent / 100) + (input * (100-p_percent)/100); 
+        }
+
         void updateBufferSize(){
             uint16_t newSampleCount = sampleRate * p_ms / 1000;
             if (newSampleCount!=sampleCount){
-                if (p_history!=nullptr) delete p_history;
+                if (p_history!=nullptr) delete[] p_history;
                 sampleCount = newSampleCount;
-                p_history = new RingBuffer<effect_t>(sampleCount);
+                p_history = new effect_t[sampleCount];
+                history_pos = 0;
+                history_count = 0;
             }
         }
 };
@@ -364,6 +488,9 @@ class ADSRGain : public AudioEffect {
             copyParent((AudioEffect *)&ref);
         };
 
+        /// we would need to copy the ADSR: use clone() instead
+        ADSRGain &operator=(const ADSRGain &) = delete;
+
         virtual ~ADSRGain(){
             delete adsr;
         }
@@ -413,6 +540,23 @@ class ADSRGain : public AudioEffect {
             return result;
         }
 
+        /// The envelope is updated at control rate: we interpolate the gain in between 
+        void process(effect_t *buffer, size_t n) {
+            size_t j = 0;
+            while (j<n){
+                int len = min(n - j, (size_t)EFFECT_CONTROL_RATE);
+                float start = factor * adsr->value();
+                float end = factor * adsr->tick(len);
+                float gain_inc = (end - start) / len;
+                float gain = start;
+                for (int i=0;i<len;i++){
+                    gain += gain_inc;
+                    buffer[j] = gain * buffer[j];
+                    j++;
+                }
+            }
+        }
+
         bool isActive(){
             return adsr->isActive();
         }
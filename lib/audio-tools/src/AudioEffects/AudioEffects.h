@@ -37,7 +37,7 @@ class AudioEffects : public SoundGenerator<effect_t> {
             // create a copy of the source and all effects
             p_generator = copy.p_generator;
             for (int j=0;j<copy.size();j++){
-                effects.push_back(copy[j]->clone());
+                addEffect(copy[j]->clone());
             }
             LOGI("Number of effects %d -> %d", copy.size(), this->size());
         }
@@ -60,8 +60,9 @@ class AudioEffects : public SoundGenerator<effect_t> {
             if (owns_generator && p_generator!=nullptr){
                 delete p_generator;
             }
-            for (int j=0;j<effects.size();j++){
-                delete effects[j];
+            // we only delete the effects which have been added by pointer
+            for (int j=0;j<owned_effects.size();j++){
+                delete owned_effects[j];
             }
         }
         
@@ -82,10 +83,11 @@ class AudioEffects : public SoundGenerator<effect_t> {
             effects.push_back(&effect);
         }
 
-        /// Adds an effect using a pointer
+        /// Adds an effect using a pointer: the effect is deleted by the destructor
         void addEffect(AudioEffect *effect){
             LOGD(LOG_METHOD);
             effects.push_back(effect);
+            owned_effects.push_back(effect);
             LOGI("addEffect -> Number of effects: %d", size());
         }
 
@@ -102,6 +104,19 @@ class AudioEffects : public SoundGenerator<effect_t> {
             return sample;
         }
 
+        using SoundGenerator<effect_t>::readSamples;
+
+        /// provides the resulting samples: each effect processes the whole block
+        size_t readSamples(effect_t* data, size_t sampleCount=512) override {
+            if (p_generator==nullptr) return 0;
+            size_t result = p_generator->readSamples(data, sampleCount);
+            int size = effects.size();
+            for (int j=0; j<size; j++){
+                effects[j]->process(data, result);
+            }
+            return result;
+        }
+
         /// deletes all defined effects
         void clear() {
             LOGD(LOG_METHOD);
@@ -139,6 +154,7 @@ class AudioEffects : public SoundGenerator<effect_t> {
 
     protected:
         Vector<AudioEffect*> effects;
+        Vector<AudioEffect*> owned_effects;
         GeneratorT *p_generator=nullptr;
         bool owns_generator = false;
 };
@@ -38,6 +38,7 @@ static effectsuite_t **interpolationTable = nullptr;
  */
 
 class EffectSuiteBase  : public AudioEffect {
+public:
   /**
    * @brief Main process block for applying audio effect
    * @param inputSample The input audio sample for the effect to be applied to
@@ -54,6 +55,18 @@ class EffectSuiteBase  : public AudioEffect {
     return active_flag ? 32767.0 * processDouble(static_cast<effectsuite_t>(inputSample)/32767.0) : inputSample;
   }
 
+  /**
+   * Main process block for applying audio effect to n samples in place
+   * @param buffer int16_t audio samples
+   * @param n number of samples
+   */
+  virtual void process(effect_t *buffer, size_t n) override {
+    if (!active_flag) return;
+    for (size_t j = 0; j < n; j++) {
+      buffer[j] = 32767.0 * processDouble(static_cast<effectsuite_t>(buffer[j])/32767.0);
+    }
+  }
+
 };
 
 
@@ -475,6 +488,8 @@ protected:
    */
   bool setDelayBuffer(int bufferSizeSamples) {
     maxDelayBufferSize = bufferSizeSamples;
+    if (delayBuffer != nullptr)
+      delete[] delayBuffer;
     delayBuffer = new effectsuite_t[maxDelayBufferSize];
     if (!delayBuffer) {
       return false;
@@ -629,6 +644,14 @@ public:
     return active_flag ? 32767.0 * applyFilter(static_cast<effectsuite_t>(inputSample)/32767.0) : inputSample;
   }
 
+  /// see applyFilter
+  virtual void process(effect_t *buffer, size_t n) override {
+    if (!active_flag) return;
+    for (size_t j = 0; j < n; j++) {
+      buffer[j] = 32767.0 * applyFilter(static_cast<effectsuite_t>(buffer[j])/32767.0);
+    }
+  }
+
   /**
    *  detect the envelop of an incoming signal
    * @param sample		the incoming signal sample value
@@ -1017,15 +1040,35 @@ public:
    * @return processed audio sample
    */
   virtual effectsuite_t processDouble(effectsuite_t inputSample) {
-    delaySample(inputSample);
-    const effectsuite_t waveDelay = getModSignal();
-    const effectsuite_t delayAmount =
-        ((int(currentDelayWriteIndex - waveDelay) + delayTimeSamples) %
-         delayTimeSamples) +
-        ((currentDelayWriteIndex - waveDelay) -
-         trunc(currentDelayWriteIndex - waveDelay));
-    const effectsuite_t out = .0 * inputSample + 1. * getInterpolatedOut(delayAmount);
-    return out;
+    return chorus(inputSample, getModSignal());
+  }
+
+  /// we apply the chorus and not the low pass filter of the SimpleLPF
+  virtual effect_t process(effect_t inputSample) override {
+    return active_flag ? 32767.0 * processDouble(static_cast<effectsuite_t>(inputSample)/32767.0) : inputSample;
+  }
+
+  /**
+   * apply chorus effect to n samples in place: the modulation signal is
+   * calculated at control rate and interpolated in between
+   * @param buffer input audio samples
+   * @param n number of samples
+   */
+  virtual void process(effect_t *buffer, size_t n) override {
+    if (!active_flag) return;
+    size_t j = 0;
+    while (j < n) {
+      const size_t len = std::min(n - j, (size_t)EFFECT_CONTROL_RATE);
+      effectsuite_t waveDelay = getModSignalAt(tableIndex);
+      advanceTable(readSpeed * len);
+      const effectsuite_t waveDelayInc =
+          (getModSignalAt(tableIndex) - waveDelay) / len;
+      for (size_t i = 0; i < len; i++) {
+        const effectsuite_t in = static_cast<effectsuite_t>(buffer[j]) / 32767.0f;
+        buffer[j++] = 32767.0f * chorus(in, waveDelay);
+        waveDelay += waveDelayInc;
+      }
+    }
   }
 
   /**
@@ -1082,6 +1125,32 @@ protected:
    **/
   effectsuite_t getModSignal() { return (readTable(readSpeed) * swing) + base; }
 
+  /// modulation signal at the indicated table index (see readTable)
+  effectsuite_t getModSignalAt(effectsuite_t index) {
+    const effectsuite_t value = readSpeed > 0 ? getSplineOut(index, int(readSpeed)) : 0.;
+    return (value * swing) + base;
+  }
+
+  /// moves the table index like readTable
+  void advanceTable(effectsuite_t inc) {
+    if (readSpeed <= 0) return;
+    tableIndex += inc;
+    if (tableIndex - sampleRate > 0)
+      tableIndex -= sampleRate;
+  }
+
+  /// stores the sample and reads the delayed signal
+  inline effectsuite_t chorus(effectsuite_t inputSample, effectsuite_t waveDelay) {
+    delaySample(inputSample);
+    const effectsuite_t delayAmount =
+        ((int(currentDelayWriteIndex - waveDelay) + delayTimeSamples) %
+         delayTimeSamples) +
+        ((currentDelayWriteIndex - waveDelay) -
+         trunc(currentDelayWriteIndex - waveDelay));
+    const effectsuite_t out = .0 * inputSample + 1. * getInterpolatedOut(delayAmount);
+    return out;
+  }
+
   void setRandLfo() {
     std::fill(iirBuffer, iirBuffer + filterOrder, .5);
     for (int i = 0; i < sampleRate; i++) {
@@ -1203,7 +1272,9 @@ public:
    * @param delayInSamples Set the amount of delay in samples
    * @see DelayEffectBase constructor
    */
-  SimpleDelay(int maxDelayInSamples=8810, int samplingRate=44100) {
+  SimpleDelay(int maxDelayInSamples=8810, int samplingRate=44100)
+      : DelayEffectBase(maxDelayInSamples) {
+    sampleRate = samplingRate;
     writeHeadIndex = 0;
     readHeadIndex = 1;
     currentDelaySamples = maxDelayInSamples;
@@ -1272,6 +1343,41 @@ public:
     return outSample;
   }
 
+  using EffectSuiteBase::process;
+
+  /**
+   * Apply delay to n samples in place: while the delay time is changing we
+   * process one sample after the other
+   * @param buffer input audio samples
+   * @param n number of samples
+   */
+  void process(effect_t *buffer, size_t n) override {
+    if (!active_flag) return;
+    size_t j = 0;
+    for (; j < n && delayTimeChanged; j++) {
+      buffer[j] = 32767.0 * SimpleDelay::processDouble(static_cast<effectsuite_t>(buffer[j]) / 32767.0);
+    }
+    // at an integer read index the spline interpolation provides the next sample
+    const bool isInteger = readHeadIndex == floor(readHeadIndex);
+    int readIndex = readHeadIndex;
+    for (; j < n; j++) {
+      const effectsuite_t inputSample = static_cast<effectsuite_t>(buffer[j]) / 32767.0f;
+      delayBuffer[writeHeadIndex] = inputSample;
+      if (++writeHeadIndex >= (unsigned)maxDelayBufferSize) writeHeadIndex = 0;
+      const effectsuite_t delayed =
+          isInteger ? delayBuffer[(readIndex + 1) % maxDelayBufferSize]
+                    : getSplineOut(readHeadIndex);
+      buffer[j] = 32767.0f * (delayed + inputSample);
+      if (isInteger) {
+        if (++readIndex >= maxDelayBufferSize) readIndex = 0;
+      } else {
+        readHeadIndex++;
+        if (readHeadIndex >= maxDelayBufferSize) readHeadIndex -= maxDelayBufferSize;
+      }
+    }
+    if (isInteger) readHeadIndex = readIndex;
+  }
+
   /**
    <#Description#>
    @param delayInSamples <#delayInSamples description#>
@@ -1432,6 +1538,35 @@ public:
     return out;
   }
 
+  using EffectSuiteBase::process;
+
+  /**
+   * Apply the DSP effect to n samples in place: the sine modulation is
+   * calculated at control rate and interpolated in between
+   */
+  void process(effect_t *buffer, size_t n) override {
+    if (!active_flag) return;
+    const effectsuite_t dryGain = 1 - fabs(effectGain * .2);
+    size_t j = 0;
+    while (j < n) {
+      const size_t len = std::min(n - j, (size_t)EFFECT_CONTROL_RATE);
+      effectsuite_t offset = getModulationOffset(modulationAngle);
+      modulationAngle += angleDelta * len;
+      if (modulationAngle > 2 * internal_Pi) modulationAngle -= 2 * internal_Pi;
+      const effectsuite_t offsetInc =
+          (getModulationOffset(modulationAngle) - offset) / len;
+      for (size_t i = 0; i < len; i++) {
+        const effectsuite_t inputSample = static_cast<effectsuite_t>(buffer[j]) / 32767.0f;
+        delaySample(inputSample);
+        const effectsuite_t out = dryGain * inputSample +
+                        (effectGain * getInterpolatedOut(modulationIndex));
+        offset += offsetInc;
+        setModulationIndex(currentDelayWriteIndex - offset);
+        buffer[j++] = 32767.0f * out;
+      }
+    }
+  }
+
   void setupSimpleFlanger(effectsuite_t extSampleRate) {
     setupDelayEffectBase(extSampleRate * .02);
     timeStep = 1. / extSampleRate;
@@ -1469,12 +1604,19 @@ protected:
    **/
   void updateModulation() {
     modulationAngle += angleDelta;
-    modulationIndex = (currentDelayWriteIndex -
-                       (modulationDepth * (1 + (sin(modulationAngle))))) -
-                      12;
+    setModulationIndex(currentDelayWriteIndex - getModulationOffset(modulationAngle));
+  }
+
+  /// distance of the read index from the write index for the indicated angle
+  inline effectsuite_t getModulationOffset(effectsuite_t angle) {
+    return (modulationDepth * (1 + (sin(angle)))) + 12;
+  }
+
+  /// wraps the read index into the delay buffer
+  inline void setModulationIndex(effectsuite_t index) {
     modulationIndex =
-        ((int(modulationIndex) + delayTimeSamples) % delayTimeSamples) +
-        (modulationIndex - floor(modulationIndex));
+        ((int(index) + delayTimeSamples) % delayTimeSamples) +
+        (index - floor(index));
   }
 
 protected:
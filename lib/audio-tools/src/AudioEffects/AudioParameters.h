@@ -113,6 +113,53 @@ class ADSR : public  AbstractParameter  {
             return state!=Idle;
         }
 
+        using AbstractParameter::tick;
+
+        /// advances the envelope by the indicated number of samples: the segments
+        /// are linear, so we just scale the rate by the number of samples which
+        /// remain in the actual segment
+        float tick(int samples) {
+            while (samples>0){
+                switch (state) {
+                    case Attack:
+                        samples -= advance(attack, target, samples);
+                        if (act_value >= target) {
+                            act_value = target;
+                            target = sustain;
+                            state = Decay;
+                        }
+                        break;
+                    case Decay:
+                        if (act_value > sustain) {
+                            samples -= advance(-decay, sustain, samples);
+                            if (act_value <= sustain) {
+                                act_value = sustain;
+                                state = Sustain;
+                            }
+                        } else {
+                            samples -= advance(decay, sustain, samples);
+                            if (act_value >= sustain) {
+                                act_value = sustain;
+                                state = Sustain;
+                            }
+                        }
+                        break;
+                    case Release:
+                        samples -= advance(-release, 0.0f, samples);
+                        if (act_value <= 0.0f) {
+                            act_value = 0.0f;
+                            state = Idle;
+                        }
+                        break;
+                    default:
+                        // the value does not change any more
+                        samples = 0;
+                        break;
+                }
+            }
+            return act_value;
+        }
+
     protected:
         float attack,  decay,  sustain,  release;
         enum AdsrPhase {Idle, Attack, Decay, Sustain, Release};
@@ -121,6 +168,19 @@ class ADSR : public  AbstractParameter  {
         float target = 0;
         int zeroCount =  0;
 
+        /// moves the value with the rate per sample towards the limit for max samples:
+        /// returns the number of used samples (at least 1 like update())
+        int advance(float rate, float limit, int samples) {
+            if (rate == 0.0f) {
+                // we never reach the limit
+                return samples;
+            }
+            float steps = ceilf((limit - act_value) / rate);
+            int result = steps < 1.0f ? 1 : (steps < samples ? (int)steps : samples);
+            act_value += rate * result;
+            return result;
+        }
+
         inline float update( ) {
 
             switch ( state ) {
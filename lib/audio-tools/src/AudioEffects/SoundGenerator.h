@@ -4,6 +4,11 @@
 #include "AudioTools/AudioTypes.h"
 #include "AudioBasic/Vector.h"
 
+/// Number of bits of the size of the SineTable (default 1024 entries)
+#ifndef SINE_TABLE_BITS
+#define SINE_TABLE_BITS 10
+#endif
+
 namespace audio_tools {
 
 /**
@@ -61,13 +66,16 @@ class SoundGenerator  {
 
         /// Provides the samples into a 2 channel array
         virtual size_t readSamples(T src[][2], size_t frameCount) {
-            T tmp[frameCount];
-            int len = readSamples(tmp, frameCount);
-            for (int j=0;j<len;j++) {
-                T value = tmp[j];
-                src[j][1] = src[j][0] = value;
-            }
-            return frameCount;
+            return generate((T*) src, frameCount, 2);
+        }
+
+        /// Provides the indicated number of frames with interleaved samples for the indicated number 
+        /// of channels. Returns the number of frames.
+        virtual size_t generate(T* out, size_t frames, int channels) {
+            // generate the mono samples into the first part of the array
+            size_t len = readSamples(out, frames);
+            expand(out, len, channels);
+            return len;
         }
 
         /// Provides a single sample
@@ -84,22 +92,9 @@ class SoundGenerator  {
             }
             int frame_size = sizeof(T) * ch;
             if (active){
-                int len = lengthBytes / frame_size;
-                if (lengthBytes % frame_size!=0){
-                    len++;
-                }
-                switch (ch){
-                    case 1:
-                        result = readSamples((T*) buffer, len) ;
-                        break;
-                    case 2:
-                        result = readSamples((T(*)[2]) buffer, len);
-                        break;
-                    default:
-                        LOGE( "SoundGenerator::readBytes -> number of channels %d is not supported (use 1 or 2)", ch);
-                        result = 0;
-                        break;
-                }
+                // we only provide full frames
+                size_t len = lengthBytes / frame_size;
+                result = generate((T*) buffer, len, ch);
             } else {
                 if (!activeWarningIssued) {
                     LOGE("SoundGenerator::readBytes -> inactive");
@@ -140,10 +135,72 @@ class SoundGenerator  {
         bool activeWarningIssued = false;
         int output_channels = 1;
         AudioBaseInfo info;
+
+        /// copies the mono samples at the beginning of the array to all channels: we
+        /// start from the end so that we need no temporary buffer
+        void expand(T* out, size_t frames, int channels){
+            if (channels<=1) return;
+            if (channels==2){
+                for (size_t j=frames;j-->0;) {
+                    out[2*j+1] = out[2*j] = out[j];
+                }
+                return;
+            }
+            for (size_t j=frames;j-->0;) {
+                T value = out[j];
+                T* frame = out + j * channels;
+                for (int ch=0;ch<channels;ch++){
+                    frame[ch] = value;
+                }
+            }
+        }
         
 };
 
 
+/**
+ * @brief One period of a sine wave which is used by the generators to look up the 
+ * values with a 32 bit phase accumulator: the top SINE_TABLE_BITS bits select the 
+ * table entry and the remaining bits are used for the linear interpolation. 
+ * The table is shared by all generators.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SineTable {
+    public:
+        static SineTable &instance() {
+            static SineTable table;
+            return table;
+        }
+
+        /// Provides the sine value for the indicated phase (2^32 is one full wave)
+        inline float value(uint32_t phase) {
+            uint32_t idx = phase >> (32 - SINE_TABLE_BITS);
+            float frac = (phase & frac_mask) * frac_scale;
+            float v1 = values[idx];
+            return v1 + frac * (values[idx + 1] - v1);
+        }
+
+        /// Converts a number of cycles (1.0 is one full wave) into a phase
+        static uint32_t phase(double cycles) {
+            cycles -= floor(cycles);
+            return (uint32_t)(uint64_t)(cycles * 4294967296.0);
+        }
+
+    protected:
+        static const int size = 1 << SINE_TABLE_BITS;
+        static const uint32_t frac_mask = (1ul << (32 - SINE_TABLE_BITS)) - 1;
+        const float frac_scale = 1.0f / (1ul << (32 - SINE_TABLE_BITS));
+        // we repeat the first value at the end so that we do not need to wrap for the interpolation
+        float values[size + 1];
+
+        SineTable() {
+            for (int j=0;j<=size;j++){
+                values[j] = sin(2.0 * PI * j / size);
+            }
+        }
+};
+
 /**
  * @brief Generates a Sound with the help of sin() function. If you plan to change the amplitude or frequency (incrementally),
  * I suggest to use SineFromTable instead.
@@ -220,6 +277,22 @@ class SineWaveGenerator : public SoundGenerator<T>{
             return result;
         }
 
+        /// Provides the frames with the help of the SineTable
+        size_t generate(T* out, size_t frames, int channels) override {
+            switch(channels){
+                case 1:
+                    generateSine<1>(out, frames, channels);
+                    break;
+                case 2:
+                    generateSine<2>(out, frames, channels);
+                    break;
+                default:
+                    generateSine<0>(out, frames, channels);
+                    break;
+            }
+            return frames;
+        }
+
     protected:
         volatile float m_frequency = 0;
         float m_cycles = 0.0; // Varies between 0.0 and 1.0
@@ -235,6 +308,36 @@ class SineWaveGenerator : public SoundGenerator<T>{
             LOGI( "active: %s", SoundGenerator<T>::active ? "true" : "false" );
         }
 
+        /// phase increment per sample for the phase accumulator
+        uint32_t phaseIncrement() {
+            return SineTable::phase(m_frequency * m_deltaTime);
+        }
+
+        /// phase offset which is defined by m_phase
+        uint32_t phaseOffset() {
+            return SineTable::phase(m_phase / double_Pi);
+        }
+
+        /// CH is the number of channels or 0 for N channels
+        template <int CH>
+        void generateSine(T* out, size_t frames, int channels) {
+            const int ch_count = CH == 0 ? channels : CH;
+            SineTable &table = SineTable::instance();
+            const float amplitude = m_amplitude;
+            const uint32_t inc = phaseIncrement();
+            const uint32_t offset = phaseOffset();
+            // we continue with the phase of readSample()
+            uint32_t phase = SineTable::phase(m_cycles);
+            for (size_t f=0;f<frames;f++){
+                T value = amplitude * table.value(phase + offset);
+                for (int ch=0;ch<ch_count;ch++){
+                    *out++ = value;
+                }
+                phase += inc;
+            }
+            m_cycles = phase / 4294967296.0;
+        }
+
 };
 
 /**
@@ -254,11 +357,46 @@ class SquareWaveGenerator : public SineWaveGenerator<T> {
             return value(SineWaveGenerator<T>::readSample(), SineWaveGenerator<T>::m_amplitude);
         }
 
+        /// Provides the frames: the sine is positive in the first half of the phase
+        size_t generate(T* out, size_t frames, int channels) override {
+            switch(channels){
+                case 1:
+                    generateSquare<1>(out, frames, channels);
+                    break;
+                case 2:
+                    generateSquare<2>(out, frames, channels);
+                    break;
+                default:
+                    generateSquare<0>(out, frames, channels);
+                    break;
+            }
+            return frames;
+        }
+
     protected:
         // returns amplitude for positive vales and -amplitude for negative values
         T value(T value, T amplitude) {
             return (value >= 0) ? amplitude : -amplitude;
         }
+
+        /// CH is the number of channels or 0 for N channels: written so that the 
+        /// compiler can vectorize the loop
+        template <int CH>
+        void generateSquare(T* out, size_t frames, int channels) {
+            const int ch_count = CH == 0 ? channels : CH;
+            const T amplitude = SineWaveGenerator<T>::m_amplitude;
+            const uint32_t inc = this->phaseIncrement();
+            const uint32_t phase = SineWaveGenerator<T>::phaseOffset() + 
+                                   SineTable::phase(SineWaveGenerator<T>::m_cycles);
+            for (size_t f=0;f<frames;f++){
+                T value = (int32_t)(phase + (uint32_t)f * inc) >= 0 ? amplitude : -amplitude;
+                for (int ch=0;ch<ch_count;ch++){
+                    out[f * ch_count + ch] = value;
+                }
+            }
+            uint32_t end = SineTable::phase(SineWaveGenerator<T>::m_cycles) + (uint32_t)frames * inc;
+            SineWaveGenerator<T>::m_cycles = end / 4294967296.0;
+        }
 };
 
 
@@ -281,8 +419,31 @@ class NoiseGenerator : public SoundGenerator<T> {
             return (random(-amplitude, amplitude));
         }
 
+        /// Provides the frames: we use independent linear congruential generators for 
+        /// the lanes so that the compiler can vectorize the loop
+        size_t generate(T* out, size_t frames, int channels) override {
+            const float scale = amplitude / 2147483648.0f;
+            size_t samples = frames;
+            size_t j = 0;
+            for (;j + lanes <= samples; j += lanes){
+                for (int l=0;l<lanes;l++){
+                    seeds[l] = seeds[l] * 1664525u + 1013904223u;
+                    out[j + l] = (int32_t)seeds[l] * scale;
+                }
+            }
+            for (int l=0;j<samples;j++,l++){
+                seeds[l] = seeds[l] * 1664525u + 1013904223u;
+                out[j] = (int32_t)seeds[l] * scale;
+            }
+            this->expand(out, frames, channels);
+            return frames;
+        }
+
     protected:
         T amplitude;
+        static const int lanes = 8;
+        uint32_t seeds[lanes] = {0x12345678u, 0x9abcdef0u, 0x0fedcba9u, 0x87654321u, 
+                                 0x2468ace0u, 0x13579bdfu, 0xdeadbeefu, 0xcafebabeu};
 
 };
 
@@ -569,17 +730,23 @@ class SineFromTable  : public SoundGenerator<T> {
         }
 
         T readSample() {
-            // update angle
-            angle += step;
-            if (angle >= 360){
-               angle -= 360; 
-               // update frequency at start of circle (near 0 degrees)
-               step = step_new;
-
-               updateAmplitudeInSteps();
-               //amplitude = amplitude_to_be;
+            return nextValue();
+        }
+
+        /// Provides the frames: the value is calculated once per frame
+        size_t generate(T* out, size_t frames, int channels) override {
+            switch(channels){
+                case 1:
+                    generateSine<1>(out, frames, channels);
+                    break;
+                case 2:
+                    generateSine<2>(out, frames, channels);
+                    break;
+                default:
+                    generateSine<0>(out, frames, channels);
+                    break;
             }
-            return amplitude * interpolate(angle);
+            return frames;
         }
 
         bool begin() {
@@ -623,20 +790,41 @@ class SineFromTable  : public SoundGenerator<T> {
         //122.5 hz (at 44100); 61 hz (at 22050)
         const float values[181] = {0, 0.0174524, 0.0348995, 0.052336, 0.0697565, 0.0871557, 0.104528, 0.121869, 0.139173, 0.156434, 0.173648, 0.190809, 0.207912, 0.224951, 0.241922, 0.258819, 0.275637, 0.292372, 0.309017, 0.325568, 0.34202, 0.358368, 0.374607, 0.390731, 0.406737, 0.422618, 0.438371, 0.45399, 0.469472, 0.48481, 0.5, 0.515038, 0.529919, 0.544639, 0.559193, 0.573576, 0.587785, 0.601815, 0.615661, 0.62932, 0.642788, 0.656059, 0.669131, 0.681998, 0.694658, 0.707107, 0.71934, 0.731354, 0.743145, 0.75471, 0.766044, 0.777146, 0.788011, 0.798636, 0.809017, 0.819152, 0.829038, 0.838671, 0.848048, 0.857167, 0.866025, 0.87462, 0.882948, 0.891007, 0.898794, 0.906308, 0.913545, 0.920505, 0.927184, 0.93358, 0.939693, 0.945519, 0.951057, 0.956305, 0.961262, 0.965926, 0.970296, 0.97437, 0.978148, 0.981627, 0.984808, 0.987688, 0.990268, 0.992546, 0.994522, 0.996195, 0.997564, 0.99863, 0.999391, 0.999848, 1, 0.999848, 0.999391, 0.99863, 0.997564, 0.996195, 0.994522, 0.992546, 0.990268, 0.987688, 0.984808, 0.981627, 0.978148, 0.97437, 0.970296, 0.965926, 0.961262, 0.956305, 0.951057, 0.945519, 0.939693, 0.93358, 0.927184, 0.920505, 0.913545, 0.906308, 0.898794, 0.891007, 0.882948, 0.87462, 0.866025, 0.857167, 0.848048, 0.838671, 0.829038, 0.819152, 0.809017, 0.798636, 0.788011, 0.777146, 0.766044, 0.75471, 0.743145, 0.731354, 0.71934, 0.707107, 0.694658, 0.681998, 0.669131, 0.656059, 0.642788, 0.62932, 0.615661, 0.601815, 0.587785, 0.573576, 0.559193, 0.544639, 0.529919, 0.515038, 0.5, 0.48481, 0.469472, 0.45399, 0.438371, 0.422618, 0.406737, 0.390731, 0.374607, 0.358368, 0.34202, 0.325568, 0.309017, 0.292372, 0.275637, 0.258819, 0.241922, 0.224951, 0.207912, 0.190809, 0.173648, 0.156434, 0.139173, 0.121869, 0.104528, 0.0871557, 0.0697565, 0.052336, 0.0348995, 0.0174524, 0}; 
 
-        float interpolate(float angle){
-            bool positive = (angle<=180);
-            float angle_positive = positive ? angle : angle - 180.0;
-            int angle_int1 = angle_positive;
-            int angle_int2 = angle_int1+1;
-            float v1 = values[angle_int1];
-            float v2 = values[angle_int2];
-            float result = v1 < v2 ? map(angle_positive,angle_int1,angle_int2,v1, v2) : map(angle_positive,angle_int1,angle_int2,v2, v1)  ;
-            //float result = v1;
-            return positive ? result : -result;
+        inline T nextValue() {
+            // update angle
+            angle += step;
+            if (angle >= 360){
+               angle -= 360; 
+               // update frequency at start of circle (near 0 degrees)
+               step = step_new;
+
+               updateAmplitudeInSteps();
+               //amplitude = amplitude_to_be;
+            }
+            return amplitude * interpolate(angle);
         }
 
-        float map(float x, float in_min, float in_max, float out_min, float out_max) {
-          return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+        /// CH is the number of channels or 0 for N channels
+        template <int CH>
+        void generateSine(T* out, size_t frames, int channels) {
+            const int ch_count = CH == 0 ? channels : CH;
+            for (size_t f=0;f<frames;f++){
+                T value = nextValue();
+                for (int ch=0;ch<ch_count;ch++){
+                    *out++ = value;
+                }
+            }
+        }
+
+        /// linear interpolation between the degrees: angle is in the range of 0 to 360
+        inline float interpolate(float angle){
+            bool positive = (angle<180);
+            float angle_positive = positive ? angle : angle - 180.0f;
+            int angle_int = angle_positive;
+            float v1 = values[angle_int];
+            float v2 = values[angle_int+1];
+            float result = v1 + (angle_positive - angle_int) * (v2 - v1);
+            return positive ? result : -result;
         }
 
         void updateAmplitudeInSteps() {
@@ -23,6 +23,9 @@ struct ConfigEquilizer3Bands : public AudioBaseInfo {
     float  gain_low = 1.0;
     float  gain_medium = 1.0;
     float  gain_high = 1.0;
+
+    /// samples are float (see FloatFormatConverterStream)
+    bool use_float = false;
 };
 
 /**
@@ -149,6 +152,16 @@ class Equilizer3Bands : public AudioStreamX {
         } *state=nullptr;
 
         void filterSamples(const uint8_t *data, size_t len){
+            if (p_cfg->use_float){
+                float* p_dataT = (float*)data;
+                size_t sample_count = len / sizeof(float);
+                for (int j=0; j<sample_count; j+=p_cfg->channels){
+                    for (int ch=0; ch<p_cfg->channels; ch++){
+                        p_dataT[j+ch] = sample(state[ch], p_dataT[j+ch]);
+                    }
+                }
+                return;
+            }
             switch(p_cfg->bits_per_sample){
                 case 16: {
                         int16_t* p_dataT = (int16_t*)data;
@@ -222,4 +235,501 @@ class Equilizer3Bands : public AudioStreamX {
 
 };
 
-} // namespace
\ No newline at end of file
+#ifndef EQ_MAX_BANDS
+#define EQ_MAX_BANDS 10
+#endif
+
+/// Filter type of a band of the ParametricEqualizer
+enum EQBandType { EQPeaking, EQLowShelf, EQHighShelf, EQLowPass, EQHighPass };
+
+/**
+ * @brief Definition of a band of the ParametricEqualizer: the gain is in dB and 
+ * is not used by the low and high pass.
+ * @author pschatzmann
+ */
+struct EQBand {
+    EQBandType type = EQPeaking;
+    float frequency = 1000;
+    float gain_db = 0;
+    float q = 0.707;
+    bool active = false;
+};
+
+/**
+ * @brief Configuration for the ParametricEqualizer: Set channels, bits_per_sample,
+ * sample_rate and define up to EQ_MAX_BANDS bands.
+ * @author pschatzmann
+ */
+struct ConfigParametricEqualizer : public AudioBaseInfo {
+    ConfigParametricEqualizer(){
+        channels = 2;
+        bits_per_sample = 16;
+        sample_rate = 44100;
+    }
+    EQBand bands[EQ_MAX_BANDS];
+    /// Number of frames over which a change of a band is interpolated
+    int ramp_frames = 1024;
+    /// Number of frames which are processed in one step
+    int block_frames = 64;
+    /// samples are float (see FloatFormatConverterStream): they are filtered in place
+    bool use_float = false;
+};
+
+/**
+ * @brief Parametric Equalizer with up to EQ_MAX_BANDS bands: each band is a biquad 
+ * (peaking, low/high shelf, low/high pass) with the coefficients from the RBJ Audio
+ * EQ Cookbook. The data is processed in blocks: the biquads of a band are calculated
+ * for all channels in the same loop, so that the independent channels can be overlapped
+ * by the cpu. Stereo data is processed with SSE2 or NEON with one channel per lane. 
+ * Bands with a gain of 0 dB are skipped.
+ * 
+ * Changes of a band are applied by interpolating the coefficients from block to block 
+ * over ramp_frames, so that we do not need to recalculate them for each sample. 
+ * Supports 16 and 32 bit data and float data (use_float) which is filtered in place.
+ * @author pschatzmann
+ */
+class ParametricEqualizer : public AudioStreamX {
+    public:
+
+        ParametricEqualizer(Print &out) {
+            p_print = &out;
+        }
+
+        ParametricEqualizer(Stream &in) {
+            p_stream = &in;
+        }
+
+        ParametricEqualizer(AudioPrint &out) {
+            p_print = &out;
+            out.setNotifyAudioChange(*this);
+        }
+
+        ParametricEqualizer(AudioStream &stream) {
+            p_stream = &stream;
+            p_print = &stream;
+            stream.setNotifyAudioChange(*this);
+        }
+
+        ConfigParametricEqualizer &config() {
+            return cfg;
+        }
+
+        ConfigParametricEqualizer defaultConfig() {
+            ConfigParametricEqualizer result;
+            return result;
+        }
+
+        /// Starts the processing: the bands which were defined with setBand(), setGain() 
+        /// or removeBand() before begin() replace the corresponding bands of the config
+        bool begin(const ConfigParametricEqualizer &config){
+            EQBand defined[EQ_MAX_BANDS];
+            for (int j=0;j<EQ_MAX_BANDS;j++){
+                defined[j] = cfg.bands[j];
+            }
+            cfg = config;
+            for (int j=0;j<EQ_MAX_BANDS;j++){
+                if (is_band_defined[j]) cfg.bands[j] = defined[j];
+                is_band_defined[j] = false;
+            }
+            is_started = false;
+            if (cfg.channels<=0 || cfg.block_frames<=0){
+                LOGE("Invalid channels: %d", cfg.channels);
+                return false;
+            }
+            if (!cfg.use_float && cfg.bits_per_sample!=16 && cfg.bits_per_sample!=32){
+                LOGE("Only 16 and 32 bits supported: %d", cfg.bits_per_sample);
+                return false;
+            }
+            state.resize(EQ_MAX_BANDS * cfg.channels * 4);
+            for (int j=0;j<state.size();j++){
+                state[j] = 0.0f;
+            }
+            if (!block.resize(cfg.block_frames * cfg.channels)) return false;
+            is_started = true;
+            for (int j=0;j<EQ_MAX_BANDS;j++){
+                updateBand(j, false);
+            }
+            return true;
+        }
+
+        /// Defines a band: the change is interpolated over ramp_frames. Bands
+        /// which are defined before begin() are applied w/o interpolation by begin()
+        bool setBand(int idx, EQBandType type, float frequency, float gainDb, float q=0.707){
+            if (idx<0 || idx>=EQ_MAX_BANDS){
+                LOGE("Invalid band %d", idx);
+                return false;
+            }
+            EQBand &band = cfg.bands[idx];
+            band.type = type;
+            band.frequency = frequency;
+            band.gain_db = gainDb;
+            band.q = q;
+            band.active = true;
+            updateBand(idx, true);
+            return true;
+        }
+
+        /// Changes the gain of a band: the change is interpolated over ramp_frames
+        bool setGain(int idx, float gainDb){
+            if (idx<0 || idx>=EQ_MAX_BANDS){
+                LOGE("Invalid band %d", idx);
+                return false;
+            }
+            cfg.bands[idx].gain_db = gainDb;
+            updateBand(idx, true);
+            return true;
+        }
+
+        /// Deactivates a band
+        void removeBand(int idx){
+            if (idx<0 || idx>=EQ_MAX_BANDS) return;
+            cfg.bands[idx].active = false;
+            updateBand(idx, true);
+        }
+
+        virtual void setAudioInfo(AudioBaseInfo info) override {
+            cfg.sample_rate = info.sample_rate;
+            cfg.channels = info.channels;
+            cfg.bits_per_sample = info.bits_per_sample;
+            begin(cfg);
+        }
+
+        size_t write(const uint8_t *data, size_t len) override {
+            if (p_print==nullptr) return 0;
+            filterSamples((uint8_t*)data, len);
+            return p_print->write(data, len);
+        }
+
+        int availableForWrite() override {
+            return p_print==nullptr ? 0 : p_print->availableForWrite();
+        }
+
+        size_t readBytes(uint8_t* data, size_t len) override {
+            size_t result = 0;
+            if (p_stream!=nullptr){
+                result = p_stream->readBytes(data, len);
+                filterSamples(data, result);
+            }
+            return result;
+        }
+
+        int available()  override {
+            return p_stream!=nullptr ? p_stream->available():0;
+        }
+
+    protected:
+        struct Coefficients {
+            float b0=1, b1=0, b2=0, a1=0, a2=0;
+        };
+
+        struct BandState {
+            Coefficients actual;
+            Coefficients target;
+            Coefficients step;
+            int ramp_steps = 0;
+            bool bypass = true;
+        };
+
+        ConfigParametricEqualizer cfg;
+        BandState bands[EQ_MAX_BANDS];
+        // x1, x2, y1, y2 for each band and channel
+        Vector<float> state{0};
+        ScratchBuffer<float> block;
+        Print *p_print = nullptr; // support for write
+        Stream *p_stream = nullptr; // support for readBytes
+        bool is_started = false;
+        bool is_band_defined[EQ_MAX_BANDS] = {false};
+
+        /// Calculates the target coefficients of the band: before begin() we
+        /// just record the band, so that begin() can merge it into the configuration
+        void updateBand(int idx, bool ramp){
+            if (!is_started) {
+                is_band_defined[idx] = true;
+                return;
+            }
+            EQBand &band = cfg.bands[idx];
+            BandState &bs = bands[idx];
+            bool was_bypass = bs.bypass && bs.ramp_steps==0;
+            bs.target = band.active ? coefficients(band) : Coefficients();
+            if (!ramp || was_bypass){
+                // we start from the identity with a clean state
+                resetState(idx);
+                if (!ramp) bs.actual = bs.target;
+            }
+            if (ramp){
+                int steps = cfg.ramp_frames / cfg.block_frames;
+                if (steps<1) steps = 1;
+                bs.ramp_steps = steps;
+                bs.step.b0 = (bs.target.b0 - bs.actual.b0) / steps;
+                bs.step.b1 = (bs.target.b1 - bs.actual.b1) / steps;
+                bs.step.b2 = (bs.target.b2 - bs.actual.b2) / steps;
+                bs.step.a1 = (bs.target.a1 - bs.actual.a1) / steps;
+                bs.step.a2 = (bs.target.a2 - bs.actual.a2) / steps;
+            } else {
+                bs.ramp_steps = 0;
+            }
+            bs.bypass = isIdentity(bs.target);
+        }
+
+        void resetState(int idx){
+            float *s = state.data() + idx * cfg.channels * 4;
+            for (int j=0;j<cfg.channels*4;j++){
+                s[j] = 0.0f;
+            }
+        }
+
+        bool isIdentity(Coefficients &c){
+            return c.b0==1.0f && c.b1==c.a1 && c.b2==c.a2;
+        }
+
+        /// Coefficients from the RBJ Audio EQ Cookbook normalized by a0
+        Coefficients coefficients(EQBand &band){
+            Coefficients result;
+            float a = powf(10.0f, band.gain_db / 40.0f);
+            float w0 = 2.0f * M_PI * band.frequency / cfg.sample_rate;
+            float cos_w0 = cosf(w0);
+            float alpha = sinf(w0) / (2.0f * (band.q > 0.0f ? band.q : 0.707f));
+            float sqrt_a2 = 2.0f * sqrtf(a) * alpha;
+            float b0, b1, b2, a0, a1, a2;
+            switch(band.type){
+                case EQLowShelf:
+                    b0 = a * ((a + 1) - (a - 1) * cos_w0 + sqrt_a2);
+                    b1 = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+                    b2 = a * ((a + 1) - (a - 1) * cos_w0 - sqrt_a2);
+                    a0 = (a + 1) + (a - 1) * cos_w0 + sqrt_a2;
+                    a1 = -2 * ((a - 1) + (a + 1) * cos_w0);
+                    a2 = (a + 1) + (a - 1) * cos_w0 - sqrt_a2;
+                    break;
+                case EQHighShelf:
+                    b0 = a * ((a + 1) + (a - 1) * cos_w0 + sqrt_a2);
+                    b1 = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+                    b2 = a * ((a + 1) + (a - 1) * cos_w0 - sqrt_a2);
+                    a0 = (a + 1) - (a - 1) * cos_w0 + sqrt_a2;
+                    a1 = 2 * ((a - 1) - (a + 1) * cos_w0);
+                    a2 = (a + 1) - (a - 1) * cos_w0 - sqrt_a2;
+                    break;
+                case EQLowPass:
+                    b0 = (1 - cos_w0) / 2;
+                    b1 = 1 - cos_w0;
+                    b2 = b0;
+                    a0 = 1 + alpha;
+                    a1 = -2 * cos_w0;
+                    a2 = 1 - alpha;
+                    break;
+                case EQHighPass:
+                    b0 = (1 + cos_w0) / 2;
+                    b1 = -(1 + cos_w0);
+                    b2 = b0;
+                    a0 = 1 + alpha;
+                    a1 = -2 * cos_w0;
+                    a2 = 1 - alpha;
+                    break;
+                default:
+                    b0 = 1 + alpha * a;
+                    b1 = -2 * cos_w0;
+                    b2 = 1 - alpha * a;
+                    a0 = 1 + alpha / a;
+                    a1 = -2 * cos_w0;
+                    a2 = 1 - alpha / a;
+                    break;
+            }
+            result.b0 = b0 / a0;
+            result.b1 = b1 / a0;
+            result.b2 = b2 / a0;
+            result.a1 = a1 / a0;
+            result.a2 = a2 / a0;
+            return result;
+        }
+
+        /// Moves the actual coefficients one step to the target
+        void updateRamp(BandState &bs){
+            if (bs.ramp_steps==0) return;
+            if (--bs.ramp_steps==0){
+                bs.actual = bs.target;
+            } else {
+                bs.actual.b0 += bs.step.b0;
+                bs.actual.b1 += bs.step.b1;
+                bs.actual.b2 += bs.step.b2;
+                bs.actual.a1 += bs.step.a1;
+                bs.actual.a2 += bs.step.a2;
+            }
+        }
+
+        void filterSamples(uint8_t *data, size_t len){
+            if (cfg.use_float){
+                filterSamples((float*)data, len / sizeof(float));
+                return;
+            }
+            switch(cfg.bits_per_sample){
+                case 16: 
+                    filterSamples<int16_t>((int16_t*)data, len / sizeof(int16_t), 32767.0f);
+                    break;
+                case 32: 
+                    filterSamples<int32_t>((int32_t*)data, len / sizeof(int32_t), 2147483647.0f);
+                    break;
+                default: 
+                    LOGE("Only 16 and 32 bits supported: %d", cfg.bits_per_sample);
+                    break;
+            }
+        }
+
+        template <typename T>
+        void filterSamples(T *data, size_t sampleCount, float maxValue){
+            if (block.size()==0) return;
+            const int channels = cfg.channels;
+            size_t frames = sampleCount / channels;
+            float *buffer = block.data();
+            for (size_t pos = 0; pos < frames; pos += cfg.block_frames){
+                size_t n = min(frames - pos, (size_t) cfg.block_frames);
+                T *samples = data + pos * channels;
+                if (!updateBands()) continue;
+                for (size_t j=0;j<n*channels;j++) buffer[j] = samples[j];
+                filterBlock(buffer, n);
+                // convert back and clip the result
+                for (size_t j=0;j<n*channels;j++){
+                    float value = buffer[j];
+                    if (value>maxValue) value = maxValue;
+                    else if (value<-maxValue) value = -maxValue;
+                    samples[j] = value;
+                }
+            }
+        }
+
+        /// float samples are filtered in place without any conversion
+        void filterSamples(float *data, size_t sampleCount){
+            const int channels = cfg.channels;
+            size_t frames = sampleCount / channels;
+            for (size_t pos = 0; pos < frames; pos += cfg.block_frames){
+                size_t n = min(frames - pos, (size_t) cfg.block_frames);
+                if (updateBands()) filterBlock(data + pos * channels, n);
+            }
+        }
+
+        /// Moves all ramps one block forward: returns false if all bands are bypassed
+        bool updateBands(){
+            bool is_active = false;
+            for (int b=0;b<EQ_MAX_BANDS;b++){
+                BandState &bs = bands[b];
+                updateRamp(bs);
+                if (!(bs.bypass && bs.ramp_steps==0)) is_active = true;
+            }
+            return is_active;
+        }
+
+        /// Applies the active bands to n frames of interleaved float data
+        void filterBlock(float *buffer, size_t n){
+            const int channels = cfg.channels;
+            for (int b=0;b<EQ_MAX_BANDS;b++){
+                BandState &bs = bands[b];
+                if (bs.bypass && bs.ramp_steps==0) continue;
+                float *s = state.data() + b * channels * 4;
+                if (channels==2){
+                    processStereo(bs.actual, s, buffer, n);
+                } else {
+                    for (int ch=0;ch<channels;ch++){
+                        process(bs.actual, s + ch * 4, buffer + ch, n, channels);
+                    }
+                }
+            }
+        }
+
+        /// Direct form 1 biquad for one channel
+        void process(Coefficients &c, float *s, float *data, size_t n, int stride){
+            float x1 = s[0], x2 = s[1], y1 = s[2], y2 = s[3];
+            for (size_t j=0;j<n;j++){
+                float x0 = data[j * stride];
+                // y1 is added last so that it is not part of the critical path
+                float y0 = (c.b0 * x0 + c.b1 * x1 + c.b2 * x2 - c.a2 * y2) - c.a1 * y1;
+                x2 = x1;
+                x1 = x0;
+                y2 = y1;
+                y1 = y0;
+                data[j * stride] = y0;
+            }
+            saveState(s, x1, x2, y1, y2);
+        }
+
+        /// Direct form 1 biquad for both channels in one loop: the two channels are
+        /// the lanes of a vector if SIMD is available
+        void processStereo(Coefficients &c, float *s, float *data, size_t n){
+#if defined(USE_SIMD_SSE2)
+            const __m128 b0 = _mm_set1_ps(c.b0), b1 = _mm_set1_ps(c.b1), b2 = _mm_set1_ps(c.b2);
+            const __m128 a1 = _mm_set1_ps(c.a1), a2 = _mm_set1_ps(c.a2);
+            __m128 x1 = _mm_setr_ps(s[0], s[4], 0, 0), x2 = _mm_setr_ps(s[1], s[5], 0, 0);
+            __m128 y1 = _mm_setr_ps(s[2], s[6], 0, 0), y2 = _mm_setr_ps(s[3], s[7], 0, 0);
+            for (size_t j=0;j<n;j++){
+                __m128 x0 = _mm_castpd_ps(_mm_load_sd((const double*)(data + 2 * j)));
+                __m128 t = _mm_add_ps(_mm_mul_ps(b0, x0), _mm_mul_ps(b1, x1));
+                t = _mm_sub_ps(_mm_add_ps(t, _mm_mul_ps(b2, x2)), _mm_mul_ps(a2, y2));
+                __m128 y0 = _mm_sub_ps(t, _mm_mul_ps(a1, y1));
+                x2 = x1;
+                x1 = x0;
+                y2 = y1;
+                y1 = y0;
+                _mm_store_sd((double*)(data + 2 * j), _mm_castps_pd(y0));
+            }
+            float tmp[4][4];
+            _mm_storeu_ps(tmp[0], x1);
+            _mm_storeu_ps(tmp[1], x2);
+            _mm_storeu_ps(tmp[2], y1);
+            _mm_storeu_ps(tmp[3], y2);
+            saveState(s, tmp[0][0], tmp[1][0], tmp[2][0], tmp[3][0]);
+            saveState(s + 4, tmp[0][1], tmp[1][1], tmp[2][1], tmp[3][1]);
+#elif defined(USE_SIMD_NEON)
+            const float32x2_t b0 = vdup_n_f32(c.b0), b1 = vdup_n_f32(c.b1), b2 = vdup_n_f32(c.b2);
+            const float32x2_t a1 = vdup_n_f32(c.a1), a2 = vdup_n_f32(c.a2);
+            float init[4][2] = {{s[0], s[4]}, {s[1], s[5]}, {s[2], s[6]}, {s[3], s[7]}};
+            float32x2_t x1 = vld1_f32(init[0]), x2 = vld1_f32(init[1]);
+            float32x2_t y1 = vld1_f32(init[2]), y2 = vld1_f32(init[3]);
+            for (size_t j=0;j<n;j++){
+                float32x2_t x0 = vld1_f32(data + 2 * j);
+                float32x2_t t = vmla_f32(vmul_f32(b0, x0), b1, x1);
+                t = vmls_f32(vmla_f32(t, b2, x2), a2, y2);
+                float32x2_t y0 = vmls_f32(t, a1, y1);
+                x2 = x1;
+                x1 = x0;
+                y2 = y1;
+                y1 = y0;
+                vst1_f32(data + 2 * j, y0);
+            }
+            vst1_f32(init[0], x1);
+            vst1_f32(init[1], x2);
+            vst1_f32(init[2], y1);
+            vst1_f32(init[3], y2);
+            saveState(s, init[0][0], init[1][0], init[2][0], init[3][0]);
+            saveState(s + 4, init[0][1], init[1][1], init[2][1], init[3][1]);
+#else
+            const float b0 = c.b0, b1 = c.b1, b2 = c.b2, a1 = c.a1, a2 = c.a2;
+            float lx1 = s[0], lx2 = s[1], ly1 = s[2], ly2 = s[3];
+            float rx1 = s[4], rx2 = s[5], ry1 = s[6], ry2 = s[7];
+            for (size_t j=0;j<n;j++){
+                float lx0 = data[2 * j];
+                float rx0 = data[2 * j + 1];
+                float ly0 = (b0 * lx0 + b1 * lx1 + b2 * lx2 - a2 * ly2) - a1 * ly1;
+                float ry0 = (b0 * rx0 + b1 * rx1 + b2 * rx2 - a2 * ry2) - a1 * ry1;
+                lx2 = lx1;
+                lx1 = lx0;
+                ly2 = ly1;
+                ly1 = ly0;
+                rx2 = rx1;
+                rx1 = rx0;
+                ry2 = ry1;
+                ry1 = ry0;
+                data[2 * j] = ly0;
+                data[2 * j + 1] = ry0;
+            }
+            saveState(s, lx1, lx2, ly1, ly2);
+            saveState(s + 4, rx1, rx2, ry1, ry2);
+#endif
+        }
+
+        /// Saves the state: very small values are set to 0 to avoid denormals
+        inline void saveState(float *s, float x1, float x2, float y1, float y2){
+            s[0] = x1;
+            s[1] = x2;
+            s[2] = fabsf(y1) < 1e-15f ? 0.0f : y1;
+            s[3] = fabsf(y2) < 1e-15f ? 0.0f : y2;
+        }
+};
+
+} // namespace
@@ -16,6 +16,27 @@ class Filter {
   Filter() = default;
   virtual ~Filter() = default;
   virtual T process(T in) = 0;
+
+  /// Processes n samples which are stored with the indicated distance (e.g.
+  /// the number of channels for interleaved data): in and out can be the same
+  virtual void processBlock(const T *in, T *out, size_t n, size_t stride = 1) {
+    for (size_t j = 0; j < n; j++) {
+      out[j * stride] = process(in[j * stride]);
+    }
+  }
+
+  /// Processes interleaved stereo data in one pass: this filter is used for
+  /// the left and the indicated filter for the right channel. Returns false if
+  /// the combination is not supported: then the channels need to be processed
+  /// separately with processBlock()
+  virtual bool processBlockStereo(Filter<T> &right, const T *in, T *out,
+                                  size_t frames) {
+    return false;
+  }
+
+  /// Identifies the filter class, so that we can combine filters of the same
+  /// class in processBlockStereo()
+  virtual const void *classId() { return nullptr; }
 };
 
 /**
@@ -25,11 +46,66 @@ class Filter {
  * @tparam T
  */
 template <typename T>
-class NoFilter : Filter<T> {
+class NoFilter : public Filter<T> {
  public:
   // construct without coefs
   NoFilter() = default;
   virtual T process(T in){return in;}
+  void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override {
+    if (in == out) return;
+    for (size_t j = 0; j < n; j++) out[j * stride] = in[j * stride];
+  }
+};
+
+/**
+ * @brief Delay line which stores each value twice, so that the last len values
+ * are always available as contiguous array (newest value first): this way the
+ * filter loops do not need to deal with the wrap around.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <typename T>
+class FilterDelayLine {
+ public:
+  FilterDelayLine(size_t len) : len(len) {
+    if (len > 0) data = new T[2 * len]();
+  }
+  ~FilterDelayLine() { delete[] data; }
+
+  /// Adds a new value
+  inline void push(T value) {
+    if (len == 0) return;
+    pos = pos == 0 ? len - 1 : pos - 1;
+    data[pos] = value;
+    data[pos + len] = value;
+  }
+
+  /// The last len values: index 0 is the newest value
+  inline const T *values() const { return data + pos; }
+
+  /// Scalar product of the last values with the coefficients
+  inline T dot(const T *coef) const {
+    const T *px = data + pos;
+    // independent partial sums so that the compiler can pipeline/vectorize
+    T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    size_t len4 = len - (len % 4);
+    size_t i = 0;
+    for (; i < len4; i += 4) {
+      sum0 += coef[i] * px[i];
+      sum1 += coef[i + 1] * px[i + 1];
+      sum2 += coef[i + 2] * px[i + 2];
+      sum3 += coef[i + 3] * px[i + 3];
+    }
+    for (; i < len; i++) {
+      sum0 += coef[i] * px[i];
+    }
+    return (sum0 + sum1) + (sum2 + sum3);
+  }
+
+ protected:
+  const size_t len;
+  size_t pos = 0;
+  T *data = nullptr;
 };
 
 /**
@@ -44,28 +120,63 @@ template <typename T>
 class FIR : public Filter<T> {
   public:
     template  <size_t B>
-    FIR(const T (&b)[B], const T factor=1.0) : lenB(B), factor(factor) {
-      x = new T[lenB]();
-      coeff_b = new T[2*lenB-1];
-      for (uint16_t i = 0; i < 2*lenB-1; i++) {
-        coeff_b[i] = b[(2*lenB - 1 - i)%lenB];
-      } 
+    FIR(const T (&b)[B], const T factor=1.0) : FIR(PointerTag(), b, B, factor) {}
+
+    /// Creates a filter for coefficients with a length which is only known at runtime
+    static FIR<T> *fromPointer(const T *b, size_t len, const T factor=1.0) {
+      return new FIR<T>(PointerTag(), b, len, factor);
     }
+
     ~FIR() {
-      delete[] x;
       delete[] coeff_b;
     }
     T process(T value) {
-      x[i_b] = value;
-      T b_terms = 0;
-      T *b_shift = &coeff_b[lenB - i_b - 1];
-      for (uint8_t i = 0; i < lenB; i++) {
-        b_terms += b_shift[i] * x[i] ; 
+      x.push(value);
+      return scale(x.dot(coeff_b));
+    }
+
+    void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override {
+      for (size_t j = 0; j < n; j++) {
+        x.push(in[j * stride]);
+        out[j * stride] = scale(x.dot(coeff_b));
+      }
+    }
+
+    bool processBlockStereo(Filter<T> &right, const T *in, T *out, size_t frames) override {
+      if (right.classId() != classId()) return false;
+      FIR<T> &r = static_cast<FIR<T> &>(right);
+      if (r.lenB != lenB) return false;
+      for (size_t j = 0; j < frames; j++) {
+        x.push(in[2 * j]);
+        r.x.push(in[2 * j + 1]);
+        out[2 * j] = scale(x.dot(coeff_b));
+        out[2 * j + 1] = r.scale(r.x.dot(r.coeff_b));
       }
-      i_b++;
-      if(i_b == lenB)
-        i_b = 0;
+      return true;
+    }
+
+    const void *classId() override {
+      static const char id = 0;
+      return &id;
+    }
 
+  private:
+    const size_t lenB;
+    FilterDelayLine<T> x;
+    T *coeff_b;
+    T factor;
+
+    /// distinguishes the pointer from the array constructor
+    struct PointerTag {};
+
+    FIR(PointerTag, const T *b, size_t len, const T factor) : lenB(len), x(len), factor(factor) {
+      coeff_b = new T[lenB];
+      for (size_t i = 0; i < lenB; i++) {
+        coeff_b[i] = b[i];
+      } 
+    }
+
+    inline T scale(T b_terms) {
 #ifdef USE_TYPETRAITS
       if (!(std::is_same<T, float>::value || std::is_same<T, double>::value)) {
         b_terms = b_terms / factor;
@@ -77,12 +188,6 @@ class FIR : public Filter<T> {
 #endif
       return b_terms;
     }
-  private:
-    const uint8_t lenB;
-    uint8_t i_b = 0;
-    T *x;
-    T *coeff_b;
-    T factor;
 };
 
 
@@ -97,50 +202,48 @@ template <typename T>
 class IIR : public Filter<T> {
  public:
   template <size_t B, size_t A>
-  IIR(const T (&b)[B], const T (&_a)[A], T factor=1.0) : factor(factor), lenB(B), lenA(A - 1) {
-    x = new T[lenB]();
-    y = new T[lenA]();
-    coeff_b = new T[2 * lenB - 1];
-    coeff_a = new T[2 * lenA - 1];
+  IIR(const T (&b)[B], const T (&_a)[A], T factor=1.0) : factor(factor), lenB(B), lenA(A - 1), x(B), y(A - 1) {
+    coeff_b = new T[lenB];
+    coeff_a = new T[lenA > 0 ? lenA : 1];
     T a0 = _a[0];
-    const T *a = &_a[1];
-    for (uint16_t i = 0; i < 2 * lenB - 1; i++) {
-      coeff_b[i] = b[(2 * lenB - 1 - i) % lenB] / a0;
+    for (size_t i = 0; i < lenB; i++) {
+      coeff_b[i] = b[i] / a0;
     }
-    for (uint16_t i = 0; i < 2 * lenA - 1; i++) {
-      coeff_a[i] = a[(2 * lenA - 2 - i) % lenA] / a0;
+    for (size_t i = 0; i < lenA; i++) {
+      coeff_a[i] = _a[i + 1] / a0;
     }
   }
 
   ~IIR() {
-    delete[] x;
-    delete[] y;
     delete[] coeff_a;
     delete[] coeff_b;
   }
 
   T process(T value) {
-    x[i_b] = value;
-    T b_terms = 0;
-    T *b_shift = &coeff_b[lenB - i_b - 1];
-
-    T a_terms = 0;
-    T *a_shift = &coeff_a[lenA - i_a - 1];
+    x.push(value);
+    T filtered = x.dot(coeff_b) - y.dot(coeff_a);
+    y.push(filtered);
+    return scale(filtered);
+  }
 
-    for (uint8_t i = 0; i < lenB; i++) {
-      b_terms += x[i] * b_shift[i];
-    }
-    for (uint8_t i = 0; i < lenA; i++) {
-      a_terms += y[i] * a_shift[i];
+  void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override {
+    for (size_t j = 0; j < n; j++) {
+      x.push(in[j * stride]);
+      T filtered = x.dot(coeff_b) - y.dot(coeff_a);
+      y.push(filtered);
+      out[j * stride] = scale(filtered);
     }
+  }
 
-    T filtered = b_terms - a_terms;
-    y[i_a] = filtered;
-    i_b++;
-    if (i_b == lenB) i_b = 0;
-    i_a++;
-    if (i_a == lenA) i_a = 0;
+ private:
+  T factor;
+  const size_t lenB, lenA;
+  FilterDelayLine<T> x;
+  FilterDelayLine<T> y;
+  T *coeff_b;
+  T *coeff_a;
 
+  inline T scale(T filtered) {
 #ifdef USE_TYPETRAITS
     if (!(std::is_same<T, float>::value || std::is_same<T, double>::value)) {
       filtered = filtered / factor;
@@ -152,15 +255,6 @@ class IIR : public Filter<T> {
 #endif
     return filtered;
   }
-
- private:
-  T factor;
-  const uint8_t lenB, lenA;
-  uint8_t i_b = 0, i_a = 0;
-  T *x;
-  T *y;
-  T *coeff_b;
-  T *coeff_a;
 };
 
 /**
@@ -206,6 +300,61 @@ class BiQuadDF1 : public Filter<T> {
     return y_1;
   }
 
+  void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override {
+    // keep the state in local variables
+    T x0 = x_0, x1 = x_1, y1 = y_1, y2 = y_2;
+    for (size_t j = 0; j < n; j++) {
+      T x2 = x1;
+      x1 = x0;
+      x0 = in[j * stride];
+      T y0 = x0 * b_0 + x1 * b_1 + x2 * b_2 - y1 * a_1 - y2 * a_2;
+      y2 = y1;
+      y1 = y0;
+      out[j * stride] = y0;
+    }
+    x_0 = x0;
+    x_1 = x1;
+    y_1 = y1;
+    y_2 = y2;
+  }
+
+  bool processBlockStereo(Filter<T> &right, const T *in, T *out, size_t frames) override {
+    if (right.classId() != classId()) return false;
+    BiQuadDF1<T> &r = static_cast<BiQuadDF1<T> &>(right);
+    // the two channels are independent, so the cpu can overlap the calculations
+    T lx0 = x_0, lx1 = x_1, ly1 = y_1, ly2 = y_2;
+    T rx0 = r.x_0, rx1 = r.x_1, ry1 = r.y_1, ry2 = r.y_2;
+    for (size_t j = 0; j < frames; j++) {
+      T lx2 = lx1, rx2 = rx1;
+      lx1 = lx0;
+      rx1 = rx0;
+      lx0 = in[2 * j];
+      rx0 = in[2 * j + 1];
+      T ly0 = lx0 * b_0 + lx1 * b_1 + lx2 * b_2 - ly1 * a_1 - ly2 * a_2;
+      T ry0 = rx0 * r.b_0 + rx1 * r.b_1 + rx2 * r.b_2 - ry1 * r.a_1 - ry2 * r.a_2;
+      ly2 = ly1;
+      ly1 = ly0;
+      ry2 = ry1;
+      ry1 = ry0;
+      out[2 * j] = ly0;
+      out[2 * j + 1] = ry0;
+    }
+    x_0 = lx0;
+    x_1 = lx1;
+    y_1 = ly1;
+    y_2 = ly2;
+    r.x_0 = rx0;
+    r.x_1 = rx1;
+    r.y_1 = ry1;
+    r.y_2 = ry2;
+    return true;
+  }
+
+  const void *classId() override {
+    static const char id = 0;
+    return &id;
+  }
+
  private:
   const T b_0;
   const T b_1;
@@ -261,6 +410,45 @@ class BiQuadDF2 : public Filter<T> {
     return y;
   }
 
+  void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override {
+    // keep the state in local variables
+    T w0 = w_0, w1 = w_1;
+    for (size_t j = 0; j < n; j++) {
+      T w2 = w1;
+      w1 = w0;
+      w0 = in[j * stride] - a_1 * w1 - a_2 * w2;
+      out[j * stride] = b_0 * w0 + b_1 * w1 + b_2 * w2;
+    }
+    w_0 = w0;
+    w_1 = w1;
+  }
+
+  bool processBlockStereo(Filter<T> &right, const T *in, T *out, size_t frames) override {
+    if (right.classId() != classId()) return false;
+    BiQuadDF2<T> &r = static_cast<BiQuadDF2<T> &>(right);
+    // the two channels are independent, so the cpu can overlap the calculations
+    T lw0 = w_0, lw1 = w_1, rw0 = r.w_0, rw1 = r.w_1;
+    for (size_t j = 0; j < frames; j++) {
+      T lw2 = lw1, rw2 = rw1;
+      lw1 = lw0;
+      rw1 = rw0;
+      lw0 = in[2 * j] - a_1 * lw1 - a_2 * lw2;
+      rw0 = in[2 * j + 1] - r.a_1 * rw1 - r.a_2 * rw2;
+      out[2 * j] = b_0 * lw0 + b_1 * lw1 + b_2 * lw2;
+      out[2 * j + 1] = r.b_0 * rw0 + r.b_1 * rw1 + r.b_2 * rw2;
+    }
+    w_0 = lw0;
+    w_1 = lw1;
+    r.w_0 = rw0;
+    r.w_1 = rw1;
+    return true;
+  }
+
+  const void *classId() override {
+    static const char id = 0;
+    return &id;
+  }
+
  private:
   const T b_0;
   const T b_1;
@@ -321,13 +509,36 @@ class SOSFilter : public Filter<T>
     }
     T process(T value)
     {
-        for (Filter<T> *&filter : filters)
-            value = filter->filter(value);
+        for (BiQuadDF2<T> *&filter : filters)
+            value = filter->process(value);
         return value;
     }
 
+    /// Processes the whole block section by section
+    void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override
+    {
+        for (size_t i = 0; i < N; i++) {
+            filters[i]->processBlock(i == 0 ? in : out, out, n, stride);
+        }
+    }
+
+    bool processBlockStereo(Filter<T> &right, const T *in, T *out, size_t frames) override
+    {
+        if (right.classId() != classId()) return false;
+        SOSFilter<T, N> &r = static_cast<SOSFilter<T, N> &>(right);
+        for (size_t i = 0; i < N; i++) {
+            filters[i]->processBlockStereo(*r.filters[i], i == 0 ? in : out, out, frames);
+        }
+        return true;
+    }
+
+    const void *classId() override {
+        static const char id = 0;
+        return &id;
+    }
+
   private:
-    Filter<T> *filters[N];
+    BiQuadDF2<T> *filters[N];
     template <size_t M>
     void copy(T (&dest)[M], const T *src) {
         for (size_t i = 0; i < M; i++)
@@ -361,6 +572,21 @@ class FilterChain : public Filter<T> {
         return value;
     }
 
+    /// Processes the whole block filter by filter
+    void processBlock(const T *in, T *out, size_t n, size_t stride = 1) override
+    {
+        const T *src = in;
+        for (Filter<T> *&filter : filters) {
+            if (filter!=nullptr){
+              filter->processBlock(src, out, n, stride);
+              src = out;
+            }
+        }
+        if (src != out) {
+            for (size_t j = 0; j < n; j++) out[j * stride] = in[j * stride];
+        }
+    }
+
   private:
     Filter<T> *filters[N] = {0};
 };
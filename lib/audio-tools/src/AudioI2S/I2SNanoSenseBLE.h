@@ -12,6 +12,21 @@ namespace audio_tools {
 
 const int i2s_buffer_size = 1024;
 NBuffer<uint8_t> i2s_buffer(i2s_buffer_size, 5);
+// output if there is no data and input if all blocks are in use
+uint8_t i2s_silence[i2s_buffer_size] = {0};
+uint8_t i2s_overflow[i2s_buffer_size];
+
+/// Next block which is output: silence if there is no data
+inline uint32_t i2sTxPointer() {
+  uint8_t *result = i2s_buffer.readEnd();
+  return (uint32_t) (result != nullptr ? result : i2s_silence);
+}
+
+/// Next block which receives the input: it is dropped if all blocks are in use
+inline uint32_t i2sRxPointer() {
+  uint8_t *result = i2s_buffer.writeEnd();
+  return (uint32_t) (result != nullptr ? result : i2s_overflow);
+}
 
 /**
  *  @brief Mapping Frequency constants to available frequencies
@@ -64,12 +79,12 @@ const Nano_BLE_ratio_info ratio_table[] = {
 extern "C" void I2S_IRQHandler(void) {
     if(NRF_I2S->EVENTS_TXPTRUPD != 0) {
       // reading from buffer to pins
-      NRF_I2S->TXD.PTR = (uint32_t) i2s_buffer.readEnd().address(); // last buffer was processed
+      NRF_I2S->TXD.PTR = i2sTxPointer(); // last buffer was processed
       NRF_I2S->EVENTS_TXPTRUPD = 0;
 
     } else if(NRF_I2S->EVENTS_RXPTRUPD != 0) {
       // reading from pins writing to buffer
-      NRF_I2S->RXD.PTR = (uint32_t) i2s_buffer.writeEnd().address(); // last buffer was processed
+      NRF_I2S->RXD.PTR = i2sRxPointer(); // last buffer was processed
       NRF_I2S->EVENTS_RXPTRUPD = 0;
     }
 } 
@@ -262,8 +277,8 @@ class I2SBase {
     // setup initial data pointers
     void setupData(I2SConfig cfg) {
         LOGD(LOG_METHOD);
-        NRF_I2S->TXD.PTR = (uint32_t) i2s_buffer.readEnd().address(); // last buffer was processed
-        NRF_I2S->RXD.PTR = (uint32_t) i2s_buffer.writeEnd().address(); // last buffer was processed
+        NRF_I2S->TXD.PTR = i2sTxPointer(); // last buffer was processed
+        NRF_I2S->RXD.PTR = i2sRxPointer(); // last buffer was processed
         NRF_I2S->RXTXD.MAXCNT = i2s_buffer_size;
     }
 
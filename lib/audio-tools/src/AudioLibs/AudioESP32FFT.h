@@ -18,10 +18,17 @@ class FFTDriverESP32FFT : public FFTDriver {
         }
         void end()override{
             if (p_fft_object!=nullptr) fft_destroy(p_fft_object);
+            p_fft_object = nullptr;
         }
         void setValue(int idx, int value) override{
             p_fft_object->input[idx]  = value; 
         }
+        void setValue(int idx, float value) override{
+            p_fft_object->input[idx]  = value; 
+        }
+        void setValues(int pos, const float *values, int len) override {
+            memcpy(p_fft_object->input + pos, values, len * sizeof(float));
+        }
 
         void fft() override{
             fft_execute(p_fft_object);
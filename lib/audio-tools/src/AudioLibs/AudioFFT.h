@@ -3,6 +3,10 @@
 #include "AudioTools/AudioOutput.h"
 #include "AudioLibs/FFT/FFTWindows.h"
 
+#ifndef FFT_CHUNK_SIZE
+#define FFT_CHUNK_SIZE 64
+#endif
+
 namespace audio_tools {
 
 // forward declaration
@@ -38,9 +42,12 @@ struct AudioFFTConfig : public  AudioBaseInfo {
     /// Channel which is used as input
     uint8_t channel_used = 0; 
     int length=8192;
+    /// Number of new samples between 2 FFTs: if it is smaller then the length, the frames overlap
     int stride=0;
     /// Optional window function
     WindowFunction *window_function = nullptr;  
+    /// samples are float (see FloatFormatConverterStream)
+    bool use_float = false;
 };
 
 /**
@@ -50,16 +57,37 @@ struct AudioFFTConfig : public  AudioBaseInfo {
  */
 class FFTDriver {
     public:
+        virtual ~FFTDriver() = default;
         virtual void begin(int len) =0;
         virtual void end() =0;
         virtual void setValue(int pos, int value) =0;
         virtual void fft() = 0;
         virtual float magnitude(int idx) = 0;
         virtual bool isValid() = 0;
+
+        /// Returns true if the driver supports setValue(int, float), the access to the bins and the inverse FFT
+        virtual bool isInverseSupported() { return false; }
+        /// Defines a float input value for the fft()
+        virtual void setValue(int pos, float value) { setValue(pos, (int) value); }
+        /// Defines len float input values starting at pos
+        virtual void setValues(int pos, const float *values, int len) {
+            for (int j = 0; j < len; j++) setValue(pos + j, values[j]);
+        }
+        /// Provides the complex value of the bin (0 to len/2) after the fft()
+        virtual void getBin(int idx, float &real, float &img) { real = 0; img = 0; }
+        /// Defines the complex value of the bin (0 to len/2) for the ifft()
+        virtual void setBin(int idx, float real, float img) {}
+        /// Executes the inverse FFT of the bins which were defined with setBin()
+        virtual void ifft() {}
+        /// Provides the (scaled) time domain value after the ifft()
+        virtual float getValue(int pos) { return 0; }
 };
 
 /**
- * @brief Executes FFT using audio data. The Driver which is passed in the constructor selects a specifc FFT implementation
+ * @brief Executes FFT using audio data. The Driver which is passed in the constructor selects a specifc FFT implementation.
+ * The samples are passed to the driver in blocks and the window function is evaluated only once in begin(). 
+ * If a stride is defined, we keep the last length samples in a ring (STFT frame), so that the overlapping 
+ * samples do not need to be processed again.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -87,15 +115,14 @@ class AudioFFTBase : public AudioPrint {
                 LOGE("Len must be of the power of 2: %d", cfg.length);
                 return false;
             }
-            if (!createStrideBuffer()){
+            if (!createFrame()){
                 return false;
             }
             p_driver->begin(cfg.length);
-            if (cfg.window_function!=nullptr){
-                cfg.window_function->begin(cfg.length);
-            }
+            createWindow();
 
             current_pos = 0;
+            next_fft = cfg.length;
             return p_driver->isValid();
         }
 
@@ -110,8 +137,8 @@ class AudioFFTBase : public AudioPrint {
         /// Release the allocated memory
         void end() {
             p_driver->end();
-            if (p_stridebuffer!=nullptr) delete p_stridebuffer;
             if (p_magnitudes!=nullptr) delete []p_magnitudes;
+            p_magnitudes = nullptr;
         }
 
         /// Provide the audio data as FFT input
@@ -119,27 +146,14 @@ class AudioFFTBase : public AudioPrint {
             size_t result = 0;
             if (p_driver->isValid()){
                 result = len;
-                switch(cfg.bits_per_sample){
-                    case 16:
-                        processSamples<int16_t>(data, len);
-                        break;
-                    case 24:
-                        processSamples<int24_t>(data, len);
-                        break;
-                    case 32:
-                        processSamples<int32_t>(data, len);
-                        break;
-                    default:
-                        LOGE("Unsupported bits_per_sample: %d",cfg.bits_per_sample);
-                        break;
-                }
+                processData(data, len, cfg.channels, cfg.channel_used);
             }
             return result;
         }
 
         /// We try to fill the buffer at once
         int availableForWrite() {
-            return cfg.bits_per_sample/8*cfg.length;
+            return bytesPerSample()*cfg.length;
         }
 
         /// The number of bins used by the FFT which are relevant for the result
@@ -223,72 +237,148 @@ class AudioFFTBase : public AudioPrint {
         int current_pos = 0;
         AudioFFTConfig cfg;
         unsigned long timestamp=0l;
-        RingBuffer<uint8_t> *p_stridebuffer = nullptr;
+        // STFT frame with the last length samples: only used with a stride
+        Vector<float> frame{0};
+        int write_pos = 0;
+        // number of samples until the next fft
+        int next_fft = 0;
+        // first half of the (symmetric) window
+        Vector<float> window{0};
         float *p_magnitudes = nullptr;
 
-        /// Allocates the stride buffer if necessary
-        bool createStrideBuffer() {
-            bool result = true;
-            if (p_stridebuffer!=nullptr) delete p_stridebuffer;
-            p_stridebuffer = nullptr;
-            if (cfg.stride>0){
-                // calculate the number of last bytes that we need to reprocess 
-                int size = cfg.length - cfg.stride;
-                if (size>0){
-                    p_stridebuffer = new RingBuffer<uint8_t>(size*bytesPerSample());
-                } else {
-                    LOGE("stride>length not supported");
-                    result = false;
+        /// Allocates the STFT frame if necessary
+        bool createFrame() {
+            frame.resize(0);
+            write_pos = 0;
+            if (cfg.stride>cfg.length){
+                LOGE("stride>length not supported");
+                return false;
+            }
+            if (cfg.stride>0 && cfg.stride<cfg.length){
+                frame.resize(cfg.length);
+                for (int j=0;j<cfg.length;j++){
+                    frame[j] = 0.0f;
                 }
             }
-            return result;
+            return true;
         }
 
+        /// Precalculates the window function
+        void createWindow() {
+            window.resize(0);
+            if (cfg.window_function!=nullptr){
+                cfg.window_function->begin(cfg.length);
+                window.resize(cfg.length / 2);
+                for (int j=0;j<cfg.length/2;j++){
+                    window[j] = cfg.window_function->factor(j);
+                }
+            }
+        }
+
+        /// Number of new samples between 2 ffts
+        int hop() {
+            return frame.size()>0 ? cfg.stride : cfg.length;
+        }
+
+        /// Processes the indicated channel of the data
+        void processData(const uint8_t*data, size_t len, int channels, int channel) {
+            if (cfg.use_float){
+                processSamples<float>(data, len, channels, channel);
+                return;
+            }
+            switch(cfg.bits_per_sample){
+                case 16:
+                    processSamples<int16_t>(data, len, channels, channel);
+                    break;
+                case 24:
+                    processSamples<int24_t>(data, len, channels, channel);
+                    break;
+                case 32:
+                    processSamples<int32_t>(data, len, channels, channel);
+                    break;
+                default:
+                    LOGE("Unsupported bits_per_sample: %d",cfg.bits_per_sample);
+                    break;
+            }
+        }
 
-        // Add samples to input data p_x - and process them if full
+        // Add samples to input data - and process them if full
         template<typename T>
-        void processSamples(const void *data, size_t byteCount) {
-            T *dataT = (T*) data;
-            T sample;
-            float sample_windowed;
-            int samples = byteCount/sizeof(T);
-            for (int j=0; j<samples; j+=cfg.channels){
-                sample = dataT[j+cfg.channel_used];
-                sample_windowed = sample;
-                // optionally apply window function
-                if (cfg.window_function!=nullptr){
-                    sample_windowed = cfg.window_function->factor(current_pos) * sample;
+        void processSamples(const void *data, size_t byteCount, int channels, int channel) {
+            const T *dataT = (const T*) data + channel;
+            int frames = byteCount / sizeof(T) / channels;
+            float chunk[FFT_CHUNK_SIZE];
+            int j = 0;
+            while (j < frames) {
+                // process until the next fft
+                int n = min(frames - j, next_fft);
+                if (frame.size()==0){
+                    // we fill the driver directly
+                    for (int i = 0; i < n; i += FFT_CHUNK_SIZE){
+                        int len = min(n - i, FFT_CHUNK_SIZE);
+                        for (int k = 0; k < len; k++){
+                            chunk[k] = static_cast<float>(dataT[(j + i + k) * channels]);
+                        }
+                        setValues(current_pos, chunk, len);
+                        current_pos += len;
+                    }
+                } else {
+                    // we collect the samples in the STFT frame
+                    float *p_frame = frame.data();
+                    for (int i = 0; i < n; i++){
+                        p_frame[write_pos] = static_cast<float>(dataT[(j + i) * channels]);
+                        if (++write_pos == cfg.length) write_pos = 0;
+                    }
                 }
-                p_driver->setValue(current_pos, sample_windowed);
-                writeStrideBuffer((uint8_t*)&sample, sizeof(T));
-                if (++current_pos>=cfg.length){
+                j += n;
+                next_fft -= n;
+                if (next_fft == 0){
                     fft();
                 }
             }
         }
 
+        /// Passes the values to the driver and applies the window function: the values are changed!
+        void setValues(int pos, float *values, int len) {
+            if (window.size()>0){
+                const float *w = window.data();
+                const int half = cfg.length / 2;
+                for (int j = 0; j < len; j++){
+                    int idx = pos + j;
+                    values[j] *= w[idx < half ? idx : cfg.length - 1 - idx];
+                }
+            }
+            p_driver->setValues(pos, values, len);
+        }
+
+        /// Passes the STFT frame to the driver: the oldest sample is at the write position
+        void setFrameValues() {
+            float chunk[FFT_CHUNK_SIZE];
+            for (int pos = 0; pos < cfg.length; pos += FFT_CHUNK_SIZE){
+                int len = min(cfg.length - pos, FFT_CHUNK_SIZE);
+                for (int k = 0; k < len; k++){
+                    int idx = write_pos + pos + k;
+                    chunk[k] = frame[idx < cfg.length ? idx : idx - cfg.length];
+                }
+                setValues(pos, chunk, len);
+            }
+        }
+
         void fft() {
+            if (frame.size()>0){
+                setFrameValues();
+            }
             p_driver->fft();
             timestamp = millis();
             if (cfg.callback!=nullptr){
                 cfg.callback(*this);
             }
-
-            // reprocess data in stride buffer
-            if (p_stridebuffer!=nullptr){
-                // rewrite data in stride buffer
-                int byte_count = p_stridebuffer->available();
-                uint8_t buffer[byte_count];
-                p_stridebuffer->readArray(buffer, byte_count);
-                write(buffer, byte_count);
-                current_pos = byte_count / bytesPerSample();
-            } else {
-                current_pos = 0;
-            }
+            current_pos = 0;
+            next_fft = hop();
         }
 
         int bytesPerSample() {
-            return cfg.bits_per_sample / 8;
+            return cfg.use_float ? sizeof(float) : cfg.bits_per_sample / 8;
         }
 
         /// make sure that we do not reuse already found results
@@ -307,20 +397,6 @@ class AudioFFTBase : public AudioPrint {
             return false;
         }
 
-        void writeStrideBuffer(uint8_t* buffer, size_t len){
-            if (p_stridebuffer!=nullptr){
-                int available = p_stridebuffer->availableForWrite();
-                if (len>available){
-                    // clear oldest values to make space
-                    int diff = len-available;
-                    for(int j=0;j<diff;j++){
-                        p_stridebuffer->read();
-                    }
-                }
-                p_stridebuffer->writeArray(buffer, len);
-            }
-        }
-
         bool isPowerOfTwo(uint16_t x) {
             return (x & (x - 1)) == 0;
         }
@@ -0,0 +1,208 @@
+#pragma once
+#include "AudioFilter/Filter.h"
+#include "AudioLibs/AudioFFT.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Filter which convolves the signal with an arbitrary impulse response
+ * (e.g. room correction or steep crossover filters with many taps) using a
+ * uniformly partitioned overlap-save FFT convolution. The impulse response is
+ * split into partitions of blockSize samples, so the effort per sample is
+ * O(log(blockSize) + taps/blockSize) instead of O(taps) for the FIR filter.
+ *
+ * The output is delayed by blockSize samples. The FFT is executed by a
+ * FFTDriver which supports the inverse FFT (e.g. FFTDriverRealFFT or
+ * FFTDriverKissFFT). Like any other Filter it can be used in the
+ * FilteredStream:
+ *
+ * filtered.setFilter(0, new FFTConvolution(new FFTDriverRealFFT(), coef, 512));
+ *
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FFTConvolution : public Filter<float> {
+ public:
+  /// Constructor for an impulse response with the indicated number of taps:
+  /// the driver is deleted by the destructor; blockSize must be a power of 2
+  FFTConvolution(FFTDriver *driver, const float *ir, int len,
+                 int blockSize = 128) {
+    setup(driver, ir, len, blockSize);
+  }
+
+  ~FFTConvolution() {
+    if (p_driver != nullptr) {
+      p_driver->end();
+      delete p_driver;
+    }
+  }
+
+  /// Returns false if the driver does not support the convolution: the
+  /// input is then passed through unchanged
+  bool isValid() { return is_valid; }
+
+  /// Latency in samples
+  int latency() { return is_valid ? block_size : 0; }
+
+  /// Number of partitions of the impulse response
+  int partitions() { return partition_count; }
+
+  float process(float in) override {
+    if (!is_valid) return in;
+    float result = output[pos];
+    input[block_size + pos] = in;
+    if (++pos == block_size) processPartition();
+    return result;
+  }
+
+  void processBlock(const float *in, float *out, size_t n,
+                    size_t stride = 1) override {
+    if (!is_valid) {
+      if (in != out) {
+        for (size_t j = 0; j < n; j++) out[j * stride] = in[j * stride];
+      }
+      return;
+    }
+    size_t j = 0;
+    while (j < n) {
+      // copy until the end of the actual block
+      size_t len = min(n - j, (size_t)(block_size - pos));
+      float *p_in = input.data() + block_size + pos;
+      const float *p_out = output.data() + pos;
+      for (size_t i = 0; i < len; i++, j++) {
+        float value = in[j * stride];
+        out[j * stride] = p_out[i];
+        p_in[i] = value;
+      }
+      pos += len;
+      if (pos == block_size) processPartition();
+    }
+  }
+
+ protected:
+  FFTDriver *p_driver = nullptr;
+  int block_size = 0;
+  int fft_size = 0;
+  int bins = 0;
+  int partition_count = 0;
+  int pos = 0;
+  int fdl_pos = 0;
+  bool is_valid = false;
+  // previous and actual input block
+  Vector<float> input;
+  Vector<float> output;
+  // spectra of the partitions of the impulse response
+  Vector<float> ir_real;
+  Vector<float> ir_img;
+  // frequency domain delay line with the spectra of the last input frames
+  Vector<float> fdl_real;
+  Vector<float> fdl_img;
+  Vector<float> acc_real;
+  Vector<float> acc_img;
+
+  void setup(FFTDriver *driver, const float *ir, int len, int blockSize) {
+    p_driver = driver;
+    if (p_driver == nullptr || !p_driver->isInverseSupported()) {
+      LOGE("FFTConvolution: the FFTDriver does not support the inverse FFT");
+      return;
+    }
+    if (blockSize <= 0 || (blockSize & (blockSize - 1)) != 0) {
+      LOGE("FFTConvolution: blockSize must be a power of 2: %d", blockSize);
+      return;
+    }
+    block_size = blockSize;
+    fft_size = 2 * blockSize;
+    bins = blockSize + 1;
+    partition_count = (len + block_size - 1) / block_size;
+    if (partition_count == 0) partition_count = 1;
+    p_driver->begin(fft_size);
+    if (!p_driver->isValid()) {
+      LOGE("FFTConvolution: the FFTDriver could not be started");
+      return;
+    }
+
+    input.resize(fft_size);
+    output.resize(block_size);
+    ir_real.resize(partition_count * bins);
+    ir_img.resize(partition_count * bins);
+    fdl_real.resize(partition_count * bins);
+    fdl_img.resize(partition_count * bins);
+    acc_real.resize(bins);
+    acc_img.resize(bins);
+    for (int j = 0; j < fft_size; j++) input[j] = 0.0f;
+    for (int j = 0; j < block_size; j++) output[j] = 0.0f;
+    for (int j = 0; j < partition_count * bins; j++) {
+      fdl_real[j] = 0.0f;
+      fdl_img[j] = 0.0f;
+    }
+
+    // transform the zero padded partitions of the impulse response
+    for (int p = 0; p < partition_count; p++) {
+      for (int j = 0; j < fft_size; j++) {
+        int idx = p * block_size + j;
+        float value = j < block_size && idx < len ? ir[idx] : 0.0f;
+        p_driver->setValue(j, value);
+      }
+      p_driver->fft();
+      for (int k = 0; k < bins; k++) {
+        p_driver->getBin(k, ir_real[p * bins + k], ir_img[p * bins + k]);
+      }
+    }
+    is_valid = true;
+  }
+
+  /// Called when a new input block is complete: calculates the next output
+  /// block
+  void processPartition() {
+    pos = 0;
+
+    // spectrum of the last 2 input blocks
+    for (int j = 0; j < fft_size; j++) {
+      p_driver->setValue(j, input[j]);
+    }
+    p_driver->fft();
+    fdl_pos = fdl_pos == 0 ? partition_count - 1 : fdl_pos - 1;
+    float *x_real = fdl_real.data() + fdl_pos * bins;
+    float *x_img = fdl_img.data() + fdl_pos * bins;
+    for (int k = 0; k < bins; k++) {
+      p_driver->getBin(k, x_real[k], x_img[k]);
+    }
+
+    // multiply and accumulate: partition p is combined with the spectrum
+    // of the input from p blocks ago
+    float *a_real = acc_real.data();
+    float *a_img = acc_img.data();
+    for (int k = 0; k < bins; k++) {
+      a_real[k] = 0.0f;
+      a_img[k] = 0.0f;
+    }
+    for (int p = 0; p < partition_count; p++) {
+      int slot = (fdl_pos + p) % partition_count;
+      const float *xr = fdl_real.data() + slot * bins;
+      const float *xi = fdl_img.data() + slot * bins;
+      const float *hr = ir_real.data() + p * bins;
+      const float *hi = ir_img.data() + p * bins;
+      for (int k = 0; k < bins; k++) {
+        a_real[k] += xr[k] * hr[k] - xi[k] * hi[k];
+        a_img[k] += xr[k] * hi[k] + xi[k] * hr[k];
+      }
+    }
+
+    // back to the time domain: the first half contains the circular
+    // wrap around, so we keep the second half only
+    for (int k = 0; k < bins; k++) {
+      p_driver->setBin(k, a_real[k], a_img[k]);
+    }
+    p_driver->ifft();
+    for (int j = 0; j < block_size; j++) {
+      output[j] = p_driver->getValue(block_size + j);
+    }
+
+    // the actual block becomes the previous block
+    for (int j = 0; j < block_size; j++) {
+      input[j] = input[block_size + j];
+    }
+  }
+};
+
+}  // namespace audio_tools
@@ -6,26 +6,78 @@
 namespace audio_tools {
 
 /**
- * @brief Driver for RealFFT
+ * @brief Driver for KissFFT: the real input of length len is packed into a complex
+ * array of len/2 (the even samples are the real and the odd samples the imaginary 
+ * parts), so that we only need a complex FFT of half the size. The len/2+1 bins 
+ * are then separated with precalculated twiddle factors and the remaining bins
+ * are filled with their conjugates, so that we provide all len bins. 
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
 class FFTDriverKissFFT : public FFTDriver {
     public:
         void begin(int len) override {
-            if (p_fft_object==nullptr) p_fft_object = kiss_fft_alloc(len,0,nullptr,nullptr);
+            this->len = len;
+            half = len / 2;
+            if (p_fft_object==nullptr) p_fft_object = kiss_fft_alloc(half,0,nullptr,nullptr);
+            if (p_in==nullptr) p_in = new kiss_fft_cpx[half];
+            if (p_tmp==nullptr) p_tmp = new kiss_fft_cpx[half];
             if (p_data==nullptr) p_data = new kiss_fft_cpx[len];
+            if (p_twiddle==nullptr) {
+                p_twiddle = new kiss_fft_cpx[half];
+                for (int k = 0; k < half; k++){
+                    double phase = -2.0 * M_PI * k / len;
+                    p_twiddle[k].r = cos(phase);
+                    p_twiddle[k].i = sin(phase);
+                }
+            }
         }
         void end() override {
             if (p_fft_object!=nullptr) kiss_fft_free(p_fft_object);
+            if (p_inverse!=nullptr) kiss_fft_free(p_inverse);
+            if (p_in!=nullptr) delete[] p_in;
+            if (p_tmp!=nullptr) delete[] p_tmp;
             if (p_data!=nullptr) delete[] p_data;
+            if (p_twiddle!=nullptr) delete[] p_twiddle;
+            p_fft_object = nullptr;
+            p_inverse = nullptr;
+            p_in = nullptr;
+            p_tmp = nullptr;
+            p_data = nullptr;
+            p_twiddle = nullptr;
         }
         void setValue(int idx, int value) override {
-            p_data[idx].r  = value; 
+            input()[idx] = value; 
+        }
+        void setValue(int idx, float value) override {
+            input()[idx] = value; 
+        }
+        void setValues(int pos, const float *values, int len) override {
+            memcpy(input() + pos, values, len * sizeof(float));
         }
 
         void fft() override {
-            kiss_fft (p_fft_object, p_data, p_data);    
+            kiss_fft (p_fft_object, p_in, p_tmp);
+            // separate the spectra of the even (e) and odd (o) samples:
+            // X[k] = e[k] + w^k * o[k] 
+            p_data[0].r = p_tmp[0].r + p_tmp[0].i;
+            p_data[0].i = 0;
+            p_data[half].r = p_tmp[0].r - p_tmp[0].i;
+            p_data[half].i = 0;
+            for (int k = 1; k < half; k++){
+                kiss_fft_cpx a = p_tmp[k];
+                kiss_fft_cpx b = p_tmp[half - k];
+                float e_r = 0.5f * (a.r + b.r);
+                float e_i = 0.5f * (a.i - b.i);
+                float o_r = 0.5f * (a.i + b.i);
+                float o_i = -0.5f * (a.r - b.r);
+                kiss_fft_cpx w = p_twiddle[k];
+                p_data[k].r = e_r + w.r * o_r - w.i * o_i;
+                p_data[k].i = e_i + w.r * o_i + w.i * o_r;
+                // the spectrum of a real signal is conjugate symmetric
+                p_data[len - k].r = p_data[k].r;
+                p_data[len - k].i = -p_data[k].i;
+            }
         };
 
         float magnitude(int idx) override { 
@@ -34,8 +86,57 @@ class FFTDriverKissFFT : public FFTDriver {
 
         virtual bool isValid() override{ return p_fft_object!=nullptr; }
 
+        bool isInverseSupported() override { return true; }
+
+        void getBin(int idx, float &real, float &img) override {
+            real = p_data[idx].r;
+            img = p_data[idx].i;
+        }
+
+        /// The bins are 0 to len/2: the ifft() uses the conjugates of these for the others
+        void setBin(int idx, float real, float img) override {
+            p_data[idx].r = real;
+            p_data[idx].i = img;
+        }
+
+        void ifft() override {
+            if (p_inverse==nullptr) p_inverse = kiss_fft_alloc(half,1,nullptr,nullptr);
+            // combine the bins to the spectrum of the packed signal:
+            // e[k] = (X[k] + conj(X[n-k])) / 2, o[k] = (X[k] - conj(X[n-k])) * conj(w^k) / 2
+            for (int k = 0; k < half; k++){
+                kiss_fft_cpx a = p_data[k];
+                kiss_fft_cpx b = p_data[half - k];
+                float e_r = 0.5f * (a.r + b.r);
+                float e_i = 0.5f * (a.i - b.i);
+                float d_r = 0.5f * (a.r - b.r);
+                float d_i = 0.5f * (a.i + b.i);
+                kiss_fft_cpx w = p_twiddle[k];
+                float o_r = d_r * w.r + d_i * w.i;
+                float o_i = d_i * w.r - d_r * w.i;
+                // z = e + i * o
+                p_tmp[k].r = e_r - o_i;
+                p_tmp[k].i = e_i + o_r;
+            }
+            kiss_fft (p_inverse, p_tmp, p_in);
+        }
+
+        float getValue(int idx) override {
+            return input()[idx] / half;
+        }
+
         kiss_fft_cfg p_fft_object=nullptr;
-        kiss_fft_cpx *p_data = nullptr; // real
+        kiss_fft_cfg p_inverse=nullptr;
+        kiss_fft_cpx *p_in = nullptr; // packed real input
+        kiss_fft_cpx *p_tmp = nullptr;
+        kiss_fft_cpx *p_data = nullptr; // all len bins
+        kiss_fft_cpx *p_twiddle = nullptr;
+        int len = 0;
+        int half = 0;
+
+    protected:
+        float *input() {
+            return (float*) p_in;
+        }
 
 };
 /**
@@ -47,7 +148,7 @@ class AudioKissFFT : public AudioFFTBase {
     public:
         AudioKissFFT():AudioFFTBase(new FFTDriverKissFFT()) {}
 
-        /// Provides the complex array returned by the FFT  
+        /// Provides the complex array returned by the FFT with all length bins
         kiss_fft_cpx *dataArray() {
             return driverEx()->p_data;
         }
@@ -22,10 +22,19 @@ class FFTDriverRealFFT : public FFTDriver {
             if (p_fft_object!=nullptr) delete p_fft_object;
             if (p_x!=nullptr) delete[] p_x;
             if (p_f!=nullptr) delete[] p_f;
+            p_fft_object = nullptr;
+            p_x = nullptr;
+            p_f = nullptr;
         }
         void setValue(int idx, int value) override{
             p_x[idx] = value; 
         }
+        void setValue(int idx, float value) override{
+            p_x[idx] = value; 
+        }
+        void setValues(int pos, const float *values, int len) override {
+            memcpy(p_x + pos, values, len * sizeof(float));
+        }
 
         void fft() override{
             memset(p_f,0,len*sizeof(float));
@@ -33,11 +42,34 @@ class FFTDriverRealFFT : public FFTDriver {
         };
 
         float magnitude(int idx) override {
-            return sqrt(p_x[idx] * p_x[idx] + p_f[idx] * p_f[idx]);
+            float real, img;
+            getBin(idx, real, img);
+            return sqrt(real * real + img * img);
         }
 
         virtual bool isValid() override{ return p_fft_object!=nullptr; }
 
+        bool isInverseSupported() override { return true; }
+
+        /// p_f contains the real values followed by the negative imaginary values
+        void getBin(int idx, float &real, float &img) override {
+            real = p_f[idx];
+            img = idx == 0 || idx == len / 2 ? 0.0f : -p_f[len / 2 + idx];
+        }
+
+        void setBin(int idx, float real, float img) override {
+            p_f[idx] = real;
+            if (idx > 0 && idx < len / 2) p_f[len / 2 + idx] = -img;
+        }
+
+        void ifft() override {
+            p_fft_object->do_ifft(p_f, p_x);
+        }
+
+        float getValue(int idx) override {
+            return p_x[idx] / len;
+        }
+
         ffft::FFTReal <float> *p_fft_object=nullptr;
         float *p_x = nullptr; // real
         float *p_f = nullptr; // complex
@@ -52,7 +52,10 @@ struct ESPNowStreamConfig {
   uint16_t delay_after_write_ms = 2;
   uint16_t delay_after_failed_write_ms = 2000;
   uint16_t buffer_size = ESP_NOW_MAX_DATA_LEN;
-  uint16_t buffer_count = 400;
+  // the receive buffer is rounded up to a power of 2
+  uint16_t buffer_count = 256;
+  // what to do when the receive buffer is full: we never block the callback
+  OverflowPolicy overflow_policy = DropOldest;
   int write_retry_count = -1; // -1 endless
   void (*recveive_cb)(const uint8_t *mac_addr, const uint8_t *data,
                       int data_len) = nullptr;
@@ -210,7 +213,7 @@ class ESPNowStream : public AudioStreamX {
         // wait for confirmation
         if (cfg.use_send_ack) {
           while (available_to_write == 0) {
-            delay(1);
+            send_notifier.wait(1);
           }
         } else {
           is_write_ok = true;
@@ -244,7 +247,6 @@ class ESPNowStream : public AudioStreamX {
   /// Reeds the data from the peers
   size_t readBytes(uint8_t *data, size_t len) override {
     if (p_buffer == nullptr) return 0;
-    Lock lock(write_lock);
     return p_buffer->readArray(data, len);
   }
 
@@ -252,25 +254,58 @@ class ESPNowStream : public AudioStreamX {
     return p_buffer == nullptr ? 0 : p_buffer->available();
   }
 
+  /// Provides the received data w/o copying: this is not possible with
+  /// DropOldest because the receive callback might overwrite the data
+  uint8_t *peekSpan(size_t &len) override {
+    len = 0;
+    if (cfg.overflow_policy == DropOldest) return nullptr;
+    int span_len = 0;
+    uint8_t *result = p_buffer == nullptr ? nullptr : p_buffer->peekSpan(span_len);
+    len = span_len;
+    return result;
+  }
+
+  size_t commitRead(size_t len) override {
+    return p_buffer == nullptr ? 0 : p_buffer->commitRead(len);
+  }
+
   int availableForWrite() override {
     return cfg.use_send_ack ? available_to_write : cfg.buffer_size;
   }
 
+  /// Signals that we have received some data
+  AudioNotifier *dataNotifier() override { return &receive_notifier; }
+
+  /// Signals that a send has been confirmed
+  AudioNotifier *spaceNotifier() override { return &send_notifier; }
+
+  /// Number of received packets which did not fit into the receive buffer
+  uint32_t overflowCount() {
+    return p_buffer == nullptr ? 0 : p_buffer->overflowCount();
+  }
+
+  /// Number of received bytes which have been dropped
+  uint32_t droppedBytes() {
+    return p_buffer == nullptr ? 0 : p_buffer->droppedCount();
+  }
+
  protected:
   ESPNowStreamConfig cfg;
-  BaseBuffer<uint8_t> *p_buffer = nullptr;
+  LockFreeRingBuffer<uint8_t> *p_buffer = nullptr;
   esp_now_recv_cb_t receive = default_recv_cb;
   esp_now_send_cb_t send = default_send_cb;
   volatile size_t available_to_write;
+  AudioNotifier receive_notifier;
+  AudioNotifier send_notifier;
   bool is_init = false;
-  bool is_write_ok = false;
-  _lock_t write_lock;
+  volatile bool is_write_ok = false;
 
   inline void setupReceiveBuffer(){
     // setup receive buffer
     if (p_buffer == nullptr && cfg.buffer_count > 0) {
       // p_buffer = new NBuffer<uint8_t>(cfg.buffer_size , cfg.buffer_count);
-      p_buffer = new RingBuffer<uint8_t>(cfg.buffer_size * cfg.buffer_count);
+      p_buffer = new LockFreeRingBuffer<uint8_t>(
+          cfg.buffer_size * cfg.buffer_count, cfg.overflow_policy);
     }
   }
 
@@ -342,25 +377,18 @@ class ESPNowStream : public AudioStreamX {
     return (const char *)macStr;
   }
 
-  static int bufferAvailableForWrite() {
-    Lock lock(ESPNowStreamSelf->write_lock);
-    return ESPNowStreamSelf->p_buffer->availableForWrite();
-  }
-
   static void default_recv_cb(const uint8_t *mac_addr, const uint8_t *data,
                               int data_len) {                                
     LOGD("rec_cb: %d", data_len);
     // make sure that the receive buffer is available - moved from begin to make sure that it is only allocated when needed
     ESPNowStreamSelf->setupReceiveBuffer();
-    // blocking write
-    while (bufferAvailableForWrite() < data_len) {
-      delay(2);
-    }
-    Lock lock(ESPNowStreamSelf->write_lock);
+    // non blocking write: if the buffer is full we drop data according to the
+    // overflow_policy
     size_t result = ESPNowStreamSelf->p_buffer->writeArray(data, data_len);
     if (result!=data_len){
-      LOGE("writeArray %d -> %d", data_len, result);
+      LOGW("writeArray %d -> %d", data_len, result);
     }
+    ESPNowStreamSelf->receive_notifier.notify();
   }
 
   static void default_send_cb(const uint8_t *mac_addr,
@@ -376,12 +404,14 @@ class ESPNowStream : public AudioStreamX {
 
     // ignore others
     if (strncmp((char *)mac_addr, (char *)first_mac, ESP_NOW_KEY_LEN) == 0) {
-      ESPNowStreamSelf->available_to_write = ESPNowStreamSelf->cfg.buffer_size;
       if (status == ESP_NOW_SEND_SUCCESS) {
         ESPNowStreamSelf->is_write_ok = true;
       } else {
         ESPNowStreamSelf->is_write_ok = false;
       }
+      // release the waiting writer only after we have updated the status
+      ESPNowStreamSelf->available_to_write = ESPNowStreamSelf->cfg.buffer_size;
+      ESPNowStreamSelf->send_notifier.notify();
     }
   }
 };
@@ -536,6 +566,12 @@ class AudioSyncWriter : public AudioPrint {
  public:
   AudioSyncWriter(Stream &dest) { p_dest = &dest; }
 
+  /// If the destination provides a notifier we wait on it for the requests
+  AudioSyncWriter(AudioStream &dest) {
+    p_dest = &dest;
+    p_notifier = dest.dataNotifier();
+  }
+
   bool begin(AudioBaseInfo &info, AudioType type) {
     is_sync = true;
     AudioDataBegin begin;
@@ -575,13 +611,14 @@ class AudioSyncWriter : public AudioPrint {
 
  protected:
   Stream *p_dest;
+  AudioNotifier *p_notifier = nullptr;
   int available_to_write = 1024;
   bool is_sync;
 
   /// Waits for the data to be available
   void waitFor(int size) {
     while (p_dest->available() < size) {
-      delay(10);
+      AudioNotifier::waitOrDelay(p_notifier, 10);
     }
   }
 
@@ -611,7 +648,24 @@ class AudioSyncReader : public AudioStreamX {
     is_confirmer = isConfirmer;
   }
 
+  /// If the input provides a notifier we wait on it for new data
+  AudioSyncReader(AudioStream &in, EncodedAudioStream &out,
+                  bool isConfirmer = true)
+      : AudioSyncReader((Stream &)in, out, isConfirmer) {
+    p_notifier = in.dataNotifier();
+  }
+
+  /// Defines the arena from which we take the copy buffer
+  void setArena(ScratchArena &arena) { buffer.setArena(&arena); }
+
+  /// Allocates the copy buffer: this is done automatically with the default
+  /// size on the first copy()
+  bool setBufferSize(int bufferSize = DEFAULT_BUFFER_SIZE) {
+    return buffer.resize(bufferSize);
+  }
+
   size_t copy() {
+    if (buffer.size() == 0 && !setBufferSize()) return 0;
     int processed = 0;
     int header_size = sizeof(header);
     waitFor(header_size);
@@ -633,7 +687,9 @@ class AudioSyncReader : public AudioStreamX {
 
  protected:
   Stream *p_in;
+  AudioNotifier *p_notifier = nullptr;
   EncodedAudioStream *p_out;
+  ScratchBuffer<uint8_t> buffer;
   AudioConfirmDataToReceive req;
   AudioHeader header;
   AudioDataBegin begin;
@@ -667,9 +723,14 @@ class AudioSyncReader : public AudioStreamX {
     int max_gap = 10;
     if (data.seq > last_seq ||
         (data.seq < max_gap && last_seq >= (32767 - max_gap))) {
-      uint8_t buffer[available];
-      p_in->readBytes((uint8_t *)buffer, available);
-      p_out->write((const uint8_t *)buffer, available);
+      // copy the data in chunks of the size of our buffer
+      int open = available;
+      while (open > 0) {
+        int len = min(open, (int)buffer.size());
+        p_in->readBytes(buffer.data(), len);
+        p_out->write(buffer.data(), len);
+        open -= len;
+      }
       // only one reader should be used as confirmer
       if (is_confirmer) {
         requestData();
@@ -682,7 +743,7 @@ class AudioSyncReader : public AudioStreamX {
   /// Waits for the data to be available
   void waitFor(int size) {
     while (p_in->available() < size) {
-      delay(10);
+      AudioNotifier::waitOrDelay(p_notifier, 10);
     }
   }
 
@@ -30,7 +30,7 @@ class WindowFunction {
   }
 
   inline float ratio(int idx) {
-    return (static_cast<float>(idx) - 1.0 / samples_minus_1);
+    return static_cast<float>(idx) / samples_minus_1;
   }
 
   inline int samples() { return i_samples; }
@@ -57,6 +57,7 @@ class BufferedWindow : public WindowFunction {
   virtual void begin(int samples) {
     // process only if there is a change
     if (p_wf->samples() != samples) {
+      WindowFunction::begin(samples);
       p_wf->begin(samples);
       len = samples / 2;
       if (p_buffer != nullptr) delete[] p_buffer;
@@ -72,7 +73,7 @@ class BufferedWindow : public WindowFunction {
   }
 
   inline float factor(int idx) {
-    return idx < len ? p_buffer[idx] : p_buffer[i_samples - idx];
+    return idx < len ? p_buffer[idx] : p_buffer[i_samples - 1 - idx];
   }
 
  protected:
@@ -114,7 +115,7 @@ class Hann : public WindowFunction {
  public:
   Hann() = default;
   float factor(int idx) {
-    return 0.54 * (1.0 - cos(twoPi * ratio(idx)));
+    return 0.5 * (1.0 - cos(twoPi * ratio(idx)));
   }
 };
 
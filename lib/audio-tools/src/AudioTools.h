@@ -24,6 +24,7 @@
 #include "AudioTools/AudioOutput.h"
 #include "AudioTools/Resample.h"
 #include "AudioTools/AudioCopy.h"
+#include "AudioTools/AudioTracer.h"
 #include "AudioMetaData/MetaData.h"
 #include "AudioCodecs/AudioEncoded.h"
 #include "AudioCodecs/AudioCodecs.h"
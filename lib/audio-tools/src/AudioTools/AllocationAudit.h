@@ -0,0 +1,179 @@
+#pragma once
+#include "AudioConfig.h"
+#include "AudioBasic/AllocationCounter.h"
+#include "AudioTools/AudioLogger.h"
+
+/**
+ * On the desktop we replace the global memory management functions so that
+ * we can count all heap allocations (also the ones of the C libraries which
+ * are used by the codecs). Because we define the global functions, this file
+ * must be included by one translation unit only (usually the test sketch).
+ * On all other platforms we can only report the allocations which are
+ * recorded by the AllocationCounter of the audio-tools containers.
+ */
+#if defined(IS_DESKTOP) && !defined(NO_ALLOCATION_AUDIT_HOOKS)
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ALLOCATION_AUDIT_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ALLOCATION_AUDIT_ASAN
+#endif
+#endif
+
+namespace audio_tools {
+/// Global allocation counters which are updated by the memory hooks
+struct AllocationAuditCounters {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> releases{0};
+  std::atomic<uint64_t> bytes{0};
+  void add(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  void release() { releases.fetch_add(1, std::memory_order_relaxed); }
+};
+static AllocationAuditCounters allocation_audit_counters;
+}  // namespace audio_tools
+
+#if defined(__GLIBC__) && !defined(ALLOCATION_AUDIT_ASAN)
+// with glibc we hook malloc: this also covers new and delete
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+  audio_tools::allocation_audit_counters.add(size);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  audio_tools::allocation_audit_counters.add(n * size);
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  audio_tools::allocation_audit_counters.add(size);
+  if (ptr != nullptr) audio_tools::allocation_audit_counters.release();
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  if (ptr != nullptr) audio_tools::allocation_audit_counters.release();
+  __libc_free(ptr);
+}
+}
+#else
+// otherwise we can only hook the C++ memory management
+void *operator new(size_t size) {
+  audio_tools::allocation_audit_counters.add(size);
+  void *result = malloc(size == 0 ? 1 : size);
+  if (result == nullptr) throw std::bad_alloc();
+  return result;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  audio_tools::allocation_audit_counters.add(size);
+  return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr != nullptr) audio_tools::allocation_audit_counters.release();
+  free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+#endif
+
+#define ALLOCATION_AUDIT_HOOKS
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Verifies that a processing chain does not allocate any heap memory
+ * in the steady state: we execute the step (e.g. a copier.copy()) a couple
+ * of times to warm up and then count the allocations of the subsequent
+ * steps:
+ *
+ * AllocationAudit audit;
+ * audit.check("generator", [](){ copier.copy(); });
+ * if (audit.failedCount() > 0) exit(1);
+ *
+ * On the desktop all heap allocations of the process are counted, on all
+ * other platforms only the allocations of the audio-tools containers.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocationAudit {
+ public:
+  /// Total number of allocations
+  static uint64_t allocations() {
+#ifdef ALLOCATION_AUDIT_HOOKS
+    return allocation_audit_counters.allocations.load();
+#else
+    return AllocationCounter::allocations();
+#endif
+  }
+
+  /// Total number of allocated bytes
+  static uint64_t bytes() {
+#ifdef ALLOCATION_AUDIT_HOOKS
+    return allocation_audit_counters.bytes.load();
+#else
+    return AllocationCounter::bytes();
+#endif
+  }
+
+  /// Executes the step warmup times and then counts the allocations of the
+  /// next steps calls: returns false if there was any allocation
+  template <typename F>
+  bool check(const char *name, F step, int warmup = 10, int steps = 100) {
+    for (int j = 0; j < warmup; j++) step();
+    uint64_t start_allocations = allocations();
+    uint64_t start_bytes = bytes();
+    for (int j = 0; j < steps; j++) step();
+    uint64_t count = allocations() - start_allocations;
+    uint64_t size = bytes() - start_bytes;
+    bool result = count == 0;
+    char msg[120];
+    snprintf(msg, sizeof(msg), "%-30s %s: %llu allocations (%llu bytes) in %d steps",
+             name, result ? "OK  " : "FAIL", (unsigned long long)count,
+             (unsigned long long)size, steps);
+    if (p_out != nullptr) p_out->println(msg);
+    if (!result) failed_count++;
+    check_count++;
+    return result;
+  }
+
+  /// Defines the output for the results: nullptr for no output
+  void setOutput(Print *out) { p_out = out; }
+
+  /// Number of checks which have failed
+  int failedCount() { return failed_count; }
+
+  /// Number of executed checks
+  int checkCount() { return check_count; }
+
+ protected:
+  Print *p_out = &Serial;
+  int failed_count = 0;
+  int check_count = 0;
+};
+
+}  // namespace audio_tools
@@ -7,6 +7,7 @@
 #include "AudioTools/Converter.h"
 #include "AudioTools/AudioLogger.h"
 #include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioOutput.h"
 
 namespace audio_tools {
 
@@ -30,6 +31,14 @@ class StreamCopyT {
             }
         }
 
+        StreamCopyT(AudioStream &to, AudioStream &from, int buffer_size=DEFAULT_BUFFER_SIZE) : StreamCopyT((Print&)to, from, buffer_size) {
+            p_to_provider = &to;
+        }
+
+        StreamCopyT(AudioPrint &to, AudioStream &from, int buffer_size=DEFAULT_BUFFER_SIZE) : StreamCopyT((Print&)to, from, buffer_size) {
+            p_to_provider = &to;
+        }
+
         StreamCopyT(Print &to, Stream &from, int buffer_size=DEFAULT_BUFFER_SIZE){
             LOGD(LOG_METHOD);
             begin(to, from);
@@ -57,11 +66,13 @@ class StreamCopyT {
         void end() {
             this->from = nullptr;
             this->to = nullptr;
+            this->p_to_provider = nullptr;
         }
 
         void begin(Print &to, Stream &from){
             this->from = new AudioStreamWrapper(from);
             this->to = &to;
+            this->p_to_provider = nullptr;
             is_first = true;
             LOGI("buffer_size=%d",buffer_size);    
         }
@@ -70,10 +81,23 @@ class StreamCopyT {
         void begin(Print &to, AudioStream &from){
             this->from = &from;
             this->to = &to;
+            this->p_to_provider = nullptr;
             is_first = true;
             LOGI("buffer_size=%d",buffer_size);    
         }
 
+        // assign a new output and input stream: the output can provide its buffer
+        void begin(AudioStream &to, AudioStream &from){
+            begin((Print&)to, from);
+            this->p_to_provider = &to;
+        }
+
+        // assign a new output and input stream: the output can provide its buffer
+        void begin(AudioPrint &to, AudioStream &from){
+            begin((Print&)to, from);
+            this->p_to_provider = &to;
+        }
+
         Stream *getFrom(){
             return from;
         }
@@ -105,6 +129,11 @@ class StreamCopyT {
                     bytes_to_read = min((int)bytes_to_read, to_write);
                 }
 
+                // use the buffer of the source or destination if possible
+                if (is_zero_copy && copyDirect(bytes_to_read, result, delayCount)) {
+                    return result;
+                }
+
                 // get the data now
                 bytes_read = from->readBytes((uint8_t*)buffer, bytes_to_read);
 
@@ -122,8 +151,8 @@ class StreamCopyT {
                 #endif
                 CHECK_MEMORY();
             } else {
-                // give the processor some time 
-                delay(delay_on_no_data);
+                // give the processor some time or until we get notified about new data
+                waitForData();
             }
             return result;
         }
@@ -144,17 +173,18 @@ class StreamCopyT {
                 size_t samples = bytes_to_read / sizeof(T);
                 bytes_to_read = samples * sizeof(T);
 
-                T temp_data[samples];
-                bytes_read = from->readBytes((uint8_t*)temp_data, bytes_to_read);
-                // callback with unconverted data
-                if (onWrite!=nullptr) onWrite(onWriteObj, temp_data, bytes_read);
-
+                // read into the first half of the buffer
                 T* bufferT = (T*) buffer;
-                for (size_t j=0;j<samples;j++){
-                    *bufferT = temp_data[j];
-                    bufferT++;
-                    *bufferT = temp_data[j];
-                    bufferT++;
+                bytes_read = from->readBytes(buffer, bytes_to_read);
+                // callback with unconverted data
+                if (onWrite!=nullptr) onWrite(onWriteObj, buffer, bytes_read);
+
+                // duplicate the samples in place: we start at the end so that
+                // we do not overwrite any unprocessed values
+                for (int j=samples-1;j>=0;j--){
+                    T value = bufferT[j];
+                    bufferT[2*j] = value;
+                    bufferT[2*j+1] = value;
                 }
                 result = write(samples * sizeof(T)*2, delayCount);
                 #ifndef COPY_LOG_OFF
@@ -162,7 +192,7 @@ class StreamCopyT {
                 #endif
                 CHECK_MEMORY();
             } else {
-                delay(delay_on_no_data);
+                waitForData();
             }
             return result;
         }
@@ -172,7 +202,8 @@ class StreamCopyT {
             return from == nullptr ? 0 : from->available();
         }
 
-        /// Defines the dealy that is used if no data is available
+        /// Defines the dealy that is used if no data is available: if the source provides a
+        /// notifier this is the max time we wait for new data
         void setDelayOnNoData(int delayMs){
             delay_on_no_data = delayMs;
         }
@@ -226,6 +257,22 @@ class StreamCopyT {
             return buffer_size;
         }
 
+        /// Activates/deactivates the use of the buffers provided by the source or destination (default: inactive)
+        void setZeroCopy(bool active){
+            is_zero_copy = active;
+        }
+
+        /// Activates/deactivates the waiting on the notifiers of the source and destination (default: active): 
+        /// if deactivated we just delay when there is no data or space
+        void setNotify(bool active){
+            is_notify = active;
+        }
+
+        /// Number of bytes which were copied w/o using the intermediate copy buffer
+        size_t zeroCopyBytes() {
+            return zero_copy_bytes;
+        }
+
     protected:
         AudioStream *from = nullptr;
         Print *to = nullptr;
@@ -238,14 +285,82 @@ class StreamCopyT {
         const char* actual_mime = nullptr;
         int retryLimit = COPY_RETRY_LIMIT;
         int delay_on_no_data = COPY_DELAY_ON_NODATA;
+        BufferProvider *p_to_provider = nullptr;
+        bool is_zero_copy = false;
+        bool is_notify = true;
+        size_t zero_copy_bytes = 0;
+
+        /// Releases the peeked source data: the source must not provide spans
+        /// which can be overwritten before they are consumed
+        void checkCommitRead(size_t len){
+            size_t committed = from->commitRead(len);
+            if (committed != len){
+                LOGE("Source data was overwritten while copying: %d of %d bytes", (int)committed, (int)len);
+            }
+        }
+
+        /// Copies max len bytes w/o our buffer if the source and/or the destination
+        /// provide their memory: returns false if this is not possible, so that
+        /// the caller needs to use the copy buffer
+        bool copyDirect(size_t len, size_t &result, size_t &delayCount){
+            size_t src_len = 0;
+            uint8_t *src = from->peekSpan(src_len);
+            size_t dst_len = 0;
+            uint8_t *dst = p_to_provider == nullptr ? nullptr : p_to_provider->writeSpan(dst_len);
+            if (src == nullptr && dst == nullptr) return false;
+
+            if (src != nullptr) len = min(len, src_len);
+            if (dst != nullptr) len = min(len, dst_len);
+            // we allways copy full samples
+            len = len / sizeof(T) * sizeof(T);
+            if (len == 0) return false;
+
+            if (src != nullptr && dst != nullptr) {
+                // single copy from source to destination
+                memcpy(dst, src, len);
+                result = p_to_provider->commitWrite(len);
+                checkCommitRead(result);
+            } else if (src != nullptr) {
+                // write the data of the source: with the usual retries
+                result = write(src, len, delayCount);
+                checkCommitRead(result);
+            } else {
+                // read directly into the destination
+                result = from->readBytes(dst, len);
+                p_to_provider->commitWrite(result);
+            }
+
+            uint8_t *data = src != nullptr ? src : dst;
+            notifyMime(data, result);
+            is_first = false;
+            if (onWrite!=nullptr) onWrite(onWriteObj, data, result);
+            zero_copy_bytes += result;
+            return true;
+        }
+
+        /// Waits until the source has new data: if the source does not provide any notifier we just delay
+        void waitForData() {
+            AudioNotifier *notifier = (from == nullptr || !is_notify) ? nullptr : from->dataNotifier();
+            AudioNotifier::waitOrDelay(notifier, delay_on_no_data);
+        }
+
+        /// Provides the notifier of the destination which signals free space
+        AudioNotifier *spaceNotifier() {
+            return (p_to_provider == nullptr || !is_notify) ? nullptr : p_to_provider->spaceNotifier();
+        }
 
         // blocking write - until everything is processed
         size_t write(size_t len, size_t &delayCount ){
             if (buffer==nullptr) return 0;
+            return write(buffer, len, delayCount);
+        }
+
+        // blocking write of the indicated data - until everything is processed
+        size_t write(const uint8_t *data, size_t len, size_t &delayCount ){
             size_t total = 0;
             int retry = 0;
             while(total<len){
-                size_t written = to->write((const uint8_t*)buffer+total, len-total);
+                size_t written = to->write(data+total, len-total);
                 total += written;
                 delayCount++;
 
@@ -254,8 +369,9 @@ class StreamCopyT {
                     break;
                 }
                 
-                if (retry>1) {
-                    delay(5);
+                if (retry>1 && total<len) {
+                    // wait until the destination has some space 
+                    AudioNotifier::waitOrDelay(spaceNotifier(), 5);
                     LOGI("try write - %d ",retry);
                 }
                 CHECK_MEMORY();
@@ -302,6 +418,14 @@ class StreamCopy : public StreamCopyT<uint8_t> {
              LOGD(LOG_METHOD);
         }
 
+        StreamCopy(AudioStream &to, AudioStream &from, int buffer_size=DEFAULT_BUFFER_SIZE) : StreamCopyT<uint8_t>(to, from, buffer_size){
+             LOGD(LOG_METHOD);
+        }
+
+        StreamCopy(AudioPrint &to, AudioStream &from, int buffer_size=DEFAULT_BUFFER_SIZE) : StreamCopyT<uint8_t>(to, from, buffer_size){
+             LOGD(LOG_METHOD);
+        }
+
         /// copies a buffer length of data and applies the converter
         template<typename T>
         size_t copy(BaseConverter<T> &converter) {
@@ -327,8 +451,8 @@ class StreamCopy : public StreamCopyT<uint8_t> {
                     // LOGI("StreamCopy::copy %u bytes - in %u hops", (unsigned int)result,(unsigned int) delayCount);
                 #endif
             } else {
-                // give the processor some time 
-                delay(delay_on_no_data);
+                // give the processor some time or until we get notified about new data
+                waitForData();
             }
             return result;
         }
@@ -0,0 +1,95 @@
+#pragma once
+#include "Arduino.h"
+#include "AudioConfig.h"
+#if defined(IS_DESKTOP)
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Wakes up a task which is waiting for data or for space in a buffer:
+ * the producer calls notify() and the consumer blocks in wait() instead of
+ * polling with delay(). On the ESP32 we use a FreeRTOS task notification, on
+ * the desktop a condition variable. On all other platforms wait() just
+ * falls back to a delay().
+ *
+ * Only one task should wait on a notifier. A notification which arrives
+ * before the wait is not lost, but wait() may also return w/o any new data:
+ * so the caller must always check its condition again.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioNotifier {
+ public:
+  AudioNotifier() = default;
+  AudioNotifier(const AudioNotifier &) = delete;
+  AudioNotifier &operator=(const AudioNotifier &) = delete;
+
+  /// Wakes up the waiting task
+  void notify() {
+#if defined(ESP32)
+    // latch the notification: the consumer might not have waited yet
+    is_pending = true;
+    TaskHandle_t task = waiting_task;
+    if (task != nullptr) {
+      xTaskNotifyGive(task);
+    }
+#elif defined(IS_DESKTOP)
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      is_notified = true;
+    }
+    cv.notify_one();
+#endif
+  }
+
+  /// Blocks until notify() was called or the timeout has elapsed: returns
+  /// true if we have been notified
+  bool wait(uint32_t timeoutMs) {
+#if defined(ESP32)
+    waiting_task = xTaskGetCurrentTaskHandle();
+    if (is_pending) {
+      is_pending = false;
+      // consume a notification which was given in the meantime
+      ulTaskNotifyTake(pdTRUE, 0);
+      return true;
+    }
+    bool result = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) > 0;
+    is_pending = false;
+    return result;
+#elif defined(IS_DESKTOP)
+    std::unique_lock<std::mutex> lock(mtx);
+    bool result = cv.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                              [this] { return is_notified; });
+    is_notified = false;
+    return result;
+#else
+    delay(timeoutMs);
+    return false;
+#endif
+  }
+
+  /// Waits on the notifier if it is available, otherwise we just delay
+  static bool waitOrDelay(AudioNotifier *notifier, uint32_t timeoutMs) {
+    if (notifier != nullptr) {
+      return notifier->wait(timeoutMs);
+    }
+    delay(timeoutMs);
+    return false;
+  }
+
+ protected:
+#if defined(ESP32)
+  volatile TaskHandle_t waiting_task = nullptr;
+  volatile bool is_pending = false;
+#elif defined(IS_DESKTOP)
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool is_notified = false;
+#endif
+};
+
+}  // namespace audio_tools
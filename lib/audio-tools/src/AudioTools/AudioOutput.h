@@ -5,6 +5,7 @@
 #include "AudioTools/Converter.h"
 #include "AudioTools/Buffers.h"
 #include "AudioTools/AudioStreams.h"
+#include "AudioTools/LevelMeter.h"
 #include "AudioBasic/Int24.h"
 #include "WiFiClient.h"
 #include "vector"
@@ -18,7 +19,7 @@ namespace audio_tools {
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
-class AudioPrint : public Print, public AudioBaseInfoDependent, public AudioBaseInfoSource {
+class AudioPrint : public Print, public AudioBaseInfoDependent, public AudioBaseInfoSource, public BufferProvider {
     public:
         virtual size_t write(const uint8_t *buffer, size_t size) override = 0;
 
@@ -498,7 +499,10 @@ class MultiOutputPrint : public AudioPrint {
 };
 
 /**
- * @brief Mixing of multiple outputs to one final output
+ * @brief Mixing of multiple outputs to one final output: we expect one write()
+ * per output in the order of the outputs. The samples are summed up with 
+ * normalized fixed point gains and the saturated result is written to the 
+ * final output after the last output has been written.
  * @author Phil Schatzmann
  * @copyright GPLv3
  * @tparam T 
@@ -509,36 +513,34 @@ class OutputMixer : public Print {
     OutputMixer(Print &finalOutput, int outputStreamCount) {
       p_final_output = &finalOutput;
       output_count = outputStreamCount;
-      for (int i=0;i<output_count;i++){
-          weights.push_back(1.0);
-      }
+      mixer.begin(output_count);
     };
 
     /// Defines a new weight for the indicated channel: If you set it to 0 it is muted.
     void setWeight(int channel, float weight){
       if (channel<size()){
-        weights[channel] = weight;
+        mixer.setWeight(channel, weight);
       } else {
         LOGE("Invalid channel %d - max is %d", channel, size()-1);
       }
     }
 
+    /// Provides the peak level of the last data of the indicated output
+    float level(int channel) {
+      return mixer.level(channel);
+    }
+
     void begin(int copy_buffer_size=DEFAULT_BUFFER_SIZE) {
       is_active = true;
-      total_weights = 0;
-      for (int j=0;j<weights.size();j++){
-        total_weights += weights[j];
-      }
-      size_bytes = copy_buffer_size;
-      // clear final data so that we can add values
+      size_bytes = copy_buffer_size / sizeof(T) * sizeof(T);
       result.resize(size_bytes);
-      memset(result.data(), 0, size_bytes); 
+      // clear final data so that we can add values
+      mixer.clear(size_bytes / sizeof(T));
+      stream_idx = 0;
     }
 
     /// Remove all input streams
     void end() {
-      weights.clear();
-      total_weights = 0.0;
       is_active = false;
     }
 
@@ -551,15 +553,9 @@ class OutputMixer : public Print {
     size_t write(const uint8_t *buffer_c, size_t size){
         if (!is_active) return 0;
         LOGD("write: %d", size);
-        int sample_size = min(size, (size_t)size_bytes);
-        int sample_count = sample_size / sizeof(T);
-        T* samples_result = (T*)result.data();
-        float weight = weights[stream_idx];
+        int sample_size = min(size, (size_t)size_bytes) / sizeof(T) * sizeof(T);
         // sum up input samples to result samples 
-        T *buffer = (T*) buffer_c;
-        for (int i=0;i<sample_count; i++){
-            result[i] += weight * buffer[i] / total_weights;
-        }
+        mixer.add(stream_idx, (const T*) buffer_c, sample_size / sizeof(T));
         stream_idx++;
         if (stream_idx>=output_count){
             flush();
@@ -567,31 +563,37 @@ class OutputMixer : public Print {
         return sample_size;
     }
     
+    /// Single bytes can not be mixed
+    size_t write(uint8_t) override { return 0; }
+
     int availableForWrite() { return is_active ? size_bytes : 0; }
 
     /// Force output to final destination
     void flush() {
+        mixer.store((T*)result.data(), size_bytes / sizeof(T));
         p_final_output->write(result.data(), size_bytes);
         stream_idx = 0;
         // clear final data so that we can add values
-        memset(result.data(), 0, size_bytes); 
+        mixer.clear(size_bytes / sizeof(T));
     }
 
   protected:
     Vector<uint8_t> result{0};
-    Vector<float> weights{10}; 
+    FixedPointMixer<T> mixer;
     Print *p_final_output=nullptr;
-    float total_weights = 0.0;
     bool is_active = false;
     int stream_idx = 0;
-    int size_bytes;
+    int size_bytes = 0;
     int output_count;
 
 };
 
 
 /**
- * @brief A simple class to determine the volume
+ * @brief A simple class to determine the volume: the values are measured by a
+ * LevelMeter which provides the peak, rms and true peak per channel and the
+ * EBU R128 short-term loudness. They are updated at the end of each integration
+ * window (see LevelMeterConfig), so they can be polled e.g. to drive a level meter.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -599,89 +601,78 @@ class VolumePrint : public AudioPrint {
     public:
         VolumePrint() = default;
 
-        ~VolumePrint() {
-            if (volumes!=nullptr) delete volumes;
-            if (volumes_tmp!=nullptr) delete volumes_tmp;
+        LevelMeterConfig defaultConfig() {
+            LevelMeterConfig c;
+            return c;
         }
-     
+
         bool begin(AudioBaseInfo info){
-            setAudioInfo(info);
-            return true;
+            LevelMeterConfig c = this->info;
+            c.sample_rate = info.sample_rate;
+            c.channels = info.channels;
+            c.bits_per_sample = info.bits_per_sample;
+            return begin(c);
+        }
+
+        /// Starts the processing with the indicated integration windows
+        bool begin(LevelMeterConfig config){
+            info = config;
+            cfg = config;
+            return meter.begin(info);
         }
 
         void setAudioInfo(AudioBaseInfo info){
-            this->info = info;
-            if (info.channels){
-                volumes = new float[info.channels];
-                volumes_tmp = new float[info.channels];
-            }
+            begin(info);
         }
 
         size_t write(const uint8_t *buffer, size_t size){
-            float f_volume_tmp = 0;
-            for (int j=0;j<info.channels;j++){
-                volumes_tmp[j]=0;
-            }
-            switch(info.bits_per_sample){
-                case 16: {
-                        int16_t *buffer16 = (int16_t*)buffer;
-                        int samples16 = size/2;
-                        for (int j=0;j<samples16;j++){
-                            float tmp = static_cast<float>(abs(buffer16[j]));
-                            updateVolume(tmp,j);
-                        }
-                        commit();
-                    } break;
-                case 32: {
-                        int32_t *buffer32 = (int32_t*)buffer;
-                        int samples32 = size/4;
-                        for (int j=0;j<samples32;j++){
-                            float tmp = static_cast<float>(abs(buffer32[j]))/samples32;
-                            updateVolume(tmp,j);
-                        }
-                        commit();
-                    }break;
-
-                default:
-                    LOGE("Unsupported bits_per_sample: %d", info.bits_per_sample);
-                    f_volume = 0;
-                    break;
-            }
+            meter.process(buffer, size);
             return size;
         }
 
-        /// Determines the volume (the range depends on the bits_per_sample)
+        /// Determines the peak volume of all channels (the range depends on the bits_per_sample)
         float volume() {
-            return f_volume;
+            float result = 0.0f;
+            for (int j=0;j<info.channels;j++){
+                float value = volume(j);
+                if (value>result) result = value;
+            }
+            return result;
         }
 
-        /// Determines the volume for the indicated channel
+        /// Determines the peak volume for the indicated channel (the range depends on the bits_per_sample)
         float volume(int channel) {
-            return channel<info.channels ? volumes[channel]:0.0;
+            float max_value = info.use_float ? 1.0f : NumberConverter::maxValue(info.bits_per_sample);
+            return meter.peak(channel) * max_value;
         }
 
-    protected:
-        AudioBaseInfo info;
-        float f_volume_tmp = 0;
-        float f_volume = 0;
-        float *volumes=nullptr;
-        float *volumes_tmp=nullptr;
-
-        void updateVolume(float tmp, int j) {
-            if (tmp>f_volume){
-                f_volume_tmp = tmp;
-            }
-            if (volumes_tmp!=nullptr && tmp>volumes_tmp[j%info.channels]){
-                volumes_tmp[j%info.channels] = tmp;
-            }
+        /// Peak of the indicated channel relative to full scale
+        float peak(int channel) {
+            return meter.peak(channel);
         }
 
-        void commit(){
-            f_volume = f_volume_tmp;
-            for (int j=0;j<info.channels;j++){
-                volumes[j] = volumes_tmp[j];
-            }
+        /// Rms of the indicated channel relative to full scale
+        float rms(int channel) {
+            return meter.rms(channel);
         }
+
+        /// Estimated true peak of the indicated channel relative to full scale
+        float truePeak(int channel) {
+            return meter.truePeak(channel);
+        }
+
+        /// EBU R128 short-term loudness in LUFS
+        float loudness() {
+            return meter.shortTermLoudness();
+        }
+
+        LevelMeter &levelMeter() {
+            return meter;
+        }
+
+    protected:
+        LevelMeterConfig info;
+        LevelMeter meter;
 };
 
 
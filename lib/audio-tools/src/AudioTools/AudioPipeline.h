@@ -0,0 +1,423 @@
+#pragma once
+#include "AudioConfig.h"
+#if defined(USE_ATOMIC) && (defined(ESP32) || defined(IS_DESKTOP))
+#include "AudioBasic/Vector.h"
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioCopy.h"
+#include "AudioTools/Buffers.h"
+#include <atomic>
+#ifdef IS_DESKTOP
+#include <thread>
+#endif
+
+#ifndef PIPELINE_STACK_SIZE
+#define PIPELINE_STACK_SIZE 8192
+#endif
+
+#ifndef PIPELINE_PRIORITY
+#define PIPELINE_PRIORITY 2
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Bounded lock free queue which connects two pipeline stages that are
+ * running in separate tasks: one stage writes and the other stage reads.
+ * A write blocks until all data has been queued, a read returns what is
+ * available. The stages are waiting on the notifiers of the queue, so they
+ * wake up as soon as there is data or space.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PipelineQueue : public AudioStream {
+ public:
+  PipelineQueue(int size = DEFAULT_BUFFER_SIZE * 8) : buffer(size, DropNewest) {}
+
+  /// Blocking write
+  size_t write(const uint8_t *data, size_t len) override {
+    size_t result = 0;
+    while (result < len && is_active) {
+      int written = buffer.writeArray(data + result, len - result);
+      result += written;
+      if (result < len) {
+        // queue is full: wait for the reader
+        write_stall_count++;
+        space_notifier.wait(10);
+      }
+    }
+    updateMaxDepth();
+    data_notifier.notify();
+    return result;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  size_t readBytes(uint8_t *data, size_t len) override {
+    size_t result = buffer.readArray(data, len);
+    if (result > 0) space_notifier.notify();
+    return result;
+  }
+
+  int available() override {
+    int result = buffer.available();
+    if (result == 0) read_stall_count++;
+    return result;
+  }
+
+  int availableForWrite() override { return buffer.availableForWrite(); }
+
+  int read() override {
+    uint8_t c;
+    return readBytes(&c, 1) == 1 ? c : -1;
+  }
+
+  int peek() override { return available() > 0 ? buffer.peek() : -1; }
+
+  void flush() override {}
+
+  uint8_t *peekSpan(size_t &len) override {
+    int span_len = 0;
+    uint8_t *result = buffer.peekSpan(span_len);
+    len = span_len;
+    return result;
+  }
+
+  size_t commitRead(size_t len) override {
+    size_t result = buffer.commitRead(len);
+    if (result > 0) space_notifier.notify();
+    return result;
+  }
+
+  uint8_t *writeSpan(size_t &len) override {
+    int span_len = 0;
+    uint8_t *result = buffer.writeSpan(span_len);
+    len = span_len;
+    return result;
+  }
+
+  size_t commitWrite(size_t len) override {
+    size_t result = buffer.commitWrite(len);
+    updateMaxDepth();
+    if (result > 0) data_notifier.notify();
+    return result;
+  }
+
+  /// Signals the reader that data has been written
+  AudioNotifier *dataNotifier() override { return &data_notifier; }
+
+  /// Signals the writer that data has been read
+  AudioNotifier *spaceNotifier() override { return &space_notifier; }
+
+  /// Releases a blocked writer e.g. when the pipeline is stopped
+  void end() override {
+    is_active = false;
+    space_notifier.notify();
+  }
+
+  bool begin() override {
+    is_active = true;
+    return true;
+  }
+
+  /// Max number of bytes in the queue
+  int size() { return buffer.size(); }
+
+  /// Actual number of queued bytes
+  int depth() { return buffer.available(); }
+
+  /// Highest number of queued bytes which was measured
+  int maxDepth() { return max_depth; }
+
+  /// Number of times a writer had to wait because the queue was full
+  uint32_t writeStallCount() { return write_stall_count; }
+
+  /// Number of times the reader found the queue empty
+  uint32_t readStallCount() { return read_stall_count; }
+
+  void resetStatistics() {
+    max_depth = 0;
+    write_stall_count = 0;
+    read_stall_count = 0;
+  }
+
+ protected:
+  LockFreeRingBuffer<uint8_t> buffer;
+  AudioNotifier data_notifier;
+  AudioNotifier space_notifier;
+  std::atomic<bool> is_active{true};
+  // the statistics are reported by other tasks
+  std::atomic<int> max_depth{0};
+  std::atomic<uint32_t> write_stall_count{0};
+  std::atomic<uint32_t> read_stall_count{0};
+
+  void updateMaxDepth() {
+    int depth = buffer.available();
+    if (depth > max_depth) max_depth = depth;
+  }
+};
+
+/**
+ * @brief A pipeline stage which repeatedly executes a StreamCopy or a
+ * callback in its own task (FreeRTOS task on the ESP32, std::thread on the
+ * desktop) and measures how busy it is. The statistics are 32 bit atomics,
+ * so that they can be reported by any task: like micros() they wrap after
+ * about 71 minutes.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PipelineStage {
+ public:
+  PipelineStage(const char *name, StreamCopy &copier, int core = -1) {
+    this->name = name;
+    this->p_copier = &copier;
+    this->core = core;
+  }
+
+  PipelineStage(const char *name, size_t (*callback)(void *ref), void *ref,
+                int core = -1) {
+    this->name = name;
+    this->callback = callback;
+    this->ref = ref;
+    this->core = core;
+  }
+
+  ~PipelineStage() { end(); }
+
+  /// Starts the task
+  bool begin(int stackSize = PIPELINE_STACK_SIZE,
+             int priority = PIPELINE_PRIORITY) {
+    if (is_active) return true;
+    LOGI("starting stage %s", name);
+    resetStatistics();
+    is_active = true;
+#ifdef ESP32
+    BaseType_t rc;
+    if (core >= 0) {
+      rc = xTaskCreatePinnedToCore(task, name, stackSize, this, priority,
+                                   &task_handle, core);
+    } else {
+      rc = xTaskCreate(task, name, stackSize, this, priority, &task_handle);
+    }
+    if (rc != pdPASS) {
+      LOGE("Could not create task %s", name);
+      is_active = false;
+    }
+#else
+    p_thread = new std::thread(task, this);
+#endif
+    return is_active;
+  }
+
+  /// Stops the task after the current step
+  void end() {
+    if (!is_active) return;
+    is_active = false;
+#ifdef ESP32
+    // the task deletes itself
+    while (task_handle != nullptr) {
+      delay(1);
+    }
+#else
+    if (p_thread != nullptr) {
+      p_thread->join();
+      delete p_thread;
+      p_thread = nullptr;
+    }
+#endif
+  }
+
+  /// Executes a single step: returns the number of processed bytes
+  size_t step() {
+    uint32_t start = micros();
+    size_t result =
+        p_copier != nullptr ? p_copier->copy() : callback(ref);
+    if (result > 0) {
+      busy_us += (uint32_t)micros() - start;
+      bytes += result;
+    } else {
+      stall_count++;
+    }
+    step_count++;
+    return result;
+  }
+
+  const char *stageName() { return name; }
+
+  /// Percent of the time in which data was processed
+  float busyPercent() {
+    uint32_t total_us = (uint32_t)micros() - start_us;
+    return total_us == 0 ? 0.0f : 100.0f * busy_us / total_us;
+  }
+
+  /// Number of steps which did not process any data
+  uint32_t stallCount() { return stall_count; }
+
+  /// Total processing time in us
+  uint32_t busyTimeUs() { return busy_us; }
+
+  /// Number of processed bytes
+  uint32_t processedBytes() { return bytes; }
+
+  uint32_t stepCount() { return step_count; }
+
+  void resetStatistics() {
+    start_us = micros();
+    busy_us = 0;
+    bytes = 0;
+    stall_count = 0;
+    step_count = 0;
+  }
+
+  bool isActive() { return is_active; }
+
+ protected:
+  const char *name = nullptr;
+  StreamCopy *p_copier = nullptr;
+  size_t (*callback)(void *ref) = nullptr;
+  void *ref = nullptr;
+  int core = -1;
+  std::atomic<bool> is_active{false};
+  // the statistics are reported by other tasks
+  std::atomic<uint32_t> start_us{0};
+  std::atomic<uint32_t> busy_us{0};
+  std::atomic<uint32_t> bytes{0};
+  std::atomic<uint32_t> stall_count{0};
+  std::atomic<uint32_t> step_count{0};
+#ifdef ESP32
+  TaskHandle_t task_handle = nullptr;
+#else
+  std::thread *p_thread = nullptr;
+#endif
+
+  static void task(void *arg) {
+    PipelineStage *self = (PipelineStage *)arg;
+    while (self->is_active) {
+      self->step();
+    }
+#ifdef ESP32
+    self->task_handle = nullptr;
+    vTaskDelete(nullptr);
+#endif
+  }
+};
+
+/**
+ * @brief Runs an audio processing chain which is split into stages. Each
+ * stage is executed in its own task and the stages are connected with
+ * PipelineQueue objects:
+ *
+ * PipelineQueue queue;
+ * StreamCopy receive(queue, url);   // stage 1: network -> queue
+ * StreamCopy play(decoder, queue);  // stage 2: queue -> decoder -> i2s
+ * PipelineRunner pipeline;
+ * pipeline.add("receive", receive, 0);
+ * pipeline.add("play", play, 1);
+ * pipeline.add(queue);
+ * pipeline.begin();
+ *
+ * The stages must be added in the order of the data flow: end() stops them in
+ * this order, so that each stage can still deliver its data to the next one.
+ *
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PipelineRunner {
+ public:
+  PipelineRunner() = default;
+
+  ~PipelineRunner() {
+    end();
+    for (int j = 0; j < stages.size(); j++) {
+      delete stages[j];
+    }
+  }
+
+  /// Adds a stage which executes the StreamCopy; core -1: any core
+  PipelineStage &add(const char *name, StreamCopy &copier, int core = -1) {
+    PipelineStage *stage = new PipelineStage(name, copier, core);
+    stages.push_back(stage);
+    return *stage;
+  }
+
+  /// Adds a stage which executes the callback: it returns the number of
+  /// processed bytes
+  PipelineStage &add(const char *name, size_t (*callback)(void *ref),
+                     void *ref, int core = -1) {
+    PipelineStage *stage = new PipelineStage(name, callback, ref, core);
+    stages.push_back(stage);
+    return *stage;
+  }
+
+  /// Registers a queue for the reporting of the statistics
+  void add(PipelineQueue &queue) { queues.push_back(&queue); }
+
+  /// Starts all stages
+  bool begin(int stackSize = PIPELINE_STACK_SIZE,
+             int priority = PIPELINE_PRIORITY) {
+    bool result = true;
+    for (int j = 0; j < queues.size(); j++) {
+      queues[j]->begin();
+    }
+    for (int j = 0; j < stages.size(); j++) {
+      if (!stages[j]->begin(stackSize, priority)) {
+        result = false;
+      }
+    }
+    return result;
+  }
+
+  /// Stops all stages from the source to the sink and then closes the queues
+  void end() {
+    // a stage which is blocked by a full queue is released by the next stage
+    for (int j = 0; j < stages.size(); j++) {
+      stages[j]->end();
+    }
+    for (int j = 0; j < queues.size(); j++) {
+      queues[j]->end();
+    }
+  }
+
+  /// Number of stages
+  int size() { return stages.size(); }
+
+  PipelineStage &stage(int idx) { return *stages[idx]; }
+
+  PipelineQueue &queue(int idx) { return *queues[idx]; }
+
+  /// Prints the queue depths, the busy time and the stall counts
+  void printStatistics(Print &out) {
+    char msg[120];
+    for (int j = 0; j < stages.size(); j++) {
+      PipelineStage *s = stages[j];
+      snprintf(msg, sizeof(msg), "stage %s: busy %.1f%% - stalls: %u - steps: %u",
+               s->stageName(), s->busyPercent(), (unsigned)s->stallCount(),
+               (unsigned)s->stepCount());
+      out.println(msg);
+    }
+    for (int j = 0; j < queues.size(); j++) {
+      PipelineQueue *q = queues[j];
+      snprintf(msg, sizeof(msg),
+               "queue %d: depth %d/%d (max %d) - write stalls: %u - read stalls: %u",
+               j, q->depth(), q->size(), q->maxDepth(),
+               (unsigned)q->writeStallCount(), (unsigned)q->readStallCount());
+      out.println(msg);
+    }
+  }
+
+  void resetStatistics() {
+    for (int j = 0; j < stages.size(); j++) {
+      stages[j]->resetStatistics();
+    }
+    for (int j = 0; j < queues.size(); j++) {
+      queues[j]->resetStatistics();
+    }
+  }
+
+ protected:
+  Vector<PipelineStage *> stages;
+  Vector<PipelineQueue *> queues;
+};
+
+}  // namespace audio_tools
+
+#endif
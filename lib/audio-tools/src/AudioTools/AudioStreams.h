@@ -6,6 +6,8 @@
 #include "AudioTools/AudioLogger.h"
 #include "AudioEffects/SoundGenerator.h"
 #include "AudioTools/VolumeControl.h"
+#include "AudioTools/FixedPointGain.h"
+#include "AudioTools/FixedPointMixer.h"
 
 #ifndef URL_CLIENT_TIMEOUT
 #define URL_CLIENT_TIMEOUT 60000
@@ -30,7 +32,7 @@ static const char *UNDERFLOW_MSG = "data underflow";
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
-class AudioStream : public Stream, public AudioBaseInfoDependent, public AudioBaseInfoSource {
+class AudioStream : public Stream, public AudioBaseInfoDependent, public AudioBaseInfoSource, public BufferProvider {
  public:
   AudioStream() = default;
   virtual ~AudioStream() = default;
@@ -95,6 +97,39 @@ class AudioStreamX : public AudioStream {
   virtual void flush() FLUSH_OVERRIDE {}
 };
 
+/**
+ * @brief Reads full frames from a stream: the bytes of an incomplete frame are
+ * kept and provided in front of the next read, so that a source which returns
+ * any number of bytes (e.g. ESP-NOW, a ring buffer or UDP) does not shift the
+ * channels.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FrameReader {
+ public:
+  void begin(int frameBytes){
+    frame_bytes = frameBytes;
+    carry.resize(frameBytes);
+    carry_bytes = 0;
+  }
+
+  /// Reads max frames full frames into data: returns the number of frames
+  size_t read(Stream &in, uint8_t *data, size_t frames){
+    if (frames == 0 || frame_bytes == 0) return 0;
+    memcpy(data, carry.data(), carry_bytes);
+    size_t total = carry_bytes + in.readBytes(data + carry_bytes, frames * frame_bytes - carry_bytes);
+    size_t result = total / frame_bytes;
+    carry_bytes = total - result * frame_bytes;
+    memcpy(carry.data(), data + result * frame_bytes, carry_bytes);
+    return result;
+  }
+
+ protected:
+  Vector<uint8_t> carry;
+  size_t frame_bytes = 0;
+  size_t carry_bytes = 0;
+};
+
 /**
  * @brief To be used to support implementations where the readBytes is not
  * virtual
@@ -195,7 +230,7 @@ class MemoryStream : public AudioStream {
       if (!write(buffer[j])) {
         break;
       }
-      result = j;
+      result = j + 1;
     }
     return result;
   }
@@ -282,6 +317,30 @@ class MemoryStream : public AudioStream {
     return buffer;
   }
 
+  /// Provides the unread data w/o copying
+  uint8_t *peekSpan(size_t &len) override {
+    len = available();
+    return len > 0 ? buffer + read_pos : nullptr;
+  }
+
+  size_t commitRead(size_t len) override {
+    len = min(len, (size_t)available());
+    read_pos += len;
+    return len;
+  }
+
+  /// Provides the unused memory
+  uint8_t *writeSpan(size_t &len) override {
+    len = (buffer == nullptr || !memoryCanChange()) ? 0 : buffer_size - write_pos;
+    return len > 0 ? buffer + write_pos : nullptr;
+  }
+
+  size_t commitWrite(size_t len) override {
+    len = min(len, (size_t)(buffer_size - write_pos));
+    write_pos += len;
+    return len;
+  }
+
 
  protected:
   int write_pos = 0;
@@ -298,7 +357,7 @@ class MemoryStream : public AudioStream {
 
 /**
  * @brief Source for reading generated tones. Please note
- * - that the output is for one channel only!
+ * - that the generator provides the same data for all channels!
  * - we do not support reading of individual characters!
  * - we do not support any write operations
  * @param generator
@@ -360,10 +419,18 @@ class GeneratedSoundStream : public AudioStreamX {
   /// This is unbounded so we just return the buffer size
   virtual int available() override { return DEFAULT_BUFFER_SIZE; }
 
-  /// privide the data as byte stream
+  /// privide the data as byte stream: the generator renders the frames directly
+  /// into the buffer
   size_t readBytes(uint8_t *buffer, size_t length) override {
     LOGD("GeneratedSoundStream::readBytes: %u", (unsigned int)length);
-    return generator_ptr->readBytes(buffer, length);
+    int channels = generator_ptr->audioInfo().channels;
+    if (channels <= 0 || !generator_ptr->isActive()) {
+      // the generator reports the error
+      return generator_ptr->readBytes(buffer, length);
+    }
+    size_t frame_size = sizeof(T) * channels;
+    return generator_ptr->generate((T *)buffer, length / frame_size, channels) *
+           frame_size;
   }
 
   bool isActive() {return active && generator_ptr->isActive();}
@@ -561,6 +628,24 @@ class RingBufferStream : public AudioStream {
 
   virtual size_t write(uint8_t c) override { return buffer->write(c); }
 
+  uint8_t *peekSpan(size_t &len) override {
+    int span_len = 0;
+    uint8_t *result = buffer->peekSpan(span_len);
+    len = span_len;
+    return result;
+  }
+
+  size_t commitRead(size_t len) override { return buffer->commitRead(len); }
+
+  uint8_t *writeSpan(size_t &len) override {
+    int span_len = 0;
+    uint8_t *result = buffer->writeSpan(span_len);
+    len = span_len;
+    return result;
+  }
+
+  size_t commitWrite(size_t len) override { return buffer->commitWrite(len); }
+
  protected:
   RingBuffer<uint8_t> *buffer = nullptr;
 };
@@ -599,6 +684,15 @@ class ExternalBufferStream : public AudioStream {
     return 0;
   }
 
+  uint8_t *peekSpan(size_t &len) override {
+    int span_len = 0;
+    uint8_t *result = buffer.peekSpan(span_len);
+    len = span_len;
+    return result;
+  }
+
+  size_t commitRead(size_t len) override { return buffer.commitRead(len); }
+
  protected:
   SingleBuffer<uint8_t> buffer;
 };
@@ -706,6 +800,7 @@ struct VolumeStreamConfig : public AudioBaseInfo {
   }
   bool allow_boost = false;
   float volume=1.0;  // start_volume
+  bool use_float = false; // samples are float (see FloatFormatConverterStream)
 };
 
 /**
@@ -755,6 +850,7 @@ class VolumeStream : public AudioStreamX {
           cfg1.bits_per_sample = cfg.bits_per_sample;
           // keep volume which might habe been defined befor calling begin
           cfg1.volume = info.volume;  
+          cfg1.use_float = info.use_float;
           return begin(cfg1);
         }
 
@@ -762,13 +858,12 @@ class VolumeStream : public AudioStreamX {
             is_active = false;
         }
 
-        /// starts the processing 
+        /// starts the processing: selects the gain kernel for the bits per sample and channels
         bool begin(VolumeStreamConfig cfg){
             LOGD(LOG_METHOD);
             info = cfg;
-            max_value = NumberConverter::maxValue(info.bits_per_sample);
-            if (info.channels>max_channels){
-              max_channels = info.channels;
+            if (!info.use_float && !gain.begin(info.bits_per_sample, info.channels)){
+              return false;
             }
             // set start volume
             setVolume(cfg.volume); 
@@ -840,7 +935,9 @@ class VolumeStream : public AudioStreamX {
               float volume_value = volumeValue(vol);
               LOGI("setVolume: %f", volume_value);
               float factor = volumeControl().getVolumeFactor(volume_value);
+              volume_values[channel]=vol;
               factor_for_channel[channel]=factor;
+              gain.setFactor(channel, factor);
             } else {
               LOGE("Invalid channel %d - max: %d", channel, info.channels-1);
             }
@@ -864,14 +961,15 @@ class VolumeStream : public AudioStreamX {
         CachedVolumeControl cached_volume = CachedVolumeControl(default_volume);
         float *volume_values = nullptr;
         float *factor_for_channel = nullptr;
+        FixedPointGain gain;
         bool is_active = false;
-        float max_value = 32767; // max value for clipping
         int max_channels=0;
 
         void setup(float vol) {
             is_active = vol!=1.0;
             if (info.channels>max_channels){
               cleanup();
+              max_channels = info.channels;
             }
             if (factor_for_channel==nullptr){
               factor_for_channel = new float[info.channels];
@@ -911,52 +1009,36 @@ class VolumeStream : public AudioStreamX {
         }
 
         void applyVolume(const uint8_t *buffer, size_t size){
-            switch(info.bits_per_sample){
-                case 16:
-                    applyVolume16((int16_t*)buffer, size/2);
-                    break;
-                case 24:
-                    applyVolume24((int24_t*)buffer, size/3);
-                    break;
-                case 32:
-                    applyVolume32((int32_t*)buffer, size/4);
-                    break;
-                default:
-                    LOGE("Unsupported bits_per_sample: %d", info.bits_per_sample);
-            }
-        }
-
-        void applyVolume16(int16_t* data, size_t size){
-            for (size_t j=0;j<size;j++){
-                float result = factorForChannel(j%info.channels) * data[j];
-                if (info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                data[j]= static_cast<int16_t>(result);
-            }
-        }
-
-        void applyVolume24(int24_t* data, size_t size) {
-            for (size_t j=0;j<size;j++){
-                float result = factorForChannel(j%info.channels) * data[j];
-                if (info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                int32_t result1 = result;
-                data[j]= static_cast<int24_t>(result1);
+            if (info.use_float){
+              applyVolumeFloat((float*)buffer, size / sizeof(float));
+            } else {
+              gain.apply((uint8_t*)buffer, size);
             }
         }
 
-        void applyVolume32(int32_t* data, size_t size) {
-            for (size_t j=0;j<size;j++){
-                float result = factorForChannel(j%info.channels) * data[j];
-                if (info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                data[j]= static_cast<int32_t>(result);
+        /// float samples are just scaled: we do not need to clip the result
+        void applyVolumeFloat(float *samples, size_t count){
+            const int channels = info.channels;
+            if (channels==1){
+              const float factor = factor_for_channel[0];
+              for (size_t j=0; j<count; j++){
+                samples[j] *= factor;
+              }
+            } else if (channels==2){
+              const float left = factor_for_channel[0];
+              const float right = factor_for_channel[1];
+              for (size_t j=0; j+1<count; j+=2){
+                samples[j] *= left;
+                samples[j+1] *= right;
+              }
+              // incomplete frame
+              if (count % 2 != 0){
+                samples[count-1] *= left;
+              }
+            } else {
+              for (size_t j=0; j<count; j++){
+                samples[j] *= factor_for_channel[j % channels];
+              }
             }
         }
 };
@@ -1067,7 +1149,11 @@ class MeasuringStream : public AudioStreamX {
 
 /**
  * @brief MixerStream is mixing the input from Multiple Input Streams.
- * All streams must have the same audo format (sample rate, channels, bits per sample) 
+ * All streams must have the same audo format (sample rate, channels, bits per sample).
+ * The weights are converted to normalized fixed point gains, so that the mixing
+ * is done with integer arithmetic. We never block on inputs which do not have
+ * any data (e.g. a microphone which has not delivered anything yet): they are
+ * treated as silence.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -1080,29 +1166,33 @@ class InputMixer : public AudioStreamX {
     /// Adds a new input stream
     void add(Stream &in, float weight=1.0){
       streams.push_back(&in);
+      mixer.begin(streams.size());
       weights.push_back(weight);
-      total_weights += weight;
+      for (int j=0;j<size();j++){
+        mixer.setWeight(j, weights[j]);
+      }
     }
 
     /// Defines a new weight for the indicated channel: If you set it to 0 it is muted.
     void setWeight(int channel, float weight){
       if (channel<size()){
         weights[channel] = weight;
-        float total = 0;
-        for (int j=0;j<weights.size();j++){
-          total += weights[j];
-        }
-        total_weights = total;
+        mixer.setWeight(channel, weight);
       } else {
         LOGE("Invalid channel %d - max is %d", channel, size()-1);
       }
     }
 
+    /// Provides the peak level of the last data of the indicated input
+    float level(int channel) {
+      return mixer.level(channel);
+    }
+
     /// Remove all input streams
     void end() {
       streams.clear();
       weights.clear();
-      total_weights = 0.0;
+      mixer.begin(0);
     }
 
     /// Number of stremams to which are mixed together
@@ -1110,23 +1200,49 @@ class InputMixer : public AudioStreamX {
       return streams.size();
     }
 
-    /// Provides the data from all streams mixed together 
+    /// Defines the arena from which we take the read buffer
+    void setArena(ScratchArena &arena){
+      buffer.setArena(&arena);
+      mixer.setArena(arena);
+    }
+
+    /// Allocates the read buffer: this is done automatically with the default size 
+    /// on the first read. We provide max copy_buffer_size bytes per readBytes()
+    bool begin(int copy_buffer_size=DEFAULT_BUFFER_SIZE) {
+      return buffer.resize(copy_buffer_size) && mixer.clear(copy_buffer_size / sizeof(T));
+    }
+
+    /// Provides the data from all streams mixed together: we read only as much as all 
+    /// streams with data can provide
     size_t readBytes(uint8_t* data, size_t len) override {
       LOGD("readBytes: %d",len);
+      if (buffer.size()==0 && !begin()) return 0;
+      // we never read more then the buffer size or what is available
+      len = min(len, buffer.size());
+      bool has_data = false;
+      for (int j=0;j<size();j++){
+        int available = streams[j]->available();
+        if (available>0){
+          len = min(len, (size_t)available);
+          has_data = true;
+        }
+      }
+      len = len / sizeof(T) * sizeof(T);
+      if (!has_data || len==0) return 0;
+
       int sample_count = len / sizeof(T);
-      T* samples_result = (T*)data;
-      memset(data,0, len); // clear data so that we can add values
-      buffer.resize(len); // usually does only something the first time
-      T* buffer_in = (T*)&buffer[0];
+      mixer.clear(sample_count);
       for (int j=0;j<size();j++){
-        float weight = weights[j];
-        LOGD("adding stream %d with len %d with weight %f",j, len, weight);
-        memset(&buffer[0],0, len); // if no data is read we have an array of 0
-        streams[j]->readBytes(&buffer[0], len);
-        for (int i=0;i<sample_count; i++){
-          samples_result[i] += weight * buffer_in[i] / total_weights;
+        // inputs without data are silent
+        if (streams[j]->available()<=0){
+          mixer.setSilent(j);
+          continue;
         }
+        LOGD("adding stream %d with len %d",j, len);
+        size_t read = streams[j]->readBytes(&buffer[0], len);
+        mixer.add(j, (T*)&buffer[0], read / sizeof(T));
       }
+      mixer.store((T*)data, sample_count);
       return len;
     }
 
@@ -1143,9 +1259,9 @@ class InputMixer : public AudioStreamX {
 
   protected:
     Vector<Stream*> streams{10};
-    Vector<uint8_t> buffer{DEFAULT_BUFFER_SIZE};
+    ScratchBuffer<uint8_t> buffer;
     Vector<float> weights{10}; 
-    float total_weights = 0.0;
+    FixedPointMixer<T> mixer;
 
 };
 
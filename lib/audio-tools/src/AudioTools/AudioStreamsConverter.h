@@ -1,254 +1,217 @@
 #include "AudioTools/AudioStreams.h"
+#include "AudioTools/SampleFormatConverter.h"
 
 namespace audio_tools {
 
-
 /**
- * @brief Converter for reducing or increasing the number of Channels
+ * @brief Common functionality of the format converter streams: the data is
+ * converted in one pass with the kernel of a SampleFormatConverter which is
+ * selected in begin(). We convert max bufferSize input bytes at once. The
+ * bytes of an incomplete frame are kept and completed by the next write or
+ * read.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
-template<typename T>
-class ChannelFormatConverterStreamT : public AudioStreamX {
+class FormatConverterStreamBase : public AudioStreamX {
   public:
-        ChannelFormatConverterStreamT(Stream &stream){
+        void setStream(Stream &stream){
           p_stream = &stream;
           p_print = &stream;
         }
-        ChannelFormatConverterStreamT(Print &print){
+        void setStream(Print &print){
           p_print = &print;
         }
 
-        bool begin(int fromChannels, int toChannels){
-          from_channels = fromChannels;
-          to_channels = toChannels;
-          factor = static_cast<float>(toChannels) / static_cast<float>(fromChannels);
-
-          converter.setSourceChannels(from_channels);
-          converter.setTargetChannels(to_channels);
-
-          return true;
+        /// Defines the arena from which we take the conversion buffers
+        void setArena(ScratchArena &arena){
+          buffer.setArena(&arena);
+          bufferTmp.setArena(&arena);
+          partial.setArena(&arena);
         }
 
-        virtual size_t write(const uint8_t *data, size_t size) override { 
-           if (from_channels==to_channels){
-              return p_stream->write(data, size);
+        virtual size_t write(const uint8_t *data, size_t size) override {
+           if (p_print==nullptr) return 0;
+           if (is_copy){
+              return p_print->write(data, size);
            }
-           size_t resultBytes = convert(data, size);
-           assert(resultBytes = factor*size);
-           p_print->write((uint8_t*)buffer.data(), resultBytes);
-           return resultBytes;
+           if (!write_converter.isValid()) return 0;
+           size_t frame_size = write_converter.inputFrameSize();
+           size_t processed = 0;
+           // complete the frame which was started by the last write
+           if (partial_bytes>0){
+              size_t len = min(size, frame_size - partial_bytes);
+              memcpy(partial.data()+partial_bytes, data, len);
+              partial_bytes += len;
+              processed += len;
+              if (partial_bytes<frame_size) return size;
+              writeConverted(partial.data(), frame_size);
+              partial_bytes = 0;
+           }
+           // convert the full frames in chunks of the allocated buffer size
+           size_t chunk_size = chunk_frames * frame_size;
+           while (size-processed >= frame_size){
+              size_t len = min((size-processed) / frame_size * frame_size, chunk_size);
+              writeConverted(data+processed, len);
+              processed += len;
+           }
+           // keep the remainder for the next write
+           partial_bytes = size-processed;
+           memcpy(partial.data(), data+processed, partial_bytes);
+           return size;
         }
 
         size_t readBytes(uint8_t *data, size_t size) override {
            if (p_stream==nullptr) return 0;
-           if (from_channels==to_channels){
+           if (is_copy){
               return p_stream->readBytes(data, size);
            }
-           size_t in_bytes = 1.0 / factor * size;
-           bufferTmp.resize(in_bytes);
-           p_stream->readBytes(bufferTmp.data(), in_bytes);
-           size_t resultBytes = convert(bufferTmp.data(), in_bytes);
-           assert(size==resultBytes);
-           memcpy(data, (uint8_t*)buffer.data(),  size);
-           return size;
-        }
-
-        void setAudioInfo(AudioBaseInfo cfg) override {
-          AudioStreamX::setAudioInfo(cfg);
-          to_channels = cfg.channels;
+           if (!read_converter.isValid()) return 0;
+           // we convert directly into the provided data
+           int in_frame_size = read_converter.inputFrameSize();
+           // the stream might have been defined after begin()
+           if (!bufferTmp.resize(chunk_frames * in_frame_size)) return 0;
+           int out_frame_size = read_converter.outputFrameSize();
+           size_t result = 0;
+           while (result<size){
+              size_t frames = min((size-result) / out_frame_size, chunk_frames);
+              if (frames==0) break;
+              // the bytes of an incomplete frame are kept for the next read
+              size_t read = reader.read(*p_stream, bufferTmp.data(), frames);
+              result += read_converter.convert(bufferTmp.data(), read * in_frame_size, data+result);
+              if (read<frames) break;
+           }
+           return result;
         }
 
         virtual int available() override {
-          return p_stream!=nullptr ? factor * p_stream->available() : 0;
+          if (p_stream==nullptr) return 0;
+          if (is_copy || !read_converter.isValid()) return p_stream->available();
+          return p_stream->available() / read_converter.inputFrameSize() * read_converter.outputFrameSize();
         }
 
-        virtual int availableForWrite() override { 
-          return 1.0 / factor * p_print->availableForWrite();
+        virtual int availableForWrite() override {
+          if (p_print==nullptr) return 0;
+          if (is_copy || !write_converter.isValid()) return p_print->availableForWrite();
+          return p_print->availableForWrite() / write_converter.outputFrameSize() * write_converter.inputFrameSize();
         }
 
   protected:
     Stream *p_stream=nullptr;
     Print *p_print=nullptr;
-    int from_channels = 2;
-    int to_channels = 2;
-    float factor = 1;
-    Vector<T> buffer;
-    Vector<uint8_t> bufferTmp;
-    ChannelConverter<T> converter;
-
-    size_t convert(const uint8_t *in_data, size_t size){
-        size_t result;
-        size_t result_samples = size/sizeof(T)*factor;
-        buffer.resize(result_samples);
-        result = converter.convert((uint8_t*)buffer.data(),(uint8_t*) in_data, size);
-        if (result!=result_samples*sizeof(T)){
-          LOGE("size %d -> result: %d - expeced: %d", size, result, result_samples*sizeof(T));
-        }
-        return result;
+    SampleFormatConverter write_converter;
+    SampleFormatConverter read_converter;
+    ScratchBuffer<uint8_t> buffer;
+    ScratchBuffer<uint8_t> bufferTmp;
+    ScratchBuffer<uint8_t> partial;
+    size_t partial_bytes = 0;
+    FrameReader reader;
+    size_t chunk_frames = 0;
+    bool is_copy = false;
+
+    /// Selects the kernels: by default we read the same format which we write
+    bool setupConverter(int fromBits, int fromChannels, int toBits, int toChannels, int bufferSize){
+      is_copy = fromBits==toBits && fromChannels==toChannels;
+      if (is_copy) return true;
+      bool result = write_converter.begin(fromBits, fromChannels, toBits, toChannels)
+        && read_converter.begin(fromBits, fromChannels, toBits, toChannels);
+      return result && setupBuffers(bufferSize);
+    }
+
+    /// Allocates the conversion buffers for the selected kernels
+    bool setupBuffers(int bufferSize){
+      // we process full frames
+      chunk_frames = bufferSize / write_converter.inputFrameSize();
+      if (chunk_frames==0) chunk_frames = 1;
+      partial_bytes = 0;
+      reader.begin(read_converter.inputFrameSize());
+      return buffer.resize(chunk_frames * write_converter.outputFrameSize())
+          && partial.resize(write_converter.inputFrameSize())
+          && (p_stream==nullptr || bufferTmp.resize(chunk_frames * read_converter.inputFrameSize()));
     }
 
+    /// Converts the full frames and writes the result
+    void writeConverted(const uint8_t *data, size_t len){
+      size_t result_bytes = write_converter.convert(data, len, buffer.data());
+      p_print->write(buffer.data(), result_bytes);
+    }
 };
 
 /**
- * @brief Channel converter which does not use a template
+ * @brief Converter for reducing or increasing the number of Channels
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
-class ChannelFormatConverterStream : public AudioStreamX {
+template<typename T>
+class ChannelFormatConverterStreamT : public FormatConverterStreamBase {
   public:
-        ChannelFormatConverterStream() = default;
-
-        ChannelFormatConverterStream(Stream &stream){
+        ChannelFormatConverterStreamT(Stream &stream){
           setStream(stream);
         }
-        ChannelFormatConverterStream(Print &print){
+        ChannelFormatConverterStreamT(Print &print){
           setStream(print);
         }
 
-        void setStream(Stream &stream){
-          p_stream = &stream;
-          p_print = &stream;
-        }
-        void setStream(Print &print) {
-          p_print = &print;
+        /// Starts the processing: bufferSize is the max number of input bytes which are converted at once
+        bool begin(int fromChannels, int toChannels, int bufferSize=DEFAULT_BUFFER_SIZE){
+          from_channels = fromChannels;
+          to_channels = toChannels;
+          buffer_size = bufferSize;
+          is_copy = from_channels==to_channels;
+          if (is_copy) return true;
+          return write_converter.template begin<T,T>(from_channels, to_channels)
+            && read_converter.template begin<T,T>(from_channels, to_channels)
+            && setupBuffers(buffer_size);
         }
 
+        /// Updates the number of channels of the input data
         void setAudioInfo(AudioBaseInfo cfg) override {
           AudioStreamX::setAudioInfo(cfg);
-            switch(bits_per_sample){
-              case 8:
-                 static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->setAudioInfo(cfg);
-              case 16:
-                 static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->setAudioInfo(cfg);
-              case 24:
-                 static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->setAudioInfo(cfg);
-              case 32:
-                 static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->setAudioInfo(cfg);
-            }
+          if (cfg.channels!=from_channels){
+            begin(cfg.channels, to_channels, buffer_size);
+          }
         }
 
-        bool begin(int fromChannels, int toChannels, int bits_per_sample=16){
-          bool result = true;
-          this->bits_per_sample = bits_per_sample;
-          return setupConverter(fromChannels, toChannels);
-        }
+  protected:
+    int from_channels = 2;
+    int to_channels = 2;
+    int buffer_size = DEFAULT_BUFFER_SIZE;
+};
 
-        virtual size_t write(const uint8_t *data, size_t size) override { 
-            switch(bits_per_sample){
-              case 8:
-                return static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->write(data,size);
-              case 16:
-                return static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->write(data,size);
-              case 24:
-                return static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->write(data,size);
-              case 32:
-                return static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->write(data,size);
-              default:
-                return 0;
-            }
-        }
+/**
+ * @brief Channel converter which does not use a template
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class ChannelFormatConverterStream : public FormatConverterStreamBase {
+  public:
+        ChannelFormatConverterStream() = default;
 
-        size_t readBytes(uint8_t *data, size_t size) override {
-            switch(bits_per_sample){
-              case 8:
-                return static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->write(data,size);
-              case 16:
-                return static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->write(data,size);
-              case 24:
-                return static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->write(data,size);
-              case 32:
-                return static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->write(data,size);
-              default:
-                return 0;
-            }
+        ChannelFormatConverterStream(Stream &stream){
+          setStream(stream);
         }
-
-        virtual int available() override {
-            switch(bits_per_sample){
-              case 8:
-                return static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->available();
-              case 16:
-                return static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->available();
-              case 24:
-                return static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->available();
-              case 32:
-                return static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->available();
-              default:
-                return 0;
-            }
-        }
-
-        virtual int availableForWrite() override { 
-            switch(bits_per_sample){
-              case 8:
-                return static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->availableForWrite();
-              case 16:
-                return static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->availableForWrite();
-              case 24:
-                return static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->availableForWrite();
-              case 32:
-                return static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->availableForWrite();
-              default:
-                return 0;
-            }
+        ChannelFormatConverterStream(Print &print){
+          setStream(print);
         }
 
-  protected:
-      Stream *p_stream=nullptr;
-      Print *p_print=nullptr;
-      void *converter;
-      int bits_per_sample=0;
-
-      bool setupConverter(int fromChannels, int toChannels){
-        bool result;
-        if (p_stream!=nullptr){
-          switch(bits_per_sample){
-            case 8:
-              converter = new ChannelFormatConverterStreamT<int8_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            case 16:
-              converter = new ChannelFormatConverterStreamT<int16_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            case 24:
-              converter = new ChannelFormatConverterStreamT<int24_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            case 32:
-              converter = new ChannelFormatConverterStreamT<int32_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            default:
-              result = false;
-          }
-        } else {
-          switch(bits_per_sample){
-            case 8:
-              converter = new ChannelFormatConverterStreamT<int8_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            case 16:
-              converter = new ChannelFormatConverterStreamT<int16_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            case 24:
-              converter = new ChannelFormatConverterStreamT<int24_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            case 32:
-              converter = new ChannelFormatConverterStreamT<int32_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->begin(fromChannels,toChannels);
-              break;
-            default:
-              result = false;
+        /// Updates the number of channels and bits per sample of the input data
+        void setAudioInfo(AudioBaseInfo cfg) override {
+          AudioStreamX::setAudioInfo(cfg);
+          if (cfg.channels!=from_channels || cfg.bits_per_sample!=bits_per_sample){
+            begin(cfg.channels, to_channels, cfg.bits_per_sample);
           }
         }
-        return result;
-        
-      }
 
+        bool begin(int fromChannels, int toChannels, int bits_per_sample=16){
+          this->bits_per_sample = bits_per_sample;
+          from_channels = fromChannels;
+          to_channels = toChannels;
+          return setupConverter(bits_per_sample, from_channels, bits_per_sample, to_channels, DEFAULT_BUFFER_SIZE);
+        }
+
+  protected:
+      int from_channels = 2;
+      int to_channels = 2;
+      int bits_per_sample = 0;
 };
 
 
@@ -256,78 +219,43 @@ class ChannelFormatConverterStream : public AudioStreamX {
  * @brief Converter which converts from source bits_per_sample to target bits_per_sample
  * @author Phil Schatzmann
  * @copyright GPLv3
- * @tparam T specifies the current data type for the result of the read or write. 
+ * @tparam T specifies the current data type for the result of the read or write.
  * @tparam TArg is the data type of the Stream or Print Object that is passed in the Constructor
  */
 
 template<typename T, typename TArg >
-class NumberFormatConverterStreamT : public AudioStreamX {
+class NumberFormatConverterStreamT : public FormatConverterStreamBase {
   public:
-        NumberFormatConverterStreamT() = default;
+        NumberFormatConverterStreamT() {
+          begin();
+        }
 
         NumberFormatConverterStreamT(Stream &stream){
           setStream(stream);
+          begin();
         }
         NumberFormatConverterStreamT(Print &print){
           setStream(print);
+          begin();
         }
 
-        void setStream(Stream &stream){
-          p_stream = &stream;
-          p_print = &stream;
-        }
-        void setStream(Print &print){
-          p_print = &print;
-        }
-
-        bool begin(){
-          return true;
-        }
-
-        virtual size_t write(const uint8_t *data, size_t size) override { 
-           size_t samples = size / sizeof(T);
-           size_t result_size = 0;
-           T *data_source = (T *)data;
-           
-           for (int j=0;j<samples;j++){
-             TArg value = static_cast<float>(data_source[j]) * NumberConverter::maxValue(sizeof(TArg)*8) / NumberConverter::maxValue(sizeof(T)*8);
-             result_size += p_print->write((uint8_t*)&value, sizeof(TArg));
-           }
-           return result_size;
-        }
-
-        size_t readBytes(uint8_t *data, size_t size) override {
-           if (p_stream==nullptr) return 0;
-           size_t samples = size / sizeof(T);
-           T *data_target = (T *)data;
-           TArg source;
-           for (int j=0;j<samples;j++){
-             source = 0;
-             p_stream->readBytes((uint8_t*)&source, sizeof(TArg));
-             data_target[j]= static_cast<float>(source) * NumberConverter::maxValue(sizeof(T)*8) / NumberConverter::maxValue(sizeof(TArg)*8);
-           }
-           return size;
+        bool begin(int bufferSize=DEFAULT_BUFFER_SIZE){
+          // we write T and read TArg
+          return write_converter.template begin<T,TArg>(1, 1)
+            && read_converter.template begin<TArg,T>(1, 1)
+            && setupBuffers(bufferSize);
         }
-
-        virtual int available() override {
-          return p_stream!=nullptr ? p_stream->available() : 0;
-        }
-
-        virtual int availableForWrite() override { 
-          return p_print->availableForWrite();
-        }
-
-  protected:
-    Stream *p_stream=nullptr;
-    Print *p_print=nullptr;
 };
 
 /**
- * @brief Converter which converts between bits_per_sample and 16 bits
+ * @brief Converter which converts between bits_per_sample and 16 bits. 24 bit
+ * samples are expected in 32 bit containers (using the full 32 bit range), so
+ * 24 bits are processed like 32 bits. Use the FormatConverterStream for packed
+ * 3 byte samples.
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
-class NumberFormatConverterStream :  public AudioStreamX {
+class NumberFormatConverterStream : public FormatConverterStreamBase {
   public:
         NumberFormatConverterStream() = default;
 
@@ -338,176 +266,36 @@ class NumberFormatConverterStream :  public AudioStreamX {
           setStream(print);
         }
 
-        void setStream(Stream &stream){
-          p_stream = &stream;
-          p_print = &stream;
-        }
-        void setStream(Print &print) {
-          p_print = &print;
-        }
-
         bool begin(int from_bit_per_samples, int to_bit_per_samples){
-          bool result = true;
           this->from_bit_per_samples = from_bit_per_samples;
           this->to_bit_per_samples = to_bit_per_samples;
-    
-          if (from_bit_per_samples==to_bit_per_samples){
+          is_copy = from_bit_per_samples==to_bit_per_samples;
+          if (is_copy){
             LOGI("no bit combination: %d -> %d",from_bit_per_samples, to_bit_per_samples);
-          } else if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-            converter = new NumberFormatConverterStreamT<int8_t,int16_t>();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-            converter = new NumberFormatConverterStreamT<int16_t,int8_t>();
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-            converter = new NumberFormatConverterStreamT<int32_t,int16_t>();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-            converter = new NumberFormatConverterStreamT<int16_t,int32_t>();
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-            converter = new NumberFormatConverterStreamT<int32_t,int16_t>();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-            converter = new NumberFormatConverterStreamT<int16_t,int32_t>();
-          } else {
-            result = false;
-            LOGE("bit combination not supported %d -> %d",from_bit_per_samples, to_bit_per_samples);
-          }
-
-          setupStream();
-
-          return result;
-        }
-
-        virtual size_t write(const uint8_t *data, size_t size) override { 
-          if (from_bit_per_samples==to_bit_per_samples){
-            return p_print->write(data, size);
-          }
-
-          if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int8_t,int16_t>*>(converter)->write(data,size);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int8_t>*>(converter)->write(data,size);
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->write(data,size);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->write(data,size);
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->write(data,size);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->write(data,size);
-          } else {
-            return 0;
-          }
-        }
-
-        size_t readBytes(uint8_t *data, size_t size) override {
-          if (from_bit_per_samples==to_bit_per_samples){
-            return p_stream->readBytes(data, size);
-          }
-          if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int8_t,int16_t>*>(converter)->readBytes(data,size);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int8_t>*>(converter)->readBytes(data,size);
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->readBytes(data,size);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->readBytes(data,size);
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->readBytes(data,size);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->readBytes(data,size);
-          } else {
-            return 0;
-          } 
-        }
-
-        virtual int available() override {
-          if (from_bit_per_samples==to_bit_per_samples){
-            return p_stream->available();
-          }
-          if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int8_t,int16_t>*>(converter)->available();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int8_t>*>(converter)->available();
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->available();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->available();
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->available();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->available();
-          } else {
-            return 0;
-          } 
-        }
-
-        virtual int availableForWrite() override { 
-          if (from_bit_per_samples==to_bit_per_samples){
-            return p_print->availableForWrite();
+            return true;
           }
-          if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int8_t,int16_t>*>(converter)->availableForWrite();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int8_t>*>(converter)->availableForWrite();
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->availableForWrite();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->availableForWrite();
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-             return static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->availableForWrite();
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-             return static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->availableForWrite();
-          } else {
-            return 0;
-          } 
+          // 24 bit samples are stored in 32 bit containers
+          int from_bits = from_bit_per_samples==24 ? 32 : from_bit_per_samples;
+          int to_bits = to_bit_per_samples==24 ? 32 : to_bit_per_samples;
+          // we write from_bit_per_samples and read to_bit_per_samples
+          return write_converter.begin(from_bits, 1, to_bits, 1)
+            && read_converter.begin(to_bits, 1, from_bits, 1)
+            && setupBuffers(DEFAULT_BUFFER_SIZE);
         }
 
   protected:
-    Stream *p_stream=nullptr;
-    Print *p_print=nullptr;
-    void *converter=nullptr;
     int from_bit_per_samples=0;
     int to_bit_per_samples=0;
-
-    void setupStream() {
-        if (p_stream!=nullptr){
-          if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-              static_cast<NumberFormatConverterStreamT<int8_t,int16_t>*>(converter)->setStream(*p_stream);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-              static_cast<NumberFormatConverterStreamT<int16_t,int8_t>*>(converter)->setStream(*p_stream);
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-              static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->setStream(*p_stream);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-              static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->setStream(*p_stream);
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-              static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->setStream(*p_stream);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-              static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->setStream(*p_stream);
-          } 
-        } else {
-          if (from_bit_per_samples==8 &&to_bit_per_samples==16){
-              static_cast<NumberFormatConverterStreamT<int8_t,int16_t>*>(converter)->setStream(*p_print);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==8){
-              static_cast<NumberFormatConverterStreamT<int16_t,int8_t>*>(converter)->setStream(*p_print);
-          } else if (from_bit_per_samples==24 &&to_bit_per_samples==16){
-              static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->setStream(*p_print);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==24){
-              static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->setStream(*p_print);
-          } else if (from_bit_per_samples==32 &&to_bit_per_samples==16){
-              static_cast<NumberFormatConverterStreamT<int32_t,int16_t>*>(converter)->setStream(*p_print);
-          } else if (from_bit_per_samples==16 &&to_bit_per_samples==32){
-              static_cast<NumberFormatConverterStreamT<int16_t,int32_t>*>(converter)->setStream(*p_print);
-          } 
-        }
-    }
 };
 
 
 /**
- * @brief Converter which converts bits_per_sample and channels
+ * @brief Converter which converts bits_per_sample and channels in one pass
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
 
-class FormatConverterStream : public AudioStreamX {
+class FormatConverterStream : public FormatConverterStreamBase {
   public:
         FormatConverterStream() = default;
 
@@ -519,23 +307,14 @@ class FormatConverterStream : public AudioStreamX {
         }
 
         FormatConverterStream(AudioStream &stream){
-          setSourceAudioInfo(stream.audioInfo());  
+          setSourceAudioInfo(stream.audioInfo());
           setStream(stream);
         }
         FormatConverterStream(AudioPrint &print){
-          setSourceAudioInfo(print.audioInfo());  
+          setSourceAudioInfo(print.audioInfo());
           setStream(print);
         }
 
-        void setStream(Stream &stream){
-          p_stream = &stream;
-          p_print = &stream;
-        }
-
-        void setStream(Print &print){
-          p_print = &print;
-        }
-
         /// Defines the audio info of the stream which has been defined in the constructor
         void setSourceAudioInfo(AudioBaseInfo from){
           from_cfg = from;
@@ -549,44 +328,48 @@ class FormatConverterStream : public AudioStreamX {
         bool begin(AudioBaseInfo to){
           setAudioInfo(to);
           to_cfg = to;
-          if (p_stream!=nullptr){
-            numberFormatConverter.setStream(*p_stream);
-            channelFormatConverter.setStream(numberFormatConverter);
-          } else {
-            numberFormatConverter.setStream(*p_print);
-            channelFormatConverter.setStream(numberFormatConverter);
-          }
-          bool result = numberFormatConverter.begin(from_cfg.bits_per_sample, to_cfg.bits_per_sample);
-          if (result){
-            result =  channelFormatConverter.begin(to_cfg.bits_per_sample, from_cfg.channels, to_cfg.channels);
-          }
-          return result;
+          return setupConverter(from_cfg.bits_per_sample, from_cfg.channels, to_cfg.bits_per_sample, to_cfg.channels, DEFAULT_BUFFER_SIZE);
         }
 
-        virtual size_t write(const uint8_t *data, size_t size) override { 
-          return channelFormatConverter.write(data, size);
-        }
+  protected:
+    AudioBaseInfo from_cfg;
+    AudioBaseInfo to_cfg;
+};
 
-        size_t readBytes(uint8_t *data, size_t size) override {
-          return channelFormatConverter.readBytes(data, size);
-        }
+/// Direction of the conversion of the FloatFormatConverterStream
+enum FloatConversion { PCMToFloat, FloatToPCM };
 
-        virtual int available() override {
-          return channelFormatConverter.available();
-        }
+/**
+ * @brief Converts integer PCM data to float samples in the range of -1.0 to 1.0
+ * (PCMToFloat) or float samples to integer PCM data (FloatToPCM). This is used
+ * at the ingress (e.g. after the decoder) and at the egress (e.g. before I2S)
+ * of a float pipeline, so that the stages in between can process the data as float
+ * without any further conversions: e.g. the ParametricEqualizer, Equilizer3Bands,
+ * VolumeStream and AudioFFT with use_float and FilteredStream<float, float>.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FloatFormatConverterStream : public FormatConverterStreamBase {
+  public:
+        FloatFormatConverterStream() = default;
 
-        virtual int availableForWrite() override { 
-          return channelFormatConverter.availableForWrite();
+        FloatFormatConverterStream(Stream &stream){
+          setStream(stream);
+        }
+        FloatFormatConverterStream(Print &print){
+          setStream(print);
         }
 
-  protected:
-    AudioBaseInfo from_cfg;
-    AudioBaseInfo to_cfg;
-    Stream *p_stream=nullptr;
-    Print *p_print=nullptr;
-    NumberFormatConverterStream numberFormatConverter;
-    ChannelFormatConverterStream channelFormatConverter;
+        /// The integer data has the indicated bits_per_sample: the number of channels
+        /// does not change, so we process the data as one channel
+        bool begin(int bitsPerSample, FloatConversion conversion, int bufferSize=DEFAULT_BUFFER_SIZE){
+          is_copy = false;
+          bool result = conversion==PCMToFloat
+            ? write_converter.beginToFloat(bitsPerSample) && read_converter.beginToFloat(bitsPerSample)
+            : write_converter.beginFromFloat(bitsPerSample) && read_converter.beginFromFloat(bitsPerSample);
+          return result && setupBuffers(bufferSize);
+        }
 };
 
 
-} // namespace
\ No newline at end of file
+} // namespace
@@ -0,0 +1,388 @@
+#pragma once
+#include "AudioConfig.h"
+#include "AudioTools/AudioStreams.h"
+#include "AudioBasic/Vector.h"
+#ifdef IS_DESKTOP
+#include <stdio.h>
+#endif
+
+#ifndef TRACE_MAX_STAGES
+#define TRACE_MAX_STAGES 8
+#endif
+
+#ifndef TRACE_CAPTURE_MARKS
+#define TRACE_CAPTURE_MARKS 64
+#endif
+
+#ifndef TRACE_MAX_EVENTS
+#define TRACE_MAX_EVENTS 100000
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Histogram of time values in us with logarithmic buckets (4 buckets
+ * per octave, so the relative error is below 25%) which supports the
+ * determination of percentiles w/o storing the individual values.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram() { clear(); }
+
+  /// Records a value
+  void add(uint32_t us) {
+    buckets[bucket(us)]++;
+    if (us > max_value) max_value = us;
+    total_count++;
+  }
+
+  /// Provides the value below which p percent (0-100) of the values are
+  uint32_t percentile(float p) {
+    if (total_count == 0) return 0;
+    uint32_t limit = ceil(p / 100.0f * total_count);
+    uint32_t sum = 0;
+    for (int j = 0; j < bucket_count; j++) {
+      sum += buckets[j];
+      if (sum >= limit && sum > 0) {
+        return min(bucketValue(j), max_value);
+      }
+    }
+    return max_value;
+  }
+
+  /// Max recorded value
+  uint32_t maxValue() { return max_value; }
+
+  /// Number of recorded values
+  uint32_t count() { return total_count; }
+
+  void clear() {
+    memset(buckets, 0, sizeof(buckets));
+    max_value = 0;
+    total_count = 0;
+  }
+
+ protected:
+  static const int octaves = 24;
+  static const int bucket_count = 4 + octaves * 4;
+  uint32_t buckets[bucket_count];
+  uint32_t max_value;
+  uint32_t total_count;
+
+  /// values < 4 are exact, then we have 4 buckets per power of 2
+  static int bucket(uint32_t us) {
+    if (us < 4) return us;
+    int msb = 31 - __builtin_clz(us);
+    int sub = (us >> (msb - 2)) & 3;
+    int result = 4 + (msb - 2) * 4 + sub;
+    return result < bucket_count ? result : bucket_count - 1;
+  }
+
+  /// Upper limit of the values in the bucket
+  static uint32_t bucketValue(int idx) {
+    if (idx < 4) return idx;
+    int msb = (idx - 4) / 4 + 2;
+    int sub = (idx - 4) % 4;
+    uint32_t lower = (uint32_t)(4 + sub) << (msb - 2);
+    return lower + (1u << (msb - 2)) - 1;
+  }
+};
+
+/**
+ * @brief Collects the processing time and the latency of the audio chunks
+ * in the different stages of a pipeline (e.g. i2s read, encoder, transport,
+ * decoder, output). The capturing stage marks the time when the data was
+ * captured and each subsequent stage determines the age of the processed
+ * data from its position in the stream. The results are reported as
+ * histograms (p50/p99/max). On the desktop we can also export a Chrome
+ * trace file which can be loaded with chrome://tracing or Perfetto.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioTracer {
+ public:
+  /// Shared tracer which is used by default by the TracingStream
+  static AudioTracer &instance() {
+    static AudioTracer tracer;
+    return tracer;
+  }
+
+  ~AudioTracer() {
+    for (int j = 0; j < stage_count; j++) {
+      delete stages[j];
+    }
+  }
+
+  /// Registers a stage: returns the id which is used for the recording or -1
+  int addStage(const char *name) {
+    if (stage_count >= TRACE_MAX_STAGES) {
+      LOGE("Too many stages: increase TRACE_MAX_STAGES");
+      return -1;
+    }
+    Stage *stage = new Stage();
+    stage->name = name;
+    stages[stage_count] = stage;
+    return stage_count++;
+  }
+
+  /// Marks the capture of len bytes: call after the data was captured
+  void capture(size_t len) {
+    if (!is_active) return;
+    captured_bytes += len;
+    CaptureMark &mark = marks[mark_count % TRACE_CAPTURE_MARKS];
+    mark.end_pos = captured_bytes;
+    mark.time_us = micros();
+    mark_count++;
+  }
+
+  /// Records a processed chunk: capturePos is the position of the last byte
+  /// of the chunk in the captured data
+  void record(int stageId, uint32_t startUs, uint32_t durationUs,
+              uint64_t capturePos) {
+    if (!is_active || stageId < 0 || stageId >= stage_count) return;
+    Stage *stage = stages[stageId];
+    stage->processing.add(durationUs);
+    int32_t age = captureAge(capturePos, startUs + durationUs);
+    if (age >= 0) stage->latency.add(age);
+#ifdef IS_DESKTOP
+    if (is_event_recording && events.size() < TRACE_MAX_EVENTS) {
+      TraceEvent event;
+      event.stage = stageId;
+      event.start_us = startUs;
+      event.duration_us = durationUs;
+      event.latency_us = age;
+      events.push_back(event);
+    }
+#endif
+  }
+
+  /// Activates/deactivates the recording
+  void setActive(bool active) { is_active = active; }
+
+  bool isActive() { return is_active; }
+
+  /// Number of registered stages
+  int size() { return stage_count; }
+
+  const char *stageName(int stageId) { return stages[stageId]->name; }
+
+  /// Histogram of the time which was spent in the stage
+  LatencyHistogram &processingTime(int stageId) {
+    return stages[stageId]->processing;
+  }
+
+  /// Histogram of the time since the capture when the stage has completed
+  LatencyHistogram &latency(int stageId) { return stages[stageId]->latency; }
+
+  /// Prints p50/p99/max of the processing time and of the latency per stage
+  void printStatistics(Print &out) {
+    char msg[160];
+    for (int j = 0; j < stage_count; j++) {
+      LatencyHistogram &p = stages[j]->processing;
+      LatencyHistogram &l = stages[j]->latency;
+      snprintf(msg, sizeof(msg),
+               "%s: chunks %u - time us p50 %u p99 %u max %u - latency us "
+               "p50 %u p99 %u max %u",
+               stages[j]->name, (unsigned)p.count(),
+               (unsigned)p.percentile(50), (unsigned)p.percentile(99),
+               (unsigned)p.maxValue(), (unsigned)l.percentile(50),
+               (unsigned)l.percentile(99), (unsigned)l.maxValue());
+      out.println(msg);
+    }
+  }
+
+  /// Resets the collected statistics
+  void clear() {
+    for (int j = 0; j < stage_count; j++) {
+      stages[j]->processing.clear();
+      stages[j]->latency.clear();
+    }
+#ifdef IS_DESKTOP
+    events.clear();
+#endif
+  }
+
+#ifdef IS_DESKTOP
+  /// Activates the recording of the individual chunks for the Chrome trace
+  void setEventRecording(bool active) { is_event_recording = active; }
+
+  /// Writes the recorded chunks as Chrome trace json file
+  bool writeChromeTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+      LOGE("Could not open %s", path);
+      return false;
+    }
+    fprintf(file, "{\"traceEvents\":[\n");
+    // name the tracks by the stages
+    for (int j = 0; j < stage_count; j++) {
+      fprintf(file,
+              "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+              "\"args\":{\"name\":",
+              j);
+      writeJsonString(file, stages[j]->name);
+      fprintf(file, "}},\n");
+    }
+    for (int j = 0; j < events.size(); j++) {
+      TraceEvent &e = events[j];
+      fprintf(file, "{\"name\":");
+      writeJsonString(file, stages[e.stage]->name);
+      fprintf(file,
+              ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%u,"
+              "\"dur\":%u,\"args\":{\"latency_us\":%d}}%s\n",
+              e.stage, (unsigned)e.start_us,
+              (unsigned)e.duration_us, (int)e.latency_us,
+              j < events.size() - 1 ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+    return true;
+  }
+#endif
+
+ protected:
+  struct Stage {
+    const char *name = nullptr;
+    LatencyHistogram processing;
+    LatencyHistogram latency;
+  };
+  struct CaptureMark {
+    uint64_t end_pos = 0;
+    uint32_t time_us = 0;
+  };
+  Stage *stages[TRACE_MAX_STAGES];
+  int stage_count = 0;
+  CaptureMark marks[TRACE_CAPTURE_MARKS];
+  volatile uint32_t mark_count = 0;
+  uint64_t captured_bytes = 0;
+  bool is_active = true;
+#ifdef IS_DESKTOP
+  struct TraceEvent {
+    int stage;
+    uint32_t start_us;
+    uint32_t duration_us;
+    int32_t latency_us;
+  };
+  Vector<TraceEvent> events;
+  bool is_event_recording = true;
+
+  /// Writes the string as quoted json string: quotes, backslashes and control
+  /// characters are escaped
+  void writeJsonString(FILE *file, const char *str) {
+    fputc('"', file);
+    for (const char *p = str == nullptr ? "" : str; *p != 0; p++) {
+      unsigned char c = *p;
+      if (c == '"' || c == '\\') {
+        fputc('\\', file);
+        fputc(c, file);
+      } else if (c < 0x20) {
+        fprintf(file, "\\u%04x", c);
+      } else {
+        fputc(c, file);
+      }
+    }
+    fputc('"', file);
+  }
+#endif
+
+  /// Determines the time in us since the capture of the byte at the
+  /// indicated position: -1 if it is not known (any more)
+  int32_t captureAge(uint64_t capturePos, uint32_t nowUs) {
+    uint32_t count = mark_count;
+    if (count == 0 || capturePos == 0) return -1;
+    int32_t result = -1;
+    // search backwards for the first chunk which contains the position
+    int n = min(count, (uint32_t)TRACE_CAPTURE_MARKS);
+    for (int j = 1; j <= n; j++) {
+      CaptureMark &mark = marks[(count - j) % TRACE_CAPTURE_MARKS];
+      if (mark.end_pos < capturePos) break;
+      result = nowUs - mark.time_us;
+    }
+    return result;
+  }
+};
+
+/**
+ * @brief Stream which records the processing time and latency of each chunk
+ * which is read or written through it in the AudioTracer. Wrap each stage
+ * that you want to trace:
+ *
+ * TracingStream trace_in("i2s", i2s, true);  // capture: readBytes from i2s
+ * TracingStream trace_enc("encoder", encoder);
+ * TracingStream trace_out("kit", kit);
+ *
+ * If a stage changes the number of bytes (e.g. an encoder or decoder) we
+ * define the factor to convert the bytes of the stage to the captured bytes.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class TracingStream : public AudioStreamX {
+ public:
+  TracingStream(const char *name, Print &print, bool isCapture = false,
+                AudioTracer &tracer = AudioTracer::instance()) {
+    p_print = &print;
+    setup(name, isCapture, tracer);
+  }
+
+  TracingStream(const char *name, Stream &stream, bool isCapture = false,
+                AudioTracer &tracer = AudioTracer::instance()) {
+    p_stream = &stream;
+    p_print = &stream;
+    setup(name, isCapture, tracer);
+  }
+
+  /// Factor to convert the bytes of this stage to the captured bytes
+  void setBytesFactor(float factor) { bytes_factor = factor; }
+
+  size_t readBytes(uint8_t *data, size_t len) override {
+    if (p_stream == nullptr) return 0;
+    uint32_t start = micros();
+    size_t result = p_stream->readBytes(data, len);
+    trace(start, result);
+    return result;
+  }
+
+  int available() override {
+    return p_stream == nullptr ? 0 : p_stream->available();
+  }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    uint32_t start = micros();
+    size_t result = p_print->write(data, len);
+    trace(start, result);
+    return result;
+  }
+
+  int availableForWrite() override { return p_print->availableForWrite(); }
+
+  /// Id of the stage in the tracer
+  int stageId() { return stage_id; }
+
+ protected:
+  AudioTracer *p_tracer = nullptr;
+  Stream *p_stream = nullptr;
+  Print *p_print = nullptr;
+  int stage_id = -1;
+  bool is_capture = false;
+  float bytes_factor = 1.0f;
+  uint64_t processed_bytes = 0;
+
+  void setup(const char *name, bool isCapture, AudioTracer &tracer) {
+    p_tracer = &tracer;
+    is_capture = isCapture;
+    stage_id = tracer.addStage(name);
+  }
+
+  void trace(uint32_t start, size_t len) {
+    if (len == 0) return;
+    if (is_capture) p_tracer->capture(len);
+    processed_bytes += len;
+    uint32_t duration = micros() - start;
+    p_tracer->record(stage_id, start, duration,
+                     (uint64_t)(processed_bytes * bytes_factor));
+  }
+};
+
+}  // namespace audio_tools
@@ -2,6 +2,7 @@
 
 #include "AudioConfig.h"
 #include "AudioBasic/Int24.h"
+#include "AudioTools/AudioNotifier.h"
 
 namespace audio_tools {
 
@@ -73,6 +74,37 @@ class AudioBaseInfoSource {
 
 
 
+/**
+ * @brief Optional zero copy access to the buffer of a stream: a source can
+ * lend its readable data and a sink the memory into which we can write directly.
+ * A stream can also provide notifiers which signal that data or space became
+ * available, so that we do not need to poll. By default nothing is provided (nullptr).
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BufferProvider {
+    public:
+      virtual ~BufferProvider(){}
+      /// Provides the next readable data w/o copying: len is set to the number of bytes
+      virtual uint8_t *peekSpan(size_t &len) {
+        len = 0;
+        return nullptr;
+      }
+      /// Confirms that len bytes which were provided by peekSpan() have been consumed
+      virtual size_t commitRead(size_t len) { return 0; }
+      /// Provides the memory into which we can write directly: len is set to the number of bytes
+      virtual uint8_t *writeSpan(size_t &len) {
+        len = 0;
+        return nullptr;
+      }
+      /// Confirms that len bytes have been written into the memory provided by writeSpan()
+      virtual size_t commitWrite(size_t len) { return 0; }
+      /// Notifier which is signaled when new data can be read
+      virtual AudioNotifier *dataNotifier() { return nullptr; }
+      /// Notifier which is signaled when space for writing became available
+      virtual AudioNotifier *spaceNotifier() { return nullptr; }
+};
+
 /**
  * @brief E.g. used by Encoders and Decoders
  * 
@@ -1,18 +1,18 @@
 
 #pragma once
 
+#include "AudioBasic/AllocationCounter.h"
 #include "AudioBasic/Vector.h"
 #include "AudioTools/AudioLogger.h"
+#ifdef USE_ATOMIC
+#include <atomic>
+#endif
 
 #undef MIN
 #define MIN(A, B) ((A) < (B) ? (A) : (B))
 
 namespace audio_tools {
 
-// forward declaration
-template <typename T>
-class NBuffer;
-
 /**
  * @brief Shared functionality of all buffers
  * @author Phil Schatzmann
@@ -27,7 +27,7 @@ class BaseBuffer {
   virtual T read() = 0;
 
   // reads multiple values
-  int readArray(T data[], int len) {
+  virtual int readArray(T data[], int len) {
     int lenResult = MIN(len, available());
     for (int j = 0; j < lenResult; j++) {
       data[j] = read();
@@ -35,7 +35,8 @@ class BaseBuffer {
     return lenResult;
   }
 
-  int writeArray(const T data[], int len) {
+  // writes multiple values
+  virtual int writeArray(const T data[], int len) {
     LOGD("%s: %d", LOG_METHOD, len);
     //CHECK_MEMORY();
 
@@ -100,10 +101,25 @@ class BaseBuffer {
   // returns the address of the start of the physical read buffer
   virtual T *address() = 0;
 
- protected:
-  void setWritePos(int pos){};
+  /// Provides direct access to the next contiguous block of readable entries:
+  /// len is set to the number of entries. Returns nullptr if not supported.
+  virtual T *peekSpan(int &len) {
+    len = 0;
+    return nullptr;
+  }
 
-  friend NBuffer<T>;
+  /// Marks len entries which were provided by peekSpan() as consumed
+  virtual int commitRead(int len) { return 0; }
+
+  /// Provides direct access to the next contiguous block of writable entries:
+  /// len is set to the number of entries. Returns nullptr if not supported.
+  virtual T *writeSpan(int &len) {
+    len = 0;
+    return nullptr;
+  }
+
+  /// Marks len entries which were filled via writeSpan() as available
+  virtual int commitWrite(int len) { return 0; }
 };
 
 /**
@@ -124,6 +140,7 @@ class SingleBuffer : public BaseBuffer<T> {
   SingleBuffer(int size) {
     this->max_size = size;
     buffer = new T[max_size];
+    AllocationCounter::recordAllocation(sizeof(T) * max_size);
     reset();
   }
 
@@ -175,6 +192,46 @@ class SingleBuffer : public BaseBuffer<T> {
     return result;
   }
 
+  /// reads multiple values with a single memcpy
+  int readArray(T data[], int len) override {
+    int result = MIN(len, available());
+    if (buffer == nullptr || result <= 0) return 0;
+    memcpy(data, buffer + current_read_pos, result * sizeof(T));
+    current_read_pos += result;
+    return result;
+  }
+
+  /// writes multiple values with a single memcpy
+  int writeArray(const T data[], int len) override {
+    int result = MIN(len, availableForWrite());
+    if (buffer == nullptr || result <= 0) return 0;
+    memcpy(buffer + current_write_pos, data, result * sizeof(T));
+    current_write_pos += result;
+    return result;
+  }
+
+  T *peekSpan(int &len) override {
+    len = buffer == nullptr ? 0 : available();
+    return len > 0 ? buffer + current_read_pos : nullptr;
+  }
+
+  int commitRead(int len) override {
+    int result = MIN(len, available());
+    current_read_pos += result;
+    return result;
+  }
+
+  T *writeSpan(int &len) override {
+    len = buffer == nullptr ? 0 : availableForWrite();
+    return len > 0 ? buffer + current_write_pos : nullptr;
+  }
+
+  int commitWrite(int len) override {
+    int result = MIN(len, availableForWrite());
+    current_write_pos += result;
+    return result;
+  }
+
   int available() {
     int result = current_write_pos - current_read_pos;
     return max(result, 0);
@@ -206,8 +263,6 @@ class SingleBuffer : public BaseBuffer<T> {
   int current_write_pos = 0;
   bool owns_buffer = true;
   T *buffer = nullptr;
-
-  void setWritePos(int pos) { current_write_pos = pos; }
 };
 
 /**
@@ -259,6 +314,60 @@ class RingBuffer : public BaseBuffer<T> {
     return result;
   }
 
+  /// reads multiple values: copies at most 2 contiguous segments
+  virtual int readArray(T data[], int len) override {
+    int result = MIN(len, _numElems);
+    if (result <= 0) return 0;
+    int first = MIN(result, max_size - _iTail);
+    memcpy(data, _aucBuffer + _iTail, first * sizeof(T));
+    if (result > first) {
+      memcpy(data + first, _aucBuffer, (result - first) * sizeof(T));
+    }
+    _iTail = addIndex(_iTail, result);
+    _numElems -= result;
+    return result;
+  }
+
+  /// writes multiple values: copies at most 2 contiguous segments
+  virtual int writeArray(const T data[], int len) override {
+    int result = MIN(len, availableForWrite());
+    if (result <= 0) return 0;
+    int first = MIN(result, max_size - _iHead);
+    memcpy(_aucBuffer + _iHead, data, first * sizeof(T));
+    if (result > first) {
+      memcpy(_aucBuffer, data + first, (result - first) * sizeof(T));
+    }
+    _iHead = addIndex(_iHead, result);
+    _numElems += result;
+    return result;
+  }
+
+  /// Provides the readable entries up to the physical end of the buffer
+  virtual T *peekSpan(int &len) override {
+    len = MIN(_numElems, max_size - _iTail);
+    return len > 0 ? _aucBuffer + _iTail : nullptr;
+  }
+
+  virtual int commitRead(int len) override {
+    int result = MIN(len, _numElems);
+    _iTail = addIndex(_iTail, result);
+    _numElems -= result;
+    return result;
+  }
+
+  /// Provides the writable entries up to the physical end of the buffer
+  virtual T *writeSpan(int &len) override {
+    len = MIN(availableForWrite(), max_size - _iHead);
+    return len > 0 ? _aucBuffer + _iHead : nullptr;
+  }
+
+  virtual int commitWrite(int len) override {
+    int result = MIN(len, availableForWrite());
+    _iHead = addIndex(_iHead, result);
+    _numElems += result;
+    return result;
+  }
+
   // clears the buffer
   virtual void reset() {
     _iHead = 0;
@@ -282,6 +391,7 @@ class RingBuffer : public BaseBuffer<T> {
     this->max_size = len;
     if (len>0){
       _aucBuffer = new T[max_size];
+      AllocationCounter::recordAllocation(sizeof(T) * max_size);
     }
     reset();
   }
@@ -298,12 +408,279 @@ class RingBuffer : public BaseBuffer<T> {
   int _numElems;
   int max_size = 0;
 
-  int nextIndex(int index) { return (uint32_t)(index + 1) % max_size; }
+  int nextIndex(int index) { return index + 1 >= max_size ? 0 : index + 1; }
+
+  /// advances the index by len (<= max_size) w/o using a modulo
+  int addIndex(int index, int len) {
+    index += len;
+    return index >= max_size ? index - max_size : index;
+  }
 };
 
+#ifdef USE_ATOMIC
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/// What to do when a LockFreeRingBuffer is full
+enum OverflowPolicy { DropNewest, DropOldest };
+
+/**
+ * @brief Lock free single producer / single consumer ring buffer: one task
+ * (e.g. a WiFi callback) writes while an other task reads. A write never
+ * blocks: if the buffer is full we drop the newest or the oldest data
+ * according to the OverflowPolicy. The capacity is rounded up to a power of 2.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <typename T>
+class LockFreeRingBuffer : public BaseBuffer<T> {
+ public:
+  LockFreeRingBuffer(int size, OverflowPolicy policy = DropNewest) {
+    this->policy = policy;
+    resize(size);
+  }
+
+  ~LockFreeRingBuffer() { delete[] p_data; }
+
+  /// (Re)allocates the buffer: this is not thread safe
+  void resize(int size) {
+    if (p_data != nullptr) {
+      delete[] p_data;
+      p_data = nullptr;
+    }
+    capacity = 1;
+    while (capacity < (uint32_t)size) capacity <<= 1;
+    mask = capacity - 1;
+    p_data = new T[capacity];
+    AllocationCounter::recordAllocation(sizeof(T) * capacity);
+    if (p_data == nullptr) {
+      LOGE("Not Enough Memory for buffer %d", capacity);
+    }
+    producer.head.store(0);
+    consumer.tail.store(0);
+    consumer.span_tail = 0;
+  }
+
+  /// Defines the behaviour if the buffer is full
+  void setOverflowPolicy(OverflowPolicy policy) { this->policy = policy; }
+
+  // reads a single value
+  T read() override {
+    T result = 0;
+    readArray(&result, 1);
+    return result;
+  }
+
+  // peeks the actual entry from the buffer
+  T peek() override {
+    uint32_t tail = consumer.tail.load(std::memory_order_acquire);
+    if (producer.head.load(std::memory_order_acquire) == tail) return 0;
+    return p_data[tail & mask];
+  }
+
+  /// Consumer: reads multiple values
+  int readArray(T data[], int len) override {
+    while (true) {
+      uint32_t tail = consumer.tail.load(std::memory_order_acquire);
+      uint32_t head = producer.head.load(std::memory_order_acquire);
+      int result = MIN(len, (int)MIN(head - tail, capacity));
+      if (result <= 0) return 0;
+      copyFrom(tail, data, result);
+      // fails only if the producer has dropped the oldest data in between
+      if (consumer.tail.compare_exchange_weak(tail, tail + result,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        return result;
+      }
+    }
+  }
+
+  /// Producer: writes multiple values w/o blocking
+  int writeArray(const T data[], int len) override {
+    if (len <= 0) return 0;
+    uint32_t head = producer.head.load(std::memory_order_relaxed);
+    uint32_t tail = consumer.tail.load(std::memory_order_acquire);
+    int open = capacity - (head - tail);
+    if (len > open) {
+      uint32_t dropped = 0;
+      if (policy == DropNewest) {
+        dropped = len - open;
+        len = open;
+      } else {
+        if (len > (int)capacity) {
+          // only the last part fits at all
+          dropped = len - capacity;
+          data += len - capacity;
+          len = capacity;
+        }
+        dropped += dropOldest(head, tail, len);
+      }
+      // the consumer might have made space in between
+      if (dropped > 0) addDropped(dropped);
+    }
+    if (len > 0) {
+      copyTo(head, data, len);
+      producer.head.store(head + len, std::memory_order_release);
+    }
+    return len;
+  }
+
+  // write add an entry to the buffer
+  bool write(T data) override { return writeArray(&data, 1) == 1; }
+
+  // checks if the buffer is full
+  bool isFull() override { return availableForWrite() == 0; }
+
+  // clears the buffer: must be called by the consumer
+  void reset() override {
+    consumer.tail.store(producer.head.load(std::memory_order_acquire),
+                         std::memory_order_release);
+  }
+
+  // provides the number of entries that are available to read
+  int available() override {
+    uint32_t tail = consumer.tail.load(std::memory_order_acquire);
+    uint32_t head = producer.head.load(std::memory_order_acquire);
+    return MIN(head - tail, capacity);
+  }
+
+  // provides the number of entries that are available to write
+  int availableForWrite() override { return capacity - available(); }
+
+  // returns the address of the start of the physical read buffer
+  T *address() override { return p_data; }
+
+  /// Consumer: readable entries up to the physical end of the buffer. With
+  /// DropOldest the producer might overwrite the entries while they are
+  /// processed, so we do not provide them w/o copying
+  T *peekSpan(int &len) override {
+    if (policy == DropOldest) {
+      len = 0;
+      return nullptr;
+    }
+    uint32_t tail = consumer.span_tail =
+        consumer.tail.load(std::memory_order_acquire);
+    uint32_t head = producer.head.load(std::memory_order_acquire);
+    len = MIN(MIN(head - tail, capacity), capacity - (tail & mask));
+    return len > 0 ? p_data + (tail & mask) : nullptr;
+  }
+
+  /// Consumer: returns 0 if the data was dropped by the producer in between
+  int commitRead(int len) override {
+    uint32_t tail = consumer.span_tail;
+    len = MIN(len, (int)(producer.head.load(std::memory_order_acquire) - tail));
+    if (!consumer.tail.compare_exchange_strong(tail, tail + len,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+      return 0;
+    }
+    consumer.span_tail += len;
+    return len;
+  }
+
+  /// Producer: writable entries up to the physical end of the buffer
+  T *writeSpan(int &len) override {
+    uint32_t head = producer.head.load(std::memory_order_relaxed);
+    len = MIN(availableForWrite(), (int)(capacity - (head & mask)));
+    return len > 0 ? p_data + (head & mask) : nullptr;
+  }
+
+  /// Producer: publishes the entries which were filled via writeSpan()
+  int commitWrite(int len) override {
+    len = MIN(len, availableForWrite());
+    producer.head.store(producer.head.load(std::memory_order_relaxed) + len,
+                         std::memory_order_release);
+    return len;
+  }
+
+  /// Returns the maximum capacity of the buffer
+  int size() { return capacity; }
+
+  /// Number of writes which needed to drop some data
+  uint32_t overflowCount() {
+    return producer.overflow_count.load(std::memory_order_relaxed);
+  }
+
+  /// Number of entries which have been dropped
+  uint32_t droppedCount() {
+    return producer.dropped_count.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  /// Fields which are written by the producer
+  struct ProducerState {
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> overflow_count{0};
+    std::atomic<uint32_t> dropped_count{0};
+  };
+  /// Fields which are written by the consumer
+  struct ConsumerState {
+    std::atomic<uint32_t> tail{0};
+    uint32_t span_tail = 0;
+  };
+  // read only after resize()
+  T *p_data = nullptr;
+  uint32_t capacity = 0;
+  uint32_t mask = 0;
+  OverflowPolicy policy;
+  // each state on its own cache line to avoid false sharing
+  alignas(CACHE_LINE_SIZE) ProducerState producer;
+  alignas(CACHE_LINE_SIZE) ConsumerState consumer;
+
+  /// Records a write which did not fit
+  void addDropped(uint32_t len) {
+    producer.overflow_count.store(
+        producer.overflow_count.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    producer.dropped_count.store(
+        producer.dropped_count.load(std::memory_order_relaxed) + len,
+        std::memory_order_relaxed);
+  }
+
+  /// moves the tail so that len entries fit: the consumer might read in
+  /// parallel. Returns the number of dropped entries
+  uint32_t dropOldest(uint32_t head, uint32_t tail, int len) {
+    uint32_t new_tail = head + len - capacity;
+    while ((int32_t)(new_tail - tail) > 0) {
+      if (consumer.tail.compare_exchange_weak(tail, new_tail,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+        return new_tail - tail;
+      }
+    }
+    return 0;
+  }
+
+  void copyFrom(uint32_t pos, T *data, int len) {
+    uint32_t idx = pos & mask;
+    int first = MIN(len, (int)(capacity - idx));
+    memcpy(data, p_data + idx, first * sizeof(T));
+    if (len > first) {
+      memcpy(data + first, p_data, (len - first) * sizeof(T));
+    }
+  }
+
+  void copyTo(uint32_t pos, const T *data, int len) {
+    uint32_t idx = pos & mask;
+    int first = MIN(len, (int)(capacity - idx));
+    memcpy(p_data + idx, data, first * sizeof(T));
+    if (len > first) {
+      memcpy(p_data, data + first, (len - first) * sizeof(T));
+    }
+  }
+};
+
+#endif
+
 /**
  * @brief A lock free N buffer. If count=2 we create a DoubleBuffer, if count=3
- * a TripleBuffer etc.
+ * a TripleBuffer etc. The blocks are managed as a ring: one writer fills
+ * the blocks and one reader consumes them in the same order. Besides the
+ * BaseBuffer API you can fill and consume whole blocks w/o copying with
+ * acquireWriteBlock()/commitWriteBlock() and acquireReadBlock()/
+ * commitReadBlock().
  * @author Phil Schatzmann
  * @copyright GPLv3
  */
@@ -311,51 +688,63 @@ template <typename T>
 class NBuffer : public BaseBuffer<T> {
  public:
   NBuffer(int size = 512, int count = 2) {
-    filled_buffers = new BaseBuffer<T> *[count];
-    avaliable_buffers = new BaseBuffer<T> *[count];
-
-    write_buffer_count = 0;
     buffer_count = count;
     buffer_size = size;
+    blocks = new T *[count];
+    block_len = new int[count];
+    AllocationCounter::recordAllocation((sizeof(T *) + sizeof(int)) * count);
     for (int j = 0; j < count; j++) {
-      avaliable_buffers[j] = new SingleBuffer<T>(size);
-      if (avaliable_buffers[j] == nullptr) {
+      blocks[j] = new T[size];
+      AllocationCounter::recordAllocation(sizeof(T) * size);
+      block_len[j] = 0;
+      if (blocks[j] == nullptr) {
         LOGE("Not Enough Memory for buffer %d", j);
       }
     }
   }
 
-  virtual ~NBuffer() {
-    delete actual_write_buffer;
-    delete actual_read_buffer;
-
-    BaseBuffer<T> *ptr = getNextAvailableBuffer();
-    while (ptr != nullptr) {
-      delete ptr;
-      ptr = getNextAvailableBuffer();
-    }
+  // the blocks are owned by the buffer
+  NBuffer(const NBuffer &) = delete;
+  NBuffer &operator=(const NBuffer &) = delete;
 
-    ptr = getNextFilledBuffer();
-    while (ptr != nullptr) {
-      delete ptr;
-      ptr = getNextFilledBuffer();
+  virtual ~NBuffer() {
+    for (int j = 0; j < buffer_count; j++) {
+      delete[] blocks[j];
     }
+    delete[] blocks;
+    delete[] block_len;
   }
 
   // reads an entry from the buffer
   T read() {
     T result = 0;
-    if (available() > 0) {
-      result = actual_read_buffer->read();
+    int len = 0;
+    T *data = peekSpan(len);
+    if (data != nullptr) {
+      result = *data;
+      commitRead(1);
     }
     return result;
   }
 
   // peeks the actual entry from the buffer
   T peek() {
-    T result = 0;
-    if (available() > 0) {
-      result = actual_read_buffer->peek();
+    int len = 0;
+    T *data = peekSpan(len);
+    return data == nullptr ? 0 : *data;
+  }
+
+  // reads multiple values: copies block by block
+  int readArray(T data[], int len) override {
+    int result = 0;
+    while (result < len) {
+      int available_len = 0;
+      T *block = peekSpan(available_len);
+      if (block == nullptr) break;
+      int copy_len = MIN(len - result, available_len);
+      memcpy(data + result, block, copy_len * sizeof(T));
+      commitRead(copy_len);
+      result += copy_len;
     }
     return result;
   }
@@ -365,75 +754,48 @@ class NBuffer : public BaseBuffer<T> {
 
   // write add an entry to the buffer
   bool write(T data) {
-    bool result = false;
-    if (actual_write_buffer == nullptr) {
-      actual_write_buffer = getNextAvailableBuffer();
-    }
-    if (actual_write_buffer != nullptr) {
-      result = actual_write_buffer->write(data);
-      // if buffer is full move to next available
-      if (actual_write_buffer->isFull()) {
-        addFilledBuffer(actual_write_buffer);
-        actual_write_buffer = getNextAvailableBuffer();
-      }
-    } else {
-      // Logger.debug("actual_write_buffer is full");
-    }
+    int len = 0;
+    T *block = writeSpan(len);
+    if (block == nullptr) return false;
+    *block = data;
+    commitWrite(1);
+    return true;
+  }
 
-    if (start_time == 0l) {
-      start_time = millis();
+  // writes multiple values: copies block by block
+  int writeArray(const T data[], int len) override {
+    int result = 0;
+    while (result < len) {
+      int open = 0;
+      T *block = writeSpan(open);
+      if (block == nullptr) break;
+      int copy_len = MIN(len - result, open);
+      memcpy(block, data + result, copy_len * sizeof(T));
+      commitWrite(copy_len);
+      result += copy_len;
     }
-    sample_count++;
-
     return result;
   }
 
   // determines the available entries for the current read buffer
   int available() {
-    if (actual_read_buffer == nullptr) {
-      actual_read_buffer = getNextFilledBuffer();
-    }
-    if (actual_read_buffer == nullptr) {
-      return 0;
-    }
-    int result = actual_read_buffer->available();
-    if (result == 0) {
-      // make current read buffer available again
-      resetCurrent();
-      result =
-          actual_read_buffer == nullptr ? 0 : actual_read_buffer->available();
-    }
-    return result;
+    if (filledCount() == 0) return 0;
+    return block_len[readIndex()] - read_pos;
   }
 
   // deterMINes the available entries for the write buffer
   int availableForWrite() {
-    if (actual_write_buffer == nullptr) {
-      actual_write_buffer = getNextAvailableBuffer();
-    }
-    // if we used up all buffers - there is nothing available any more
-    if (actual_write_buffer == nullptr) {
-      return 0;
-    }
-    // check on actual buffer
-    if (actual_write_buffer->isFull()) {
-      // if buffer is full we move it to filled buffers ang get the next
-      // available
-      addFilledBuffer(actual_write_buffer);
-      actual_write_buffer = getNextAvailableBuffer();
-    }
-    return actual_write_buffer->availableForWrite();
+    if (filledCount() >= buffer_count) return 0;
+    return buffer_size - write_pos;
   }
 
   // resets all buffers
   void reset() {
     LOGD(LOG_METHOD);
-    while (actual_read_buffer != nullptr) {
-      actual_read_buffer->reset();
-      addAvailableBuffer(actual_read_buffer);
-      // get next read buffer
-      actual_read_buffer = getNextFilledBuffer();
-    }
+    read_index = write_index;
+    setReadCount(writeCount());
+    read_pos = 0;
+    write_pos = 0;
   }
 
   // provides the actual sample rate
@@ -444,94 +806,176 @@ class NBuffer : public BaseBuffer<T> {
 
   // returns the address of the start of the phsical read buffer
   T *address() {
-    return actual_read_buffer == nullptr ? nullptr
-                                         : actual_read_buffer->address();
+    return filledCount() == 0 ? nullptr : blocks[readIndex()];
   }
 
-  // Alternative interface using address: the current buffer has been filled
-  BaseBuffer<T> &writeEnd() {
-    if (actual_write_buffer != nullptr) {
-      actual_write_buffer->setWritePos(buffer_size);
-      addFilledBuffer(actual_write_buffer);
+  /// Provides the unread part of the actual read block
+  T *peekSpan(int &len) override {
+    len = available();
+    return len > 0 ? blocks[readIndex()] + read_pos : nullptr;
+  }
+
+  /// Consumes len entries: a fully consumed block is made available again
+  int commitRead(int len) override {
+    len = MIN(len, available());
+    read_pos += len;
+    if (len > 0 && read_pos >= block_len[readIndex()]) {
+      releaseReadBlock();
     }
-    actual_write_buffer = getNextAvailableBuffer();
-    return *actual_write_buffer;
+    return len;
   }
 
-  // Alternative interface using address: marks actual buffer as processed and
-  // provides access to next read buffer
-  BaseBuffer<T> &readEnd() {
-    // make current read buffer available again
-    resetCurrent();
-    return *actual_read_buffer;
+  /// Provides the unused part of the actual write block
+  T *writeSpan(int &len) override {
+    len = availableForWrite();
+    return len > 0 ? blocks[writeIndex()] + write_pos : nullptr;
   }
 
- protected:
-  int buffer_size = 0;
-  uint16_t buffer_count = 0;
-  uint16_t write_buffer_count = 0;
-  BaseBuffer<T> *actual_read_buffer = nullptr;
-  BaseBuffer<T> *actual_write_buffer = nullptr;
-  BaseBuffer<T> **avaliable_buffers = nullptr;
-  BaseBuffer<T> **filled_buffers = nullptr;
-  unsigned long start_time = 0;
-  unsigned long sample_count = 0;
+  /// Adds len entries: a full block is made available for reading
+  int commitWrite(int len) override {
+    len = MIN(len, availableForWrite());
+    write_pos += len;
+    if (start_time == 0l) {
+      start_time = millis();
+    }
+    sample_count += len;
+    if (write_pos >= buffer_size) {
+      publishWriteBlock(buffer_size);
+    }
+    return len;
+  }
 
-  void resetCurrent() {
-    if (actual_read_buffer != nullptr) {
-      actual_read_buffer->reset();
-      addAvailableBuffer(actual_read_buffer);
+  /// Provides an empty block of blockSize() entries which can be filled
+  /// directly. Data which was written with write() is published first.
+  /// Returns nullptr if all blocks are in use.
+  T *acquireWriteBlock() {
+    if (write_pos > 0 && filledCount() < buffer_count) {
+      publishWriteBlock(write_pos);
     }
-    // get next read buffer
-    actual_read_buffer = getNextFilledBuffer();
+    is_write_block_acquired = filledCount() < buffer_count;
+    return is_write_block_acquired ? blocks[writeIndex()] : nullptr;
   }
 
-  BaseBuffer<T> *getNextAvailableBuffer() {
-    BaseBuffer<T> *result = nullptr;
-    for (int j = 0; j < buffer_count; j++) {
-      result = avaliable_buffers[j];
-      if (result != nullptr) {
-        avaliable_buffers[j] = nullptr;
-        break;
-      }
+  /// Makes the block which was provided by acquireWriteBlock() available for
+  /// reading
+  bool commitWriteBlock(int len) {
+    if (filledCount() >= buffer_count) return false;
+    len = MIN(len, buffer_size);
+    if (start_time == 0l) {
+      start_time = millis();
     }
+    sample_count += len;
+    publishWriteBlock(len);
+    is_write_block_acquired = false;
+    return true;
+  }
+
+  /// Provides the oldest filled block (or the unread rest of it) with its
+  /// length: returns nullptr if there is no data
+  T *acquireReadBlock(int &len) {
+    T *result = peekSpan(len);
+    is_read_block_acquired = result != nullptr;
     return result;
   }
 
-  bool addAvailableBuffer(BaseBuffer<T> *buffer) {
-    bool result = false;
-    for (int j = 0; j < buffer_count; j++) {
-      if (avaliable_buffers[j] == nullptr) {
-        avaliable_buffers[j] = buffer;
-        result = true;
-        break;
-      }
+  /// Makes the block which was provided by acquireReadBlock() available for
+  /// writing again
+  void commitReadBlock() {
+    if (filledCount() > 0) {
+      releaseReadBlock();
     }
-    return result;
+    is_read_block_acquired = false;
   }
 
-  BaseBuffer<T> *getNextFilledBuffer() {
-    BaseBuffer<T> *result = nullptr;
-    if (write_buffer_count > 0) {
-      // get oldest entry
-      result = filled_buffers[0];
-      // move data by 1 entry to the left
-      for (int j = 0; j < write_buffer_count - 1; j++)
-        filled_buffers[j] = filled_buffers[j + 1];
-      // clear last enty
-      filled_buffers[write_buffer_count - 1] = nullptr;
-      write_buffer_count--;
+  /// Number of entries per block
+  int blockSize() { return buffer_size; }
+
+  /// Number of blocks
+  int blockCount() { return buffer_count; }
+
+  /// Number of blocks which are ready for reading: we load the read count
+  /// first, so that the result can not be negative
+  int filledCount() {
+    uint32_t read = readCount();
+    uint32_t written = writeCount();
+    return MIN(written - read, (uint32_t)buffer_count);
+  }
+
+  // Alternative interface using address: the current buffer has been filled
+  T *writeEnd() {
+    if (is_write_block_acquired) {
+      commitWriteBlock(buffer_size);
     }
-    return result;
+    return acquireWriteBlock();
   }
 
-  bool addFilledBuffer(BaseBuffer<T> *buffer) {
-    bool result = false;
-    if (write_buffer_count < buffer_count) {
-      filled_buffers[write_buffer_count++] = buffer;
-      result = true;
+  // Alternative interface using address: marks actual buffer as processed and
+  // provides access to next read buffer
+  T *readEnd() {
+    if (is_read_block_acquired) {
+      commitReadBlock();
     }
-    return result;
+    int len = 0;
+    return acquireReadBlock(len);
+  }
+
+ protected:
+  int buffer_size = 0;
+  uint16_t buffer_count = 0;
+  T **blocks = nullptr;
+  int *block_len = nullptr;
+#ifdef USE_ATOMIC
+  // number of blocks published by the writer
+  std::atomic<uint32_t> write_count{0};
+  // number of blocks released by the reader
+  std::atomic<uint32_t> read_count{0};
+#else
+  volatile uint32_t write_count = 0;
+  volatile uint32_t read_count = 0;
+#endif
+  // the block indexes wrap explicitly: each is only used by its own side
+  int write_index = 0;
+  int read_index = 0;
+  int write_pos = 0;
+  int read_pos = 0;
+  bool is_write_block_acquired = false;
+  bool is_read_block_acquired = false;
+  unsigned long start_time = 0;
+  unsigned long sample_count = 0;
+
+#ifdef USE_ATOMIC
+  /// acquire: the data of the published blocks is visible to the reader
+  uint32_t writeCount() { return write_count.load(std::memory_order_acquire); }
+  uint32_t readCount() { return read_count.load(std::memory_order_acquire); }
+  /// release: the block content is written before the count is published
+  void setWriteCount(uint32_t count) {
+    write_count.store(count, std::memory_order_release);
+  }
+  void setReadCount(uint32_t count) {
+    read_count.store(count, std::memory_order_release);
+  }
+#else
+  uint32_t writeCount() { return write_count; }
+  uint32_t readCount() { return read_count; }
+  void setWriteCount(uint32_t count) { write_count = count; }
+  void setReadCount(uint32_t count) { read_count = count; }
+#endif
+
+  int readIndex() { return read_index; }
+
+  int writeIndex() { return write_index; }
+
+  void publishWriteBlock(int len) {
+    block_len[write_index] = len;
+    write_pos = 0;
+    if (++write_index == buffer_count) write_index = 0;
+    setWriteCount(writeCount() + 1);
+  }
+
+  void releaseReadBlock() {
+    read_pos = 0;
+    if (++read_index == buffer_count) read_index = 0;
+    setReadCount(readCount() + 1);
   }
 };
 
@@ -581,4 +1025,145 @@ class BufferedArray {
   Stream *p_stream = nullptr;
 };
 
+/**
+ * @brief Memory area from which the processing stages of a pipeline take
+ * their scratch buffers: the stages reserve the memory in their begin() and
+ * during the processing no further memory is allocated. The arena can be
+ * allocated with a fixed size or with the sum of the reserved sizes.
+ * 
+ * ScratchArena arena(8*1024);
+ * converter.setArena(arena);
+ * mixer.setArena(arena);
+ * arena.begin();
+ * converter.begin(1, 2);
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class ScratchArena {
+ public:
+  ScratchArena(size_t size = 0) { reserved = size; }
+
+  ~ScratchArena() { end(); }
+
+  /// Records an additional memory requirement: call before begin()
+  void reserve(size_t bytes) { reserved += align(bytes); }
+
+  /// Allocates the memory: if size is 0 we use the reserved size
+  bool begin(size_t size = 0) {
+    if (size == 0) size = reserved;
+    if (p_data != nullptr && size <= capacity) {
+      clear();
+      return true;
+    }
+    end();
+    p_data = new uint8_t[size];
+    AllocationCounter::recordAllocation(size);
+    if (p_data == nullptr) {
+      LOGE("Could not allocate ScratchArena with %d bytes", (int)size);
+      return false;
+    }
+    capacity = size;
+    used_bytes = 0;
+    return true;
+  }
+
+  /// Releases the memory
+  void end() {
+    delete[] p_data;
+    p_data = nullptr;
+    capacity = 0;
+    used_bytes = 0;
+  }
+
+  /// Provides len bytes from the arena: returns nullptr if there is not
+  /// enough space
+  uint8_t *allocate(size_t bytes) {
+    bytes = align(bytes);
+    if (p_data == nullptr || used_bytes + bytes > capacity) {
+      LOGE("ScratchArena too small: requested %d - available %d", (int)bytes,
+           (int)(capacity - used_bytes));
+      return nullptr;
+    }
+    uint8_t *result = p_data + used_bytes;
+    used_bytes += bytes;
+    return result;
+  }
+
+  /// Invalidates all allocations, so that the memory can be reused
+  void clear() { used_bytes = 0; }
+
+  /// Size of the arena in bytes
+  size_t size() { return capacity; }
+
+  /// Number of allocated bytes
+  size_t used() { return used_bytes; }
+
+ protected:
+  uint8_t *p_data = nullptr;
+  size_t capacity = 0;
+  size_t used_bytes = 0;
+  size_t reserved = 0;
+
+  static size_t align(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+};
+
+/**
+ * @brief Fixed size scratch buffer which is allocated in begin(): the memory
+ * is taken from a ScratchArena if it has been defined or from the heap. In
+ * the processing we must not request more then the allocated size.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <typename T>
+class ScratchBuffer {
+ public:
+  ScratchBuffer() = default;
+  ScratchBuffer(const ScratchBuffer &) = delete;
+  ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+
+  ~ScratchBuffer() { release(); }
+
+  /// Defines the arena from which we take the memory
+  void setArena(ScratchArena *arena) { p_arena = arena; }
+
+  /// Allocates the memory for len entries: we only allocate if the actual
+  /// buffer is too small
+  bool resize(size_t len) {
+    if (len <= buffer_size) return true;
+    release();
+    if (p_arena != nullptr) {
+      p_data = (T *)p_arena->allocate(len * sizeof(T));
+      is_owner = false;
+    } else {
+      p_data = new T[len];
+      AllocationCounter::recordAllocation(sizeof(T) * len);
+      is_owner = true;
+    }
+    buffer_size = p_data == nullptr ? 0 : len;
+    return p_data != nullptr;
+  }
+
+  T *data() { return p_data; }
+
+  T &operator[](int idx) { return p_data[idx]; }
+
+  /// Number of allocated entries
+  size_t size() { return buffer_size; }
+
+ protected:
+  ScratchArena *p_arena = nullptr;
+  T *p_data = nullptr;
+  size_t buffer_size = 0;
+  bool is_owner = false;
+
+  void release() {
+    // memory from the arena is released with the arena
+    if (is_owner) delete[] p_data;
+    p_data = nullptr;
+    buffer_size = 0;
+    is_owner = false;
+  }
+};
+
 }  // namespace audio_tools
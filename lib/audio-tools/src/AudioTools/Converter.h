@@ -37,7 +37,7 @@ class NumberConverter {
 
         /// provides the biggest number for the indicated number of bits
         static int64_t maxValue(int value_bits_per_sample){
-            switch(value_bits_per_sample/8){
+            switch(value_bits_per_sample){
                 case 8:
                     return 127;
                 case 16:
@@ -699,9 +699,7 @@ class Converter1Channel : public BaseConverter<T> {
 
   size_t convert(uint8_t *src, size_t size) {
     T *data = (T *)src;
-    for (size_t j = 0; j < size; j++) {
-      data[j] = p_filter->process(data[j]);
-    }
+    p_filter->processBlock(data, data, size / sizeof(T));
     return size;
   }
 
@@ -720,6 +718,7 @@ class ConverterNChannels : public BaseConverter<T> {
   /// Default Constructor
   ConverterNChannels(int channels) {
     this->channels = channels;
+    buffer.resize(block_frames * channels);
     filters = new Filter<FT> *[channels];
     // make sure that we have 1 filter per channel
     for (int j = 0; j < channels; j++) {
@@ -752,15 +751,13 @@ class ConverterNChannels : public BaseConverter<T> {
 
   // convert all samples for each channel separately
   size_t convert(uint8_t *src, size_t size) {
-    int count = size / channels / sizeof(T);
-    T *sample = (T *)src;
-    for (size_t j = 0; j < count; j++) {
-      for (int channel = 0; channel < channels; channel++) {
-        if (filters[channel]!=nullptr){
-          *sample = filters[channel]->process(*sample);
-        }
-        sample++;
-      }
+    int frames = size / channels / sizeof(T);
+    T *samples = (T *)src;
+    while (frames > 0) {
+      int n = frames < block_frames ? frames : block_frames;
+      processBlock(samples, n);
+      samples += n * channels;
+      frames -= n;
     }
     return size;
   }
@@ -768,6 +765,39 @@ class ConverterNChannels : public BaseConverter<T> {
  protected:
   Filter<FT> **filters = nullptr;
   int channels;
+  // number of frames which are processed with one processBlock() call
+  static const int block_frames = 128;
+  Vector<FT> buffer;
+
+  /// The samples have the type of the filter: we filter the interleaved data
+  /// directly
+  void processBlock(FT *samples, int frames) {
+    // stereo fast path which processes both channels in one pass
+    if (channels == 2 && filters[0] != nullptr && filters[1] != nullptr &&
+        filters[0]->processBlockStereo(*filters[1], samples, samples, frames)) {
+      return;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+      if (filters[ch] != nullptr) {
+        filters[ch]->processBlock(samples + ch, samples + ch, frames, channels);
+      }
+    }
+  }
+
+  /// Converts the interleaved samples to the filter type in one pass, filters
+  /// each channel and converts the result back
+  template <typename ST>
+  void processBlock(ST *samples, int frames) {
+    FT *data = buffer.data();
+    int count = frames * channels;
+    for (int j = 0; j < count; j++) {
+      data[j] = samples[j];
+    }
+    processBlock(data, frames);
+    for (int j = 0; j < count; j++) {
+      samples[j] = data[j];
+    }
+  }
 };
 
 /**
@@ -0,0 +1,248 @@
+#pragma once
+#include "AudioConfig.h"
+#include "AudioBasic/Int24.h"
+#include "AudioBasic/Vector.h"
+#include "AudioTools/AudioLogger.h"
+
+#if !defined(NO_SIMD)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define USE_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_SIMD_NEON
+#endif
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Applies a gain factor per channel to interleaved PCM data with
+ * fixed point arithmetic: 16 bit samples are scaled with Q15 gains, 24 and 32
+ * bit samples with Q31 gains. If the gain is above 1 we use less fractional
+ * bits, so that we can also support a boost. The results are saturated.
+ *
+ * The kernel is selected in begin() for the bits per sample and the number
+ * of channels: we provide unrolled versions for mono and stereo and a
+ * generic one for N channels. 16 bit data is processed with SSE2 on x86 and
+ * with NEON on ARM if the pattern of the channels fits into a vector.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FixedPointGain {
+ public:
+  FixedPointGain() = default;
+
+  /// Defines the format of the data: call before setFactor()
+  bool begin(int bitsPerSample, int channels) {
+    if (channels <= 0) {
+      LOGE("Invalid channels: %d", channels);
+      return false;
+    }
+    bits_per_sample = bitsPerSample;
+    this->channels = channels;
+    factors.resize(channels);
+    gains.resize(channels);
+    for (int j = 0; j < channels; j++) factors[j] = 1.0f;
+    return selectKernel();
+  }
+
+  /// Defines the gain for the indicated channel
+  void setFactor(int channel, float factor) {
+    if (channel < 0 || channel >= channels) return;
+    if (factor < 0.0f) factor = 0.0f;
+    factors[channel] = factor;
+    updateGains();
+  }
+
+  /// Provides the gain of the indicated channel
+  float factor(int channel) {
+    return channel >= 0 && channel < channels ? factors[channel] : 0.0f;
+  }
+
+  /// Applies the gains to the interleaved data: size is in bytes
+  void apply(uint8_t *data, size_t size) {
+    if (p_kernel != nullptr) (this->*p_kernel)(data, size);
+  }
+
+  /// Returns true if the selected kernel uses SIMD instructions
+  bool isSIMD() { return is_simd; }
+
+ protected:
+  typedef void (FixedPointGain::*Kernel)(uint8_t *data, size_t size);
+  Kernel p_kernel = nullptr;
+  Vector<float> factors;
+  Vector<int32_t> gains;
+  int shift = 15;
+  int32_t rounding = 1 << 14;
+  int bits_per_sample = 16;
+  int channels = 0;
+  bool is_simd = false;
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+  // gains of 8 int16_t lanes in the order of the interleaved channels
+  int16_t simd_gains[8];
+#endif
+
+  bool selectKernel() {
+    is_simd = false;
+    switch (bits_per_sample) {
+      case 16:
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+        if (8 % channels == 0) {
+          p_kernel = &FixedPointGain::applySIMD16;
+          is_simd = true;
+          break;
+        }
+#endif
+        p_kernel = channels == 1   ? &FixedPointGain::apply16<1>
+                   : channels == 2 ? &FixedPointGain::apply16<2>
+                                   : &FixedPointGain::apply16<0>;
+        break;
+      case 24:
+        p_kernel = channels == 1   ? &FixedPointGain::apply32<int24_t, 1>
+                   : channels == 2 ? &FixedPointGain::apply32<int24_t, 2>
+                                   : &FixedPointGain::apply32<int24_t, 0>;
+        break;
+      case 32:
+        p_kernel = channels == 1   ? &FixedPointGain::apply32<int32_t, 1>
+                   : channels == 2 ? &FixedPointGain::apply32<int32_t, 2>
+                                   : &FixedPointGain::apply32<int32_t, 0>;
+        break;
+      default:
+        LOGE("Unsupported bits_per_sample: %d", bits_per_sample);
+        p_kernel = nullptr;
+        return false;
+    }
+    updateGains();
+    return true;
+  }
+
+  /// Converts the factors to fixed point: all channels share the number of
+  /// fractional bits which is determined by the biggest factor
+  void updateGains() {
+    // 16 bit gains for 16 bit data, 32 bit gains otherwise
+    int gain_bits = bits_per_sample == 16 ? 15 : 31;
+    float max_factor = 0.0f;
+    for (int j = 0; j < channels; j++) {
+      if (factors[j] > max_factor) max_factor = factors[j];
+    }
+    shift = gain_bits;
+    while (shift > 0 && max_factor * (1ll << shift) >= (1ll << gain_bits)) {
+      shift--;
+    }
+    rounding = shift > 0 ? (int32_t)1 << (shift - 1) : 0;
+    int64_t max_gain = ((int64_t)1 << gain_bits) - 1;
+    for (int j = 0; j < channels; j++) {
+      int64_t gain = (int64_t)(factors[j] * (1ll << shift) + 0.5f);
+      gains[j] = gain > max_gain ? max_gain : gain;
+    }
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+    if (channels > 0 && 8 % channels == 0) {
+      for (int j = 0; j < 8; j++) simd_gains[j] = gains[j % channels];
+    }
+#endif
+  }
+
+  inline int16_t scale16(int32_t value, int32_t gain) {
+    int32_t result = (value * gain + rounding) >> shift;
+    if (result > INT16_MAX) return INT16_MAX;
+    if (result < INT16_MIN) return INT16_MIN;
+    return result;
+  }
+
+  inline int32_t scale32(int32_t value, int32_t gain, int32_t maxValue) {
+    int64_t result = ((int64_t)value * gain + rounding) >> shift;
+    if (result > maxValue) return maxValue;
+    if (result < -maxValue - 1) return -maxValue - 1;
+    return result;
+  }
+
+  /// 16 bit kernel: CH is the number of channels or 0 for N channels
+  template <int CH>
+  void apply16(uint8_t *data, size_t size) {
+    int16_t *samples = (int16_t *)data;
+    size_t count = size / sizeof(int16_t);
+    const int ch_count = CH == 0 ? channels : CH;
+    const int32_t *g = gains.data();
+    size_t frames = count / ch_count;
+    for (size_t f = 0; f < frames; f++) {
+      for (int ch = 0; ch < ch_count; ch++) {
+        *samples = scale16(*samples, g[ch]);
+        samples++;
+      }
+    }
+    // incomplete frame
+    for (size_t j = frames * ch_count; j < count; j++) {
+      *samples = scale16(*samples, g[j % ch_count]);
+      samples++;
+    }
+  }
+
+  /// 24 and 32 bit kernel: CH is the number of channels or 0 for N channels
+  template <typename T, int CH>
+  void apply32(uint8_t *data, size_t size) {
+    T *samples = (T *)data;
+    size_t count = size / sizeof(T);
+    const int ch_count = CH == 0 ? channels : CH;
+    const int32_t *g = gains.data();
+    const int32_t max_value = sizeof(T) == 3 ? INT24_MAX : INT32_MAX;
+    size_t frames = count / ch_count;
+    for (size_t f = 0; f < frames; f++) {
+      for (int ch = 0; ch < ch_count; ch++) {
+        int32_t value = *samples;
+        *samples = scale32(value, g[ch], max_value);
+        samples++;
+      }
+    }
+    // incomplete frame
+    for (size_t j = frames * ch_count; j < count; j++) {
+      int32_t value = *samples;
+      *samples = scale32(value, g[j % ch_count], max_value);
+      samples++;
+    }
+  }
+
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+  /// 16 bit kernel which processes 8 samples at a time: only used if the
+  /// channels are a divisor of 8, so the gain vector is always aligned
+  void applySIMD16(uint8_t *data, size_t size) {
+    int16_t *samples = (int16_t *)data;
+    size_t count = size / sizeof(int16_t);
+    size_t vector_count = count & ~(size_t)7;
+#if defined(USE_SIMD_SSE2)
+    const __m128i g = _mm_loadu_si128((const __m128i *)simd_gains);
+    const __m128i round = _mm_set1_epi32(rounding);
+    const __m128i sh = _mm_cvtsi32_si128(shift);
+    for (size_t j = 0; j < vector_count; j += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(samples + j));
+      __m128i lo = _mm_mullo_epi16(x, g);
+      __m128i hi = _mm_mulhi_epi16(x, g);
+      __m128i p0 = _mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round);
+      __m128i p1 = _mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round);
+      p0 = _mm_sra_epi32(p0, sh);
+      p1 = _mm_sra_epi32(p1, sh);
+      _mm_storeu_si128((__m128i *)(samples + j), _mm_packs_epi32(p0, p1));
+    }
+#else
+    const int16x8_t g = vld1q_s16(simd_gains);
+    const int32x4_t sh = vdupq_n_s32(-shift);
+    for (size_t j = 0; j < vector_count; j += 8) {
+      int16x8_t x = vld1q_s16(samples + j);
+      int32x4_t p0 = vmull_s16(vget_low_s16(x), vget_low_s16(g));
+      int32x4_t p1 = vmull_s16(vget_high_s16(x), vget_high_s16(g));
+      // rounding shift right
+      p0 = vrshlq_s32(p0, sh);
+      p1 = vrshlq_s32(p1, sh);
+      vst1q_s16(samples + j, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+#endif
+    // remaining samples: the vector part ends at a frame boundary
+    const int32_t *gp = gains.data();
+    for (size_t j = vector_count; j < count; j++) {
+      samples[j] = scale16(samples[j], gp[j % channels]);
+    }
+  }
+#endif
+};
+
+}  // namespace audio_tools
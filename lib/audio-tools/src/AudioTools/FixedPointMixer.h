@@ -0,0 +1,279 @@
+#pragma once
+#include "AudioConfig.h"
+#include "AudioBasic/Vector.h"
+#include "AudioTools/AudioLogger.h"
+#include "AudioTools/Buffers.h"
+// SIMD selection
+#include "AudioTools/FixedPointGain.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Arithmetic which is used by the FixedPointMixer: 16 bit samples are
+ * scaled with Q15 gains and summed up in 32 bits, 32 bit samples are summed
+ * up in 64 bits. All other types are mixed in float.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <typename T>
+struct MixerArithmetic {
+  typedef float acc_t;
+  typedef float gain_t;
+  static gain_t gain(float factor) { return factor; }
+  static acc_t multiply(T value, gain_t gain) { return gain * value; }
+  static T result(acc_t acc) { return static_cast<T>(acc); }
+  static float level(T value) { return value < 0 ? -value : value; }
+};
+
+template <>
+struct MixerArithmetic<int16_t> {
+  typedef int32_t acc_t;
+  typedef int32_t gain_t;
+  // 1.0 is stored as 32767 so that the gain fits into 16 bits
+  static gain_t gain(float factor) {
+    int32_t result = factor * 32768.0f + 0.5f;
+    return result > INT16_MAX ? INT16_MAX : result;
+  }
+  static acc_t multiply(int16_t value, gain_t gain) {
+    return (int32_t)value * gain;
+  }
+  static int16_t result(acc_t acc) {
+    int32_t result = (acc + (1 << 14)) >> 15;
+    if (result > INT16_MAX) return INT16_MAX;
+    if (result < INT16_MIN) return INT16_MIN;
+    return result;
+  }
+  static float level(int16_t value) { return value < 0 ? -value : value; }
+};
+
+template <>
+struct MixerArithmetic<int32_t> {
+  typedef int64_t acc_t;
+  typedef int32_t gain_t;
+  static gain_t gain(float factor) { return factor * 32768.0f + 0.5f; }
+  static acc_t multiply(int32_t value, gain_t gain) {
+    return (int64_t)value * gain;
+  }
+  static int32_t result(acc_t acc) {
+    int64_t result = (acc + (1 << 14)) >> 15;
+    if (result > INT32_MAX) return INT32_MAX;
+    if (result < INT32_MIN) return INT32_MIN;
+    return result;
+  }
+  static float level(int32_t value) {
+    return value < 0 ? -(float)value : (float)value;
+  }
+};
+
+/**
+ * @brief Mixes N inputs with fixed point arithmetic: the weights are
+ * normalized to a sum of 1 and converted to Q15 gains when they are set. The
+ * inputs are accumulated with add() and the mixed result is saturated when
+ * we store() it. The accumulator itself is not saturated (the SIMD versions
+ * use plain 32 bit adds): because the rounded Q15 gains sum up to at most
+ * 32768 + inputCount/2, the 32 bit accumulator of 16 bit samples can not
+ * overflow with up to 65535 inputs (the 64 bit accumulator of 32 bit samples
+ * has no practical limit) - provided that each input is added only once
+ * after clear().
+ *
+ * While we add an input we also determine its peak level, so that the input
+ * levels can be reported without an additional pass over the data. 16 bit
+ * data is processed with SSE2 on x86 and with NEON on ARM.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T sample type
+ */
+template <typename T>
+class FixedPointMixer {
+ public:
+  typedef typename MixerArithmetic<T>::acc_t acc_t;
+  typedef typename MixerArithmetic<T>::gain_t gain_t;
+
+  /// Defines the number of inputs: all weights are set to 1
+  void begin(int inputCount) {
+    weights.resize(inputCount);
+    gains.resize(inputCount);
+    levels.resize(inputCount);
+    for (int j = 0; j < inputCount; j++) {
+      weights[j] = 1.0f;
+      levels[j] = 0.0f;
+    }
+    updateGains();
+  }
+
+  /// Number of inputs
+  int size() { return weights.size(); }
+
+  /// Defines the weight of the indicated input: 0 mutes it
+  void setWeight(int input, float weight) {
+    if (input < 0 || input >= size()) return;
+    weights[input] = weight < 0.0f ? 0.0f : weight;
+    updateGains();
+  }
+
+  float weight(int input) {
+    return input >= 0 && input < size() ? weights[input] : 0.0f;
+  }
+
+  /// Provides the peak level of the last data of the input (in the range of
+  /// the sample type)
+  float level(int input) {
+    return input >= 0 && input < size() ? levels[input] : 0.0f;
+  }
+
+  /// Marks the input as silent: e.g. if it did not provide any data
+  void setSilent(int input) {
+    if (input >= 0 && input < size()) levels[input] = 0.0f;
+  }
+
+  /// Allocates the accumulator (if necessary) and sets it to 0
+  bool clear(size_t samples) {
+    if (!acc.resize(samples)) return false;
+    memset(acc.data(), 0, samples * sizeof(acc_t));
+    sample_count = samples;
+    return true;
+  }
+
+  /// Defines the arena from which we take the accumulator
+  void setArena(ScratchArena &arena) { acc.setArena(&arena); }
+
+  /// Adds the samples of the indicated input to the accumulator
+  void add(int input, const T *in, size_t samples) {
+    if (input < 0 || input >= size()) return;
+    if (samples > sample_count) samples = sample_count;
+    levels[input] = addSamples(acc.data(), in, samples, gains[input]);
+  }
+
+  /// Stores the saturated mix of all inputs
+  void store(T *out, size_t samples) {
+    if (samples > sample_count) samples = sample_count;
+    storeSamples(out, acc.data(), samples);
+  }
+
+ protected:
+  typedef MixerArithmetic<T> Arithmetic;
+  Vector<float> weights;
+  Vector<gain_t> gains;
+  Vector<float> levels;
+  ScratchBuffer<acc_t> acc;
+  size_t sample_count = 0;
+
+  void updateGains() {
+    float total = 0.0f;
+    for (int j = 0; j < size(); j++) total += weights[j];
+    for (int j = 0; j < size(); j++) {
+      gains[j] = Arithmetic::gain(total > 0.0f ? weights[j] / total : 0.0f);
+    }
+  }
+
+  /// Generic version: returns the peak level
+  template <typename S>
+  float addSamples(typename MixerArithmetic<S>::acc_t *a, const S *in,
+                   size_t samples, gain_t gain) {
+    float peak = 0.0f;
+    for (size_t j = 0; j < samples; j++) {
+      a[j] += Arithmetic::multiply(in[j], gain);
+      float value = Arithmetic::level(in[j]);
+      if (value > peak) peak = value;
+    }
+    return peak;
+  }
+
+  template <typename S>
+  void storeSamples(S *out, const typename MixerArithmetic<S>::acc_t *a,
+                    size_t samples) {
+    for (size_t j = 0; j < samples; j++) {
+      out[j] = Arithmetic::result(a[j]);
+    }
+  }
+
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+  /// 16 bit version which processes 8 samples at a time
+  float addSamples(int32_t *a, const int16_t *in, size_t samples,
+                   int32_t gain) {
+    size_t vector_count = samples & ~(size_t)7;
+    int16_t max_value = 0, min_value = 0;
+#if defined(USE_SIMD_SSE2)
+    const __m128i g = _mm_set1_epi16(gain);
+    __m128i v_max = _mm_setzero_si128();
+    __m128i v_min = _mm_setzero_si128();
+    for (size_t j = 0; j < vector_count; j += 8) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(in + j));
+      v_max = _mm_max_epi16(v_max, x);
+      v_min = _mm_min_epi16(v_min, x);
+      __m128i lo = _mm_mullo_epi16(x, g);
+      __m128i hi = _mm_mulhi_epi16(x, g);
+      __m128i *p_acc = (__m128i *)(a + j);
+      _mm_storeu_si128(p_acc, _mm_add_epi32(_mm_loadu_si128(p_acc),
+                                            _mm_unpacklo_epi16(lo, hi)));
+      _mm_storeu_si128(p_acc + 1, _mm_add_epi32(_mm_loadu_si128(p_acc + 1),
+                                                _mm_unpackhi_epi16(lo, hi)));
+    }
+    int16_t tmp[8];
+    _mm_storeu_si128((__m128i *)tmp, v_max);
+    updateRange(tmp, 8, max_value, min_value);
+    _mm_storeu_si128((__m128i *)tmp, v_min);
+    updateRange(tmp, 8, max_value, min_value);
+#else
+    const int16x4_t g = vdup_n_s16(gain);
+    int16x8_t v_max = vdupq_n_s16(0);
+    int16x8_t v_min = vdupq_n_s16(0);
+    for (size_t j = 0; j < vector_count; j += 8) {
+      int16x8_t x = vld1q_s16(in + j);
+      v_max = vmaxq_s16(v_max, x);
+      v_min = vminq_s16(v_min, x);
+      vst1q_s32(a + j, vmlal_s16(vld1q_s32(a + j), vget_low_s16(x), g));
+      vst1q_s32(a + j + 4,
+                vmlal_s16(vld1q_s32(a + j + 4), vget_high_s16(x), g));
+    }
+    int16_t tmp[8];
+    vst1q_s16(tmp, v_max);
+    updateRange(tmp, 8, max_value, min_value);
+    vst1q_s16(tmp, v_min);
+    updateRange(tmp, 8, max_value, min_value);
+#endif
+    for (size_t j = vector_count; j < samples; j++) {
+      a[j] += (int32_t)in[j] * gain;
+    }
+    updateRange(in + vector_count, samples - vector_count, max_value,
+                min_value);
+    float peak_max = max_value;
+    float peak_min = -(float)min_value;
+    return peak_max > peak_min ? peak_max : peak_min;
+  }
+
+  void updateRange(const int16_t *values, size_t n, int16_t &maxValue,
+                   int16_t &minValue) {
+    for (size_t j = 0; j < n; j++) {
+      if (values[j] > maxValue) maxValue = values[j];
+      if (values[j] < minValue) minValue = values[j];
+    }
+  }
+
+  /// 16 bit version with saturation of 8 samples at a time
+  void storeSamples(int16_t *out, const int32_t *a, size_t samples) {
+    size_t vector_count = samples & ~(size_t)7;
+#if defined(USE_SIMD_SSE2)
+    const __m128i round = _mm_set1_epi32(1 << 14);
+    for (size_t j = 0; j < vector_count; j += 8) {
+      __m128i p0 = _mm_loadu_si128((const __m128i *)(a + j));
+      __m128i p1 = _mm_loadu_si128((const __m128i *)(a + j + 4));
+      p0 = _mm_srai_epi32(_mm_add_epi32(p0, round), 15);
+      p1 = _mm_srai_epi32(_mm_add_epi32(p1, round), 15);
+      _mm_storeu_si128((__m128i *)(out + j), _mm_packs_epi32(p0, p1));
+    }
+#else
+    for (size_t j = 0; j < vector_count; j += 8) {
+      int32x4_t p0 = vrshrq_n_s32(vld1q_s32(a + j), 15);
+      int32x4_t p1 = vrshrq_n_s32(vld1q_s32(a + j + 4), 15);
+      vst1q_s16(out + j, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+#endif
+    for (size_t j = vector_count; j < samples; j++) {
+      out[j] = Arithmetic::result(a[j]);
+    }
+  }
+#endif
+};
+
+}  // namespace audio_tools
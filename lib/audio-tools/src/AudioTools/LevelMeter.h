@@ -0,0 +1,481 @@
+#pragma once
+#include <math.h>
+#include "AudioConfig.h"
+#include "AudioTools/AudioTypes.h"
+#include "AudioTools/Buffers.h"
+#include "AudioTools/SampleFormatConverter.h"
+// SIMD selection
+#include "AudioTools/FixedPointGain.h"
+
+#ifndef LEVEL_METER_BLOCK_FRAMES
+#define LEVEL_METER_BLOCK_FRAMES 64
+#endif
+
+#ifndef LEVEL_METER_MIN_DB
+#define LEVEL_METER_MIN_DB -120.0f
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Configuration for the LevelMeter: the integration windows are in ms
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct LevelMeterConfig : public AudioBaseInfo {
+  LevelMeterConfig() {
+    channels = 2;
+    bits_per_sample = 16;
+    sample_rate = 44100;
+  }
+  /// integration window of the peak and the true peak
+  int peak_window_ms = 100;
+  /// integration window of the rms
+  int rms_window_ms = 300;
+  /// estimates the true peak with 4x oversampling
+  bool true_peak = true;
+  /// determines the EBU R128 short-term loudness (3 s window)
+  bool loudness = true;
+  /// samples are float (see FloatFormatConverterStream)
+  bool use_float = false;
+};
+
+/**
+ * @brief Measures the peak, rms and an estimate of the true peak per channel
+ * and the EBU R128 short-term loudness of interleaved PCM data. The values are
+ * relative to full scale (1.0) and are published at the end of each
+ * integration window, so that they can be polled e.g. by a UI.
+ *
+ * The data is converted to float in blocks of LEVEL_METER_BLOCK_FRAMES and the
+ * peak and sum of squares are determined in one pass with SSE2 or NEON if the
+ * channels fit into a vector. The true peak is estimated by a cubic
+ * interpolation at 1/4, 1/2 and 3/4 between the samples. For the loudness the
+ * samples are K-weighted (ITU-R BS.1770) incrementally per block, stereo in
+ * one loop so that the two channels are overlapped by the cpu: we keep the
+ * mean square of 100 ms sub blocks for the 3 s window. All channels have a
+ * weight of 1.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class LevelMeter {
+ public:
+  LevelMeter() = default;
+
+  /// Allocates the buffers and resets all values
+  bool begin(LevelMeterConfig config) {
+    cfg = config;
+    if (cfg.channels <= 0) {
+      LOGE("Invalid channels: %d", cfg.channels);
+      return false;
+    }
+    int channels = cfg.channels;
+    bool ok = cfg.use_float ? converter.begin<float, float>(1, 1)
+                            : converter.beginToFloat(cfg.bits_per_sample);
+    if (!ok) return false;
+    sample_size = converter.inputFrameSize();
+    partial.resize(sample_size * channels);
+    partial_bytes = 0;
+    if (!block.resize((HISTORY + LEVEL_METER_BLOCK_FRAMES) * channels))
+      return false;
+    for (int j = 0; j < HISTORY * channels; j++) block[j] = 0.0f;
+
+    int rate = cfg.sample_rate > 0 ? cfg.sample_rate : 44100;
+    peak_window_frames = windowFrames(cfg.peak_window_ms, rate);
+    rms_window_frames = windowFrames(cfg.rms_window_ms, rate);
+    sub_block_frames = rate / 10;
+
+    peak_acc.resize(channels);
+    true_peak_acc.resize(channels);
+    sum_acc.resize(channels);
+    peaks.resize(channels);
+    true_peaks.resize(channels);
+    rms_values.resize(channels);
+    k_state.resize(channels * 6);
+    for (int j = 0; j < channels; j++) {
+      peak_acc[j] = 0.0f;
+      true_peak_acc[j] = 0.0f;
+      sum_acc[j] = 0.0;
+      peaks[j] = 0.0f;
+      true_peaks[j] = 0.0f;
+      rms_values[j] = 0.0f;
+    }
+    for (int j = 0; j < channels * 6; j++) k_state[j] = 0.0f;
+    peak_frames = 0;
+    rms_frames = 0;
+    sub_frames = 0;
+    sub_energy = 0.0;
+    energy_pos = 0;
+    energy_count = 0;
+    setupKWeighting(rate);
+    return true;
+  }
+
+  /// Measures the interleaved data: size is in bytes. The bytes of an
+  /// incomplete frame are kept and completed by the next call
+  void process(const uint8_t *data, size_t size) {
+    if (block.size() == 0) return;
+    const int channels = cfg.channels;
+    const size_t frame_bytes = sample_size * channels;
+    if (partial_bytes > 0) {
+      size_t len = min(size, frame_bytes - partial_bytes);
+      memcpy(partial.data() + partial_bytes, data, len);
+      partial_bytes += len;
+      data += len;
+      size -= len;
+      if (partial_bytes < frame_bytes) return;
+      processFrames(partial.data(), 1);
+      partial_bytes = 0;
+    }
+    size_t frames = size / frame_bytes;
+    processFrames(data, frames);
+    partial_bytes = size - frames * frame_bytes;
+    memcpy(partial.data(), data + frames * frame_bytes, partial_bytes);
+  }
+
+  /// Sample peak of the last window (0.0 to 1.0)
+  float peak(int channel) { return valid(channel) ? peaks[channel] : 0.0f; }
+
+  /// Rms of the last window (0.0 to 1.0)
+  float rms(int channel) {
+    return valid(channel) ? rms_values[channel] : 0.0f;
+  }
+
+  /// Estimated true peak of the last window: can be above 1.0
+  float truePeak(int channel) {
+    return valid(channel) ? true_peaks[channel] : 0.0f;
+  }
+
+  /// EBU R128 short-term loudness in LUFS
+  float shortTermLoudness() {
+    if (energy_count == 0) return LEVEL_METER_MIN_DB;
+    float mean = 0.0f;
+    for (int j = 0; j < energy_count; j++) mean += energies[j];
+    mean /= energy_count;
+    if (mean <= 0.0f) return LEVEL_METER_MIN_DB;
+    float result = -0.691f + 10.0f * log10f(mean);
+    return result < LEVEL_METER_MIN_DB ? LEVEL_METER_MIN_DB : result;
+  }
+
+  /// Converts a level relative to full scale to dBFS
+  static float toDB(float level) {
+    if (level <= 0.0f) return LEVEL_METER_MIN_DB;
+    float result = 20.0f * log10f(level);
+    return result < LEVEL_METER_MIN_DB ? LEVEL_METER_MIN_DB : result;
+  }
+
+  LevelMeterConfig &config() { return cfg; }
+
+ protected:
+  // number of frames which are kept for the true peak interpolation
+  static const int HISTORY = 3;
+  // number of 100 ms sub blocks of the short-term loudness
+  static const int ENERGY_BLOCKS = 30;
+
+  struct Biquad {
+    float b0, b1, b2, a1, a2;
+  };
+
+  LevelMeterConfig cfg;
+  SampleFormatConverter converter;
+  int sample_size = 2;
+  // history frames followed by the actual block
+  ScratchBuffer<float> block;
+  // incomplete frame of the last call
+  Vector<uint8_t> partial;
+  size_t partial_bytes = 0;
+  Vector<float> peak_acc;
+  Vector<float> true_peak_acc;
+  Vector<double> sum_acc;
+  Vector<float> peaks;
+  Vector<float> true_peaks;
+  Vector<float> rms_values;
+  size_t peak_window_frames = 0;
+  size_t rms_window_frames = 0;
+  size_t peak_frames = 0;
+  size_t rms_frames = 0;
+  // K-weighting: pre filter and RLB high pass
+  Biquad k_pre;
+  Biquad k_rlb;
+  Vector<float> k_state;
+  size_t sub_block_frames = 0;
+  size_t sub_frames = 0;
+  double sub_energy = 0.0;
+  float energies[ENERGY_BLOCKS];
+  int energy_pos = 0;
+  int energy_count = 0;
+
+  bool valid(int channel) { return channel >= 0 && channel < peaks.size(); }
+
+  /// Converts and measures full frames in blocks
+  void processFrames(const uint8_t *data, size_t frames) {
+    const int channels = cfg.channels;
+    while (frames > 0) {
+      size_t n = min(frames, (size_t)LEVEL_METER_BLOCK_FRAMES);
+      size_t bytes = n * channels * sample_size;
+      converter.convert(data, bytes,
+                        (uint8_t *)(block.data() + HISTORY * channels));
+      processBlock(n);
+      data += bytes;
+      frames -= n;
+    }
+  }
+
+  static size_t windowFrames(int ms, int rate) {
+    size_t result = (int64_t)ms * rate / 1000;
+    return result > 0 ? result : 1;
+  }
+
+  void processBlock(size_t n) {
+    const int channels = cfg.channels;
+    float *x = block.data() + HISTORY * channels;
+    updateLevels(x, n * channels);
+    if (cfg.true_peak) updateTruePeak(x, n * channels);
+    if (cfg.loudness) updateLoudness(x, n);
+    // the last frames are the history of the next block
+    memmove(block.data(), block.data() + n * channels,
+            HISTORY * channels * sizeof(float));
+
+    peak_frames += n;
+    if (peak_frames >= peak_window_frames) {
+      for (int ch = 0; ch < channels; ch++) {
+        peaks[ch] = peak_acc[ch];
+        true_peaks[ch] = cfg.true_peak && true_peak_acc[ch] > peak_acc[ch]
+                             ? true_peak_acc[ch]
+                             : peak_acc[ch];
+        peak_acc[ch] = 0.0f;
+        true_peak_acc[ch] = 0.0f;
+      }
+      peak_frames = 0;
+    }
+    rms_frames += n;
+    if (rms_frames >= rms_window_frames) {
+      for (int ch = 0; ch < channels; ch++) {
+        rms_values[ch] = sqrt(sum_acc[ch] / rms_frames);
+        sum_acc[ch] = 0.0;
+      }
+      rms_frames = 0;
+    }
+  }
+
+  /// Peak and sum of squares of count samples
+  void updateLevels(const float *x, size_t count) {
+    const int channels = cfg.channels;
+    size_t j = 0;
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+    if (4 % channels == 0) {
+      // lane k belongs to channel k % channels
+      size_t vector_count = count & ~(size_t)3;
+      float lane_peak[4], lane_sum[4];
+#if defined(USE_SIMD_SSE2)
+      const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+      __m128 v_peak = _mm_setzero_ps();
+      __m128 v_sum = _mm_setzero_ps();
+      for (; j < vector_count; j += 4) {
+        __m128 v = _mm_loadu_ps(x + j);
+        v_peak = _mm_max_ps(v_peak, _mm_and_ps(v, abs_mask));
+        v_sum = _mm_add_ps(v_sum, _mm_mul_ps(v, v));
+      }
+      _mm_storeu_ps(lane_peak, v_peak);
+      _mm_storeu_ps(lane_sum, v_sum);
+#else
+      float32x4_t v_peak = vdupq_n_f32(0.0f);
+      float32x4_t v_sum = vdupq_n_f32(0.0f);
+      for (; j < vector_count; j += 4) {
+        float32x4_t v = vld1q_f32(x + j);
+        v_peak = vmaxq_f32(v_peak, vabsq_f32(v));
+        v_sum = vmlaq_f32(v_sum, v, v);
+      }
+      vst1q_f32(lane_peak, v_peak);
+      vst1q_f32(lane_sum, v_sum);
+#endif
+      for (int k = 0; k < 4; k++) {
+        int ch = k % channels;
+        if (lane_peak[k] > peak_acc[ch]) peak_acc[ch] = lane_peak[k];
+        sum_acc[ch] += lane_sum[k];
+      }
+    }
+#endif
+    // j is at the start of a frame
+    for (; j < count; j += channels) {
+      for (int ch = 0; ch < channels; ch++) {
+        float v = x[j + ch];
+        float a = fabsf(v);
+        if (a > peak_acc[ch]) peak_acc[ch] = a;
+        sum_acc[ch] += v * v;
+      }
+    }
+  }
+
+  /// Cubic (Catmull-Rom) interpolation between x1 and x2 at t
+  static inline float interpolate(float x0, float x1, float x2, float x3,
+                                  const float *w) {
+    return w[0] * x0 + w[1] * x1 + w[2] * x2 + w[3] * x3;
+  }
+
+  /// Estimates the peaks between the samples: the interpolation is between
+  /// the frames -2 and -1, so we lag one frame behind
+  void updateTruePeak(const float *x, size_t count) {
+    // weights for t = 1/4, 1/2 and 3/4
+    static const float w[3][4] = {
+        {-0.0703125f, 0.8671875f, 0.2265625f, -0.0234375f},
+        {-0.0625f, 0.5625f, 0.5625f, -0.0625f},
+        {-0.0234375f, 0.2265625f, 0.8671875f, -0.0703125f}};
+    const int channels = cfg.channels;
+    const float *x0 = x - 3 * channels;
+    const float *x1 = x - 2 * channels;
+    const float *x2 = x - channels;
+    size_t j = 0;
+#if defined(USE_SIMD_SSE2) || defined(USE_SIMD_NEON)
+    if (4 % channels == 0) {
+      size_t vector_count = count & ~(size_t)3;
+      float lane_peak[4];
+#if defined(USE_SIMD_SSE2)
+      const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+      __m128 v_peak = _mm_setzero_ps();
+      for (; j < vector_count; j += 4) {
+        __m128 a = _mm_loadu_ps(x0 + j);
+        __m128 b = _mm_loadu_ps(x1 + j);
+        __m128 c = _mm_loadu_ps(x2 + j);
+        __m128 d = _mm_loadu_ps(x + j);
+        for (int p = 0; p < 3; p++) {
+          __m128 y = _mm_add_ps(
+              _mm_add_ps(_mm_mul_ps(_mm_set1_ps(w[p][0]), a),
+                         _mm_mul_ps(_mm_set1_ps(w[p][1]), b)),
+              _mm_add_ps(_mm_mul_ps(_mm_set1_ps(w[p][2]), c),
+                         _mm_mul_ps(_mm_set1_ps(w[p][3]), d)));
+          v_peak = _mm_max_ps(v_peak, _mm_and_ps(y, abs_mask));
+        }
+      }
+      _mm_storeu_ps(lane_peak, v_peak);
+#else
+      float32x4_t v_peak = vdupq_n_f32(0.0f);
+      for (; j < vector_count; j += 4) {
+        float32x4_t a = vld1q_f32(x0 + j);
+        float32x4_t b = vld1q_f32(x1 + j);
+        float32x4_t c = vld1q_f32(x2 + j);
+        float32x4_t d = vld1q_f32(x + j);
+        for (int p = 0; p < 3; p++) {
+          float32x4_t y = vmulq_n_f32(a, w[p][0]);
+          y = vmlaq_n_f32(y, b, w[p][1]);
+          y = vmlaq_n_f32(y, c, w[p][2]);
+          y = vmlaq_n_f32(y, d, w[p][3]);
+          v_peak = vmaxq_f32(v_peak, vabsq_f32(y));
+        }
+      }
+      vst1q_f32(lane_peak, v_peak);
+#endif
+      for (int k = 0; k < 4; k++) {
+        int ch = k % channels;
+        if (lane_peak[k] > true_peak_acc[ch]) true_peak_acc[ch] = lane_peak[k];
+      }
+    }
+#endif
+    for (; j < count; j += channels) {
+      for (int ch = 0; ch < channels; ch++) {
+        size_t i = j + ch;
+        for (int p = 0; p < 3; p++) {
+          float y = fabsf(interpolate(x0[i], x1[i], x2[i], x[i], w[p]));
+          if (y > true_peak_acc[ch]) true_peak_acc[ch] = y;
+        }
+      }
+    }
+  }
+
+  /// K-weighting and mean square of the 100 ms sub blocks
+  void updateLoudness(const float *x, size_t n) {
+    const int channels = cfg.channels;
+    if (channels == 2) {
+      sub_energy += kWeight<2>(x, n, 2, k_state.data());
+    } else {
+      for (int ch = 0; ch < channels; ch++) {
+        sub_energy += kWeight<1>(x + ch, n, channels, k_state.data() + ch * 6);
+      }
+    }
+    sub_frames += n;
+    if (sub_frames >= sub_block_frames) {
+      energies[energy_pos] = sub_energy / sub_frames;
+      energy_pos = (energy_pos + 1) % ENERGY_BLOCKS;
+      if (energy_count < ENERGY_BLOCKS) energy_count++;
+      sub_energy = 0.0;
+      sub_frames = 0;
+    }
+  }
+
+  /// Direct form 1 K-weighting of CH channels in one loop: the input history
+  /// of the RLB high pass is the output history of the pre filter, so we keep
+  /// 6 values per channel. Returns the sum of the squared results.
+  template <int CH>
+  float kWeight(const float *in, size_t n, int stride, float *state) {
+    const Biquad p = k_pre;
+    const float a1 = k_rlb.a1, a2 = k_rlb.a2;
+    float x1[CH], x2[CH], y1[CH], y2[CH], z1[CH], z2[CH], energy[CH];
+    for (int c = 0; c < CH; c++) {
+      float *s = state + c * 6;
+      x1[c] = s[0];
+      x2[c] = s[1];
+      y1[c] = s[2];
+      y2[c] = s[3];
+      z1[c] = s[4];
+      z2[c] = s[5];
+      energy[c] = 0.0f;
+    }
+    for (size_t j = 0; j < n; j++) {
+      for (int c = 0; c < CH; c++) {
+        float x0 = in[j * stride + c];
+        // the feedback is added last so that it is not part of the critical path
+        float y0 = (p.b0 * x0 + p.b1 * x1[c] + p.b2 * x2[c] - p.a2 * y2[c]) -
+                   p.a1 * y1[c];
+        float z0 = (y0 - 2.0f * y1[c] + y2[c] - a2 * z2[c]) - a1 * z1[c];
+        x2[c] = x1[c];
+        x1[c] = x0;
+        y2[c] = y1[c];
+        y1[c] = y0;
+        z2[c] = z1[c];
+        z1[c] = z0;
+        energy[c] += z0 * z0;
+      }
+    }
+    float result = 0.0f;
+    for (int c = 0; c < CH; c++) {
+      float *s = state + c * 6;
+      s[0] = x1[c];
+      s[1] = x2[c];
+      // avoid denormals
+      s[2] = fabsf(y1[c]) < 1e-15f ? 0.0f : y1[c];
+      s[3] = fabsf(y2[c]) < 1e-15f ? 0.0f : y2[c];
+      s[4] = fabsf(z1[c]) < 1e-15f ? 0.0f : z1[c];
+      s[5] = fabsf(z2[c]) < 1e-15f ? 0.0f : z2[c];
+      result += energy[c];
+    }
+    return result;
+  }
+
+  /// K-weighting filter coefficients for the sample rate (ITU-R BS.1770)
+  void setupKWeighting(int rate) {
+    // high shelf pre filter
+    double f0 = 1681.974450955533;
+    double g = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / rate);
+    double vh = pow(10.0, g / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    k_pre.b0 = (vh + vb * k / q + k * k) / a0;
+    k_pre.b1 = 2.0 * (k * k - vh) / a0;
+    k_pre.b2 = (vh - vb * k / q + k * k) / a0;
+    k_pre.a1 = 2.0 * (k * k - 1.0) / a0;
+    k_pre.a2 = (1.0 - k / q + k * k) / a0;
+    // RLB high pass
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / rate);
+    a0 = 1.0 + k / q + k * k;
+    k_rlb.b0 = 1.0;
+    k_rlb.b1 = -2.0;
+    k_rlb.b2 = 1.0;
+    k_rlb.a1 = 2.0 * (k * k - 1.0) / a0;
+    k_rlb.a2 = (1.0 - k / q + k * k) / a0;
+  }
+};
+
+}  // namespace audio_tools
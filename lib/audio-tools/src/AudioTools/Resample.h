@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AudioTools/AudioStreams.h"
+#include "AudioTools/Converter.h"
 
 namespace audio_tools {
 
@@ -24,6 +25,16 @@ class Resample : public AudioStreamX {
          * call setOut and begin to setup the required parameters
          */
         Resample() = default;
+
+        ~Resample() {
+            delete[] last_end;
+        }
+
+        /// Defines the arena from which we take the conversion buffer: call before begin()
+        void setArena(ScratchArena &arena){
+            buffer_data.setArena(&arena);
+        }
+
         /**
          * @brief Construct a new Converter Resample object
          * 
@@ -46,7 +57,9 @@ class Resample : public AudioStreamX {
             return begin(channels, factor, scenario);
         }
 
-        bool begin(int channels, int factor, ResampleScenario scenario) {
+        /// Starts the processing: bufferSize is the max number of bytes that are processed at once. 
+        /// Bigger writes are split up, reads provide max this size.
+        bool begin(int channels, int factor, ResampleScenario scenario, int bufferSize=DEFAULT_BUFFER_SIZE) {
             this->channels = channels;
             this->factor = factor;
             this->scenario = scenario;
@@ -60,6 +73,14 @@ class Resample : public AudioStreamX {
             
             downsample_start_offset = 0;
             downsample_skip_counter = 0;
+
+            // process full frames: the exact downsampling needs a multiple of the factor
+            if (is_active){
+                int align = channels * max(factor, 1);
+                chunk_samples = max(bufferSize / (int)sizeof(T) / align, 1) * align;
+                // the worst case is upsampling on write and downsampling on read
+                allocateBuffer(chunk_samples * max(factor, 2));
+            }
             //LOGD("is_active: %d for factor %d", is_active, factor);
             return is_active;
         }
@@ -89,37 +110,15 @@ class Resample : public AudioStreamX {
                 return 0;
             }
             
-            // convert
+            // convert in chunks which fit into the buffer
             size_t result = 0;
-            int sample_count = byte_count / sizeof(T);
+            size_t chunk_bytes = chunk_samples * sizeof(T);
             bytes = 0;
-
-            switch(scenario){
-                case UPSAMPLE_EXACT: {
-                    allocateBuffer(sample_count*factor);
-                    bytes = upsample((T*)src, buffer, sample_count, channels, factor) * sizeof(T);
-                    result = p_out->write((uint8_t*)buffer, bytes) / factor;
-                     } break;
-                case UPSAMPLE: {
-                    allocateBuffer(sample_count*factor);
-                    bytes = upsampleMultiply((T*)src, buffer, sample_count, channels, factor) * sizeof(T);
-                    result = p_out->write((uint8_t*)buffer, bytes) / factor;
-                     } break;
-                case DOWNSAMPLE_EXACT: {
-                    allocateBuffer(sample_count/factor);
-                    bytes = downsample((T*)src, buffer , sample_count, channels, factor) * sizeof(T);
-                    result = p_out->write((uint8_t*)buffer, bytes) * factor;
-                    }  break;
-                case DOWNSAMPLE: {
-                    allocateBuffer(sample_count);
-                    int skip_every_nth = factor;
-                    bytes = downsampleSkip((T*)src, buffer , sample_count, channels, skip_every_nth) * sizeof(T);
-                    result = p_out->write((uint8_t*)buffer, bytes) * factor;
-                    } break;
-
-                default:
-                    LOGE("Not supported");
-                    break;
+            for (size_t pos=0; pos<byte_count; pos+=chunk_bytes){
+                size_t len = min(byte_count-pos, chunk_bytes);
+                size_t written = writeChunk(src+pos, len);
+                result += written;
+                if (written<len) break;
             }
             return result;
         }
@@ -127,7 +126,7 @@ class Resample : public AudioStreamX {
         /// Determines the available bytes from the final source stream 
         int available() override { return p_in!=nullptr ? p_in->available() : 0; }
 
-        /// Reads the up/downsampled bytes
+        /// Reads the up/downsampled bytes: we provide max the buffer size
         size_t readBytes(uint8_t *src, size_t length) override { 
             if (p_in==nullptr) return 0;
             if (!is_active){
@@ -135,6 +134,7 @@ class Resample : public AudioStreamX {
             }
 
             // validate length
+            length = min(length, chunk_samples * sizeof(T));
             if (length%channels!=0){
                 length = length / channels * channels;
             }
@@ -145,34 +145,26 @@ class Resample : public AudioStreamX {
             switch(scenario){
                 case UPSAMPLE_EXACT: {
                     int read_len = length / factor;
-                    int sample_count = read_len / sizeof(T);
-                    allocateBuffer(sample_count);
                     read_len = p_in->readBytes((uint8_t*)buffer, read_len);
-                    sample_count = read_len / sizeof(T);
+                    int sample_count = read_len / sizeof(T);
                     byte_count = upsample(buffer,(T*)src, sample_count, channels, factor) * sizeof(T);
                     } break;
                 case UPSAMPLE: {
                     int read_len = length / factor;
-                    int sample_count = read_len / sizeof(T);
-                    allocateBuffer(sample_count);
                     read_len = p_in->readBytes((uint8_t*)buffer, read_len);
-                    sample_count = read_len / sizeof(T);
+                    int sample_count = read_len / sizeof(T);
                     byte_count = upsampleMultiply(buffer,(T*)src, sample_count, channels, factor) * sizeof(T);
                     } break;
                 case DOWNSAMPLE_EXACT: {
                     int read_len = length * factor;
-                    int sample_count = read_len / sizeof(T);
-                    allocateBuffer(sample_count);
                     read_len = p_in->readBytes((uint8_t*)buffer, read_len);
-                    sample_count = read_len / sizeof(T);
+                    int sample_count = read_len / sizeof(T);
                     byte_count = downsample(buffer,(T*)src, sample_count, channels, factor) * sizeof(T);
                     } break;
                 case DOWNSAMPLE: {
                     int read_len = length +  (length / factor);
-                    int sample_count = read_len / sizeof(T);
-                    allocateBuffer(sample_count);
                     read_len = p_in->readBytes((uint8_t*)buffer, read_len);
-                    sample_count = read_len / sizeof(T);
+                    int sample_count = read_len / sizeof(T);
                     byte_count = downsampleSkip(buffer,(T*)src, sample_count, channels,factor) * sizeof(T);
                     } break;
                 default:
@@ -197,22 +189,57 @@ class Resample : public AudioStreamX {
         ResampleScenario scenario;
         Print *p_out=nullptr;
         Stream *p_in=nullptr;
+        ScratchBuffer<T> buffer_data;
         T *buffer=nullptr;
         T *last_end=nullptr;
         int channels = 2;
         int factor = 1;
         int buffer_size = 0;
+        size_t chunk_samples = 0;
         int downsample_start_offset = 0;
         int downsample_skip_counter = 0;
         bool is_active = false;
         size_t bytes = 0;
 
+        /// Converts and writes max chunk_samples 
+        size_t writeChunk(const uint8_t *src, size_t byte_count) {
+            size_t result = 0;
+            int sample_count = byte_count / sizeof(T);
+            size_t chunk_bytes = 0;
+
+            switch(scenario){
+                case UPSAMPLE_EXACT: {
+                    chunk_bytes = upsample((T*)src, buffer, sample_count, channels, factor) * sizeof(T);
+                    result = p_out->write((uint8_t*)buffer, chunk_bytes) / factor;
+                     } break;
+                case UPSAMPLE: {
+                    chunk_bytes = upsampleMultiply((T*)src, buffer, sample_count, channels, factor) * sizeof(T);
+                    result = p_out->write((uint8_t*)buffer, chunk_bytes) / factor;
+                     } break;
+                case DOWNSAMPLE_EXACT: {
+                    chunk_bytes = downsample((T*)src, buffer , sample_count, channels, factor) * sizeof(T);
+                    result = p_out->write((uint8_t*)buffer, chunk_bytes) * factor;
+                    }  break;
+                case DOWNSAMPLE: {
+                    int skip_every_nth = factor;
+                    chunk_bytes = downsampleSkip((T*)src, buffer , sample_count, channels, skip_every_nth) * sizeof(T);
+                    result = p_out->write((uint8_t*)buffer, chunk_bytes) * factor;
+                    } break;
+
+                default:
+                    LOGE("Not supported");
+                    break;
+            }
+            bytes += chunk_bytes;
+            return result;
+        }
+
         // allocates a buffer; len is specified in samples
         void allocateBuffer(int len) {
             if (len>buffer_size){
-                if (buffer!=nullptr) delete []buffer;
-                buffer = new T[len];
-                buffer_size = len;
+                buffer_data.resize(len);
+                buffer = buffer_data.data();
+                buffer_size = buffer_data.size();
             }
             if (last_end==nullptr){
                 last_end = new T[channels];
@@ -230,7 +257,6 @@ class Resample : public AudioStreamX {
             int frame_count = sample_count / channels;
             size_t result = 0;
             for (int16_t j=0; j<frame_count; j+=factor){
-                long total[channels];
                 for (int8_t ch=0; ch<channels; ch++){
                     to_pos = j/factor;
                     *p_data(to_pos, ch, to) = *p_data(j, ch, from);
@@ -277,17 +303,16 @@ class Resample : public AudioStreamX {
         /// Increases the samples by the indicated factor: We repeat the input samples.
         size_t upsampleMultiply(T *from, T* to, int sample_count, int channels, int factor ){
             int frame_count = sample_count/channels;
-            memset(to,0, sample_count*factor*2);
             // just repeat each frame facor times
             int idx = 0;
             for (int j=0;j<frame_count;j++){
                 for (int f=0;f<factor;f++){
                     for (int ch=0;ch<channels;ch++){
-                        to[idx++] = from[j+ch];
+                        to[idx++] = from[j*channels+ch];
                     }
                 }
             }
-            return sample_count*channels*factor;
+            return frame_count*channels*factor;
         }
 
 
@@ -305,7 +330,8 @@ class Resample : public AudioStreamX {
                     pos =(frame_pos+1)*factor; 
                     *p_data(pos, ch, to) = actual_data; 
                     result++;
-                    for (int16_t f=1;f<=factor;f++){
+                    // the value at f==factor is the next frame
+                    for (int16_t f=1;f<factor;f++){
                         pos = ((frame_pos+1)*factor)+f; 
                         T tmp = actual_data + (diff*f);
                         *p_data(pos, ch, to) = tmp; 
@@ -426,6 +452,860 @@ class ResampleParameterEstimator {
             LOGI("div: %d, fact %d -> rate: %d, rate_eff: %f", div, fact, to_rate, to_rate_eff);
         }
 };
+/**
+ * @brief Kaiser window which is used to design the resampling filters
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class KaiserWindow {
+    public:
+        /// Value of the window for x in the range -1 to 1
+        static double value(double x, double beta){
+            if (x < -1.0 || x > 1.0) return 0.0;
+            return besselI0(beta * sqrt(1.0 - x * x)) / besselI0(beta);
+        }
+
+        /// Modified Bessel function of the first kind
+        static double besselI0(double x){
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 50; k++){
+                double f = x / (2.0 * k);
+                term *= f * f;
+                sum += term;
+                if (term < sum * 1e-12) break;
+            }
+            return sum;
+        }
+};
+
+/**
+ * @brief Resampler for any rational ratio of the sample rates (e.g. 44100 ->
+ * 48000 is 160/147) which uses a polyphase windowed sinc low pass filter. The
+ * coefficients of all phases are calculated in begin(), so that each output
+ * sample only needs a dot product with the input frames. 16 bit data is
+ * processed with Q14 coefficients and 32 bit accumulators (High and VeryHigh:
+ * Q30 coefficients and 64 bit accumulators), all other data types with
+ * floats.
+ *
+ * The ResamplePrecision defines the number of taps, the Kaiser window and
+ * the max number of phases. If the ratio needs more phases we use the
+ * nearest one. The output is delayed by half of the filter length.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T data type of audio data
+ */
+template<typename T>
+class PolyphaseResampler {
+    public:
+        PolyphaseResampler() = default;
+
+        /// Calculates the filter: blockFrames is the max number of input frames which can be added at once
+        bool begin(int channels, int fromRate, int toRate, ResamplePrecision precision=Medium, int blockFrames=256){
+            if (channels<=0 || fromRate<=0 || toRate<=0 || blockFrames<=0){
+                LOGE("Invalid parameters: channels %d, from %d, to %d", channels, fromRate, toRate);
+                return false;
+            }
+            int g = gcd(fromRate, toRate);
+            return beginRatio(channels, toRate / g, fromRate / g, precision, blockFrames);
+        }
+
+        /// Calculates the filter for the ratio up/down of the output to the input rate
+        bool beginRatio(int channels, int up, int down, ResamplePrecision precision=Medium, int blockFrames=256){
+            if (channels<=0 || up<=0 || down<=0 || blockFrames<=0){
+                LOGE("Invalid parameters: channels %d, up %d, down %d", channels, up, down);
+                return false;
+            }
+            this->channels = channels;
+            this->up = up;
+            setDownFactor(down);
+
+            int base_taps;
+            float beta, rolloff;
+            int max_phases;
+            switch(precision){
+                case Low: base_taps = 8; beta = 5.0f; rolloff = 0.80f; max_phases = 128; break;
+                case High: base_taps = 32; beta = 8.0f; rolloff = 0.92f; max_phases = 1024; break;
+                case VeryHigh: base_taps = 64; beta = 9.5f; rolloff = 0.95f; max_phases = 1024; break;
+                default: base_taps = 16; beta = 6.5f; rolloff = 0.88f; max_phases = 512; break;
+            }
+            // to downsample the filter must be wider to reduce the bandwidth
+            tap_count = base_taps;
+            if (down > up){
+                tap_count = (base_taps * down + up - 1) / up;
+                tap_count += tap_count % 2;
+                if (tap_count > max_taps){
+                    LOGW("Limiting the taps from %d to %d", tap_count, max_taps);
+                    tap_count = max_taps;
+                }
+            }
+            is_wide = precision == High || precision == VeryHigh;
+            phase_count = min(up, max_phases);
+            phase_scale = static_cast<float>(phase_count) / up;
+            float cutoff = (down > up ? static_cast<float>(up) / down : 1.0f) * rolloff;
+            calculateCoefficients(cutoff, beta);
+            LOGI("PolyphaseResampler %d/%d: %d taps, %d phases", up, down, tap_count, phase_count);
+
+            // history and new input frames
+            capacity_frames = tap_count + blockFrames;
+            buffer.resize(capacity_frames * channels);
+            memset(buffer.data(), 0, buffer.size() * sizeof(T));
+            // the first output is aligned with the first input frame
+            frame_count = tap_count / 2 - 1;
+            pos = 0;
+            phase = 0;
+            return true;
+        }
+
+        /// Number of frames which can be added
+        size_t inputCapacity() {
+            return capacity_frames - frame_count;
+        }
+
+        /// Adds interleaved input frames: returns the number of added frames
+        size_t addInput(const T *in, size_t frames){
+            frames = min(frames, inputCapacity());
+            memcpy(buffer.data() + frame_count * channels, in, frames * channels * sizeof(T));
+            frame_count += frames;
+            return frames;
+        }
+
+        /// Provides the resampled interleaved frames: returns the number of frames
+        size_t output(T *out, size_t maxFrames){
+            size_t result = 0;
+            while (result < maxFrames && pos + tap_count <= frame_count){
+                // nearest phase: the last one is the first phase of the next frame
+                int p = phase_count == up ? phase : static_cast<int>(phase * phase_scale + 0.5f);
+                filter(buffer.data() + pos * channels, p, out + result * channels);
+                result++;
+                pos += down_int;
+                phase += down_frac;
+                if (phase >= up){
+                    phase -= up;
+                    pos++;
+                }
+            }
+            // remove the frames which are not needed any more
+            size_t shift = min(pos, frame_count);
+            if (shift > 0){
+                frame_count -= shift;
+                pos -= shift;
+                memmove(buffer.data(), buffer.data() + shift * channels, frame_count * channels * sizeof(T));
+            }
+            return result;
+        }
+
+        /// Max number of output frames which result from the indicated input frames
+        size_t maxOutputFrames(size_t inFrames) {
+            return (static_cast<uint64_t>(inFrames) * up) / down + 2;
+        }
+
+        /// Number of input frames which are missing to provide the indicated output frames
+        size_t inputFramesFor(size_t outFrames){
+            if (outFrames == 0) return 0;
+            uint64_t needed = pos + tap_count + (static_cast<uint64_t>(outFrames - 1) * down + phase) / up;
+            return needed > frame_count ? needed - frame_count : 0;
+        }
+
+        /// Changes the downsampling factor without recalculating the filter: used
+        /// to fine tune the ratio
+        void setDownFactor(int down){
+            if (down <= 0) return;
+            this->down = down;
+            down_int = down / up;
+            down_frac = down % up;
+        }
+
+        /// Upsampling factor of the reduced ratio
+        int upFactor() { return up; }
+
+        /// Downsampling factor of the reduced ratio
+        int downFactor() { return down; }
+
+        /// Number of taps per phase
+        int taps() { return tap_count; }
+
+        /// Number of calculated phases
+        int phases() { return phase_count; }
+
+    protected:
+        static const int max_taps = 512;
+        Vector<T> buffer;
+        Vector<int16_t> coef_fixed;
+        Vector<int32_t> coef_wide;
+        Vector<float> coef_float;
+        int channels = 0;
+        int up = 1;
+        int down = 1;
+        int down_int = 1;
+        int down_frac = 0;
+        int tap_count = 0;
+        int phase_count = 0;
+        float phase_scale = 1.0f;
+        size_t capacity_frames = 0;
+        size_t frame_count = 0;
+        size_t pos = 0;
+        int phase = 0;
+        bool is_wide = false;
+
+        static int gcd(int a, int b){
+            while (b != 0){
+                int tmp = a % b;
+                a = b;
+                b = tmp;
+            }
+            return a;
+        }
+
+        static bool isFixedPoint(int16_t*) { return true; }
+        template <typename V>
+        static bool isFixedPoint(V*) { return false; }
+
+        void calculateCoefficients(float cutoff, float beta){
+            bool fixed = isFixedPoint((T*)nullptr);
+            // if we round to the nearest phase we also need the phase for a fraction of 1
+            int count = phase_count == up ? phase_count : phase_count + 1;
+            if (fixed && is_wide) coef_wide.resize(count * tap_count);
+            else if (fixed) coef_fixed.resize(count * tap_count);
+            else coef_float.resize(count * tap_count);
+            Vector<double> tmp(tap_count);
+            double half = tap_count / 2.0;
+            for (int p = 0; p < count; p++){
+                double frac = static_cast<double>(p) / phase_count;
+                double sum = 0.0;
+                for (int k = 0; k < tap_count; k++){
+                    double t = k - (tap_count / 2 - 1) - frac;
+                    double x = t / half;
+                    double w = KaiserWindow::value(x, beta);
+                    double arg = M_PI * cutoff * t;
+                    double sinc = t == 0.0 ? 1.0 : sin(arg) / arg;
+                    tmp[k] = sinc * w;
+                    sum += tmp[k];
+                }
+                // each phase has a gain of exactly 1
+                int center = tap_count / 2 - 1 + (frac >= 0.5 ? 1 : 0);
+                if (fixed && is_wide){
+                    int32_t *c = coef_wide.data() + p * tap_count;
+                    int64_t total = 0;
+                    for (int k = 0; k < tap_count; k++){
+                        c[k] = static_cast<int32_t>(llround(tmp[k] / sum * 1073741824.0));
+                        total += c[k];
+                    }
+                    c[center] += 1073741824 - total;
+                } else if (fixed){
+                    int16_t *c = coef_fixed.data() + p * tap_count;
+                    int32_t total = 0;
+                    for (int k = 0; k < tap_count; k++){
+                        c[k] = static_cast<int16_t>(lround(tmp[k] / sum * 16384.0));
+                        total += c[k];
+                    }
+                    c[center] += 16384 - total;
+                } else {
+                    float *c = coef_float.data() + p * tap_count;
+                    for (int k = 0; k < tap_count; k++){
+                        c[k] = tmp[k] / sum;
+                    }
+                }
+            }
+        }
+
+        /// Q14 dot product for 16 bit data
+        void filter(const int16_t *x, int p, int16_t *out){
+            if (is_wide){
+                filterWide(x, p, out);
+                return;
+            }
+            const int16_t *c = coef_fixed.data() + p * tap_count;
+            const int n = tap_count;
+            if (channels == 2){
+                int32_t acc0 = 1 << 13, acc1 = 1 << 13;
+                for (int k = 0; k < n; k++){
+                    acc0 += c[k] * x[2 * k];
+                    acc1 += c[k] * x[2 * k + 1];
+                }
+                out[0] = saturate16(acc0 >> 14);
+                out[1] = saturate16(acc1 >> 14);
+                return;
+            }
+            for (int ch = 0; ch < channels; ch++){
+                const int16_t *xc = x + ch;
+                int32_t acc = 1 << 13;
+                for (int k = 0; k < n; k++){
+                    acc += c[k] * xc[k * channels];
+                }
+                out[ch] = saturate16(acc >> 14);
+            }
+        }
+
+        /// Q30 dot product for 16 bit data: the coefficients of long filters are
+        /// too small for Q14
+        void filterWide(const int16_t *x, int p, int16_t *out){
+            const int32_t *c = coef_wide.data() + p * tap_count;
+            for (int ch = 0; ch < channels; ch++){
+                const int16_t *xc = x + ch;
+                int64_t acc = 1 << 29;
+                for (int k = 0; k < tap_count; k++){
+                    acc += static_cast<int64_t>(c[k]) * xc[k * channels];
+                }
+                out[ch] = saturate16(acc >> 30);
+            }
+        }
+
+        /// float dot product for all other data types
+        template <typename V>
+        void filter(const V *x, int p, V *out){
+            const float *c = coef_float.data() + p * tap_count;
+            for (int ch = 0; ch < channels; ch++){
+                const V *xc = x + ch;
+                float acc = 0.0f;
+                for (int k = 0; k < tap_count; k++){
+                    acc += c[k] * static_cast<float>(xc[k * channels]);
+                }
+                store(acc, out[ch]);
+            }
+        }
+
+        static inline int16_t saturate16(int64_t value){
+            if (value > INT16_MAX) return INT16_MAX;
+            if (value < INT16_MIN) return INT16_MIN;
+            return value;
+        }
+
+        static inline void store(float value, float &out){
+            out = value;
+        }
+
+        template <typename V>
+        static inline void store(float value, V &out){
+            double max_value = NumberConverter::maxValue(sizeof(V) * 8);
+            double result = value;
+            if (result > max_value) result = max_value;
+            if (result < -max_value) result = -max_value;
+            out = static_cast<int32_t>(result);
+        }
+};
+
+/**
+ * @brief Arithmetic of the halfband filters: we use floats by default
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T data type of audio data
+ */
+template<typename T>
+struct HalfbandArithmetic {
+    typedef float coef_t;
+    typedef float acc_t;
+    static coef_t coef(double value) { return value; }
+    static acc_t start() { return 0.0f; }
+    static T result(acc_t acc) {
+        double max_value = NumberConverter::maxValue(sizeof(T) * 8);
+        double value = acc;
+        if (value > max_value) value = max_value;
+        if (value < -max_value) value = -max_value;
+        return static_cast<int32_t>(value);
+    }
+};
+
+/// 16 bit data is processed with Q14 coefficients and 32 bit accumulators
+template<>
+struct HalfbandArithmetic<int16_t> {
+    typedef int16_t coef_t;
+    typedef int32_t acc_t;
+    static coef_t coef(double value) { return static_cast<int16_t>(lround(value * 16384.0)); }
+    static acc_t start() { return 1 << 13; }
+    static int16_t result(acc_t acc) {
+        acc >>= 14;
+        if (acc > INT16_MAX) return INT16_MAX;
+        if (acc < INT16_MIN) return INT16_MIN;
+        return acc;
+    }
+};
+
+template<>
+struct HalfbandArithmetic<float> {
+    typedef float coef_t;
+    typedef float acc_t;
+    static coef_t coef(double value) { return value; }
+    static acc_t start() { return 0.0f; }
+    static float result(acc_t acc) { return acc; }
+};
+
+/**
+ * @brief A single stage of the HalfbandResampler which decimates or
+ * interpolates by 2 (halfband filter) or 3 (third band filter). In these
+ * filters every 2nd (3rd) coefficient is 0, so we only need to calculate the
+ * remaining ones: the decimator also uses the symmetry of the coefficients
+ * and the interpolator just copies every 2nd (3rd) output sample.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T data type of audio data
+ */
+template<typename T>
+class HalfbandStage {
+    public:
+        /// Defines the stage: the filter has 2 * factor * halfLength + 1 taps
+        bool begin(int channels, int factor, bool decimate, int halfLength, float beta, int blockFrames){
+            if (channels <= 0 || (factor != 2 && factor != 3) || halfLength <= 0){
+                LOGE("Invalid parameters: channels %d, factor %d", channels, factor);
+                return false;
+            }
+            this->channels = channels;
+            this->factor = factor;
+            this->decimate = decimate;
+            half = factor * halfLength;
+            int tap_count = 2 * half + 1;
+
+            // windowed sinc with a cutoff at the nyquist frequency of the lower rate
+            Vector<double> h(tap_count);
+            double sum = 0.0;
+            for (int k = 0; k < tap_count; k++){
+                int d = k - half;
+                double arg = M_PI * d / factor;
+                h[k] = d == 0 ? 1.0 : sin(arg) / arg;
+                if (d != 0 && d % factor == 0) h[k] = 0.0;
+                h[k] *= KaiserWindow::value(static_cast<double>(d) / (half + 1), beta);
+                sum += h[k];
+            }
+
+            if (decimate){
+                // center and symmetric pairs of the coefficients which are not 0
+                center = Arithmetic::coef(h[half] / sum);
+                pair_coef.resize(0);
+                pair_offset.resize(0);
+                for (int d = 1; d < half; d++){
+                    if (d % factor == 0) continue;
+                    pair_coef.push_back(Arithmetic::coef(h[half + d] / sum));
+                    pair_offset.push_back(d * channels);
+                }
+                window_frames = tap_count;
+                // the first window is centered on the first input frame
+                frame_count = half;
+            } else {
+                // the sub filter of each output phase: phase 0 is a copy; the
+                // first tap of the other phases is outside of the filter
+                sub_taps = 2 * halfLength + 1;
+                phase_coef.resize((factor - 1) * sub_taps);
+                for (int p = 1; p < factor; p++){
+                    double phase_sum = 0.0;
+                    for (int j = 0; j < sub_taps; j++){
+                        int k = p + (sub_taps - 1 - j) * factor;
+                        phase_sum += k < tap_count ? h[k] : 0.0;
+                    }
+                    for (int j = 0; j < sub_taps; j++){
+                        int k = p + (sub_taps - 1 - j) * factor;
+                        phase_coef[(p - 1) * sub_taps + j] = Arithmetic::coef(k < tap_count ? h[k] / phase_sum : 0.0);
+                    }
+                }
+                // the halfband phase is symmetric, so we can add the samples first
+                is_symmetric = factor == 2;
+                window_frames = sub_taps;
+                frame_count = sub_taps - 1;
+            }
+            capacity_frames = window_frames + blockFrames;
+            history.resize(capacity_frames * channels);
+            memset(history.data(), 0, history.size() * sizeof(T));
+            pos = 0;
+            return true;
+        }
+
+        /// Max number of output frames for the indicated input frames
+        size_t maxOutputFrames(size_t inFrames) {
+            return decimate ? inFrames / factor + 1 : inFrames * factor;
+        }
+
+        /// Filters the interleaved frames: returns the number of output frames
+        size_t process(const T *in, size_t frames, T *out){
+            size_t result = 0;
+            while (frames > 0){
+                size_t len = min(frames, capacity_frames - frame_count);
+                memcpy(history.data() + frame_count * channels, in, len * channels * sizeof(T));
+                frame_count += len;
+                in += len * channels;
+                frames -= len;
+                T *target = out + result * channels;
+                result += decimate ? processDecimation(target) : processInterpolation(target);
+                // remove the frames which are not needed any more
+                size_t shift = min(pos, frame_count);
+                frame_count -= shift;
+                pos -= shift;
+                memmove(history.data(), history.data() + shift * channels, frame_count * channels * sizeof(T));
+            }
+            return result;
+        }
+
+    protected:
+        typedef HalfbandArithmetic<T> Arithmetic;
+        typedef typename Arithmetic::coef_t coef_t;
+        typedef typename Arithmetic::acc_t acc_t;
+        Vector<T> history;
+        Vector<coef_t> pair_coef;
+        Vector<int> pair_offset;
+        Vector<coef_t> phase_coef;
+        coef_t center = 0;
+        int channels = 0;
+        int factor = 2;
+        int half = 0;
+        int sub_taps = 0;
+        bool decimate = true;
+        bool is_symmetric = false;
+        size_t window_frames = 0;
+        size_t capacity_frames = 0;
+        size_t frame_count = 0;
+        size_t pos = 0;
+
+        size_t processDecimation(T *out){
+            size_t result = 0;
+            const int pairs = pair_coef.size();
+            const coef_t *c = pair_coef.data();
+            const int *offset = pair_offset.data();
+            while (pos + window_frames <= frame_count){
+                const T *x = history.data() + (pos + half) * channels;
+                if (channels == 2){
+                    // both channels in one loop
+                    acc_t acc0 = Arithmetic::start() + center * static_cast<acc_t>(x[0]);
+                    acc_t acc1 = Arithmetic::start() + center * static_cast<acc_t>(x[1]);
+                    for (int j = 0; j < pairs; j++){
+                        const T *a = x - offset[j];
+                        const T *b = x + offset[j];
+                        acc0 += c[j] * (static_cast<acc_t>(a[0]) + b[0]);
+                        acc1 += c[j] * (static_cast<acc_t>(a[1]) + b[1]);
+                    }
+                    *out++ = Arithmetic::result(acc0);
+                    *out++ = Arithmetic::result(acc1);
+                    result++;
+                    pos += factor;
+                    continue;
+                }
+                for (int ch = 0; ch < channels; ch++){
+                    acc_t acc = Arithmetic::start() + center * static_cast<acc_t>(x[ch]);
+                    for (int j = 0; j < pairs; j++){
+                        acc += c[j] * (static_cast<acc_t>(x[ch - offset[j]]) + x[ch + offset[j]]);
+                    }
+                    *out++ = Arithmetic::result(acc);
+                }
+                result++;
+                pos += factor;
+            }
+            return result;
+        }
+
+        size_t processInterpolation(T *out){
+            size_t result = 0;
+            // we skip the first tap which is always 0
+            const int n = sub_taps - 1;
+            const int copy_pos = sub_taps / 2;
+            while (pos + window_frames <= frame_count){
+                const T *x = history.data() + pos * channels;
+                for (int ch = 0; ch < channels; ch++){
+                    out[ch] = x[copy_pos * channels + ch];
+                }
+                out += channels;
+                for (int p = 1; p < factor; p++){
+                    const coef_t *c = phase_coef.data() + (p - 1) * sub_taps + 1;
+                    const T *xp = x + channels;
+                    if (channels == 2){
+                        // both channels in one loop
+                        if (is_symmetric) dotSymmetricStereo(c, xp, n, out);
+                        else dotStereo(c, xp, n, out);
+                        out += 2;
+                        continue;
+                    }
+                    for (int ch = 0; ch < channels; ch++){
+                        *out++ = is_symmetric ? dotSymmetric(c, xp + ch, n) : dot(c, xp + ch, n);
+                    }
+                }
+                result += factor;
+                pos++;
+            }
+            return result;
+        }
+
+        /// dot product of the interleaved samples of a channel
+        inline T dot(const coef_t *c, const T *x, int n){
+            const int step = channels;
+            acc_t acc0 = Arithmetic::start(), acc1 = 0;
+            int j = 0;
+            for (; j + 1 < n; j += 2){
+                acc0 += c[j] * static_cast<acc_t>(x[j * step]);
+                acc1 += c[j + 1] * static_cast<acc_t>(x[(j + 1) * step]);
+            }
+            if (j < n) acc0 += c[j] * static_cast<acc_t>(x[j * step]);
+            return Arithmetic::result(acc0 + acc1);
+        }
+
+        /// dot product for symmetric coefficients with an even length
+        inline T dotSymmetric(const coef_t *c, const T *x, int n){
+            const int step = channels;
+            acc_t acc = Arithmetic::start();
+            for (int j = 0; j < n / 2; j++){
+                acc += c[j] * (static_cast<acc_t>(x[j * step]) + x[(n - 1 - j) * step]);
+            }
+            return Arithmetic::result(acc);
+        }
+
+        inline void dotStereo(const coef_t *c, const T *x, int n, T *out){
+            acc_t acc0 = Arithmetic::start(), acc1 = Arithmetic::start();
+            for (int j = 0; j < n; j++){
+                acc0 += c[j] * static_cast<acc_t>(x[2 * j]);
+                acc1 += c[j] * static_cast<acc_t>(x[2 * j + 1]);
+            }
+            out[0] = Arithmetic::result(acc0);
+            out[1] = Arithmetic::result(acc1);
+        }
+
+        inline void dotSymmetricStereo(const coef_t *c, const T *x, int n, T *out){
+            acc_t acc0 = Arithmetic::start(), acc1 = Arithmetic::start();
+            const T *y = x + 2 * (n - 1);
+            for (int j = 0; j < n / 2; j++){
+                acc0 += c[j] * (static_cast<acc_t>(x[2 * j]) + y[-2 * j]);
+                acc1 += c[j] * (static_cast<acc_t>(x[2 * j + 1]) + y[1 - 2 * j]);
+            }
+            out[0] = Arithmetic::result(acc0);
+            out[1] = Arithmetic::result(acc1);
+        }
+};
+
+/**
+ * @brief Changes the sample rate by an integer factor which is a product of 2
+ * and 3 (e.g. 48000 -> 8000 or 8000 -> 48000) with a cascade of halfband and
+ * third band filters. This is much cheaper than the PolyphaseResampler. To
+ * decimate we start with the halfband stages, to interpolate we end with
+ * them, so that the cheapest filters run at the highest rate.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T data type of audio data
+ */
+template<typename T>
+class HalfbandResampler {
+    public:
+        /// Returns true if the rates can be converted with a halfband cascade
+        static bool isSupported(int fromRate, int toRate){
+            int f = factorOf(fromRate, toRate);
+            return f > 1 && stageCount(f) <= max_stages;
+        }
+
+        bool begin(int channels, int fromRate, int toRate, ResamplePrecision precision=Medium, int blockFrames=256){
+            if (channels <= 0 || !isSupported(fromRate, toRate)){
+                LOGE("Unsupported conversion from %d to %d", fromRate, toRate);
+                return false;
+            }
+            this->channels = channels;
+            this->block_frames = blockFrames;
+            decimate = fromRate > toRate;
+            total_factor = factorOf(fromRate, toRate);
+
+            int half_length;
+            float beta;
+            switch(precision){
+                case Low: half_length = 4; beta = 5.0f; break;
+                case High: half_length = 16; beta = 8.5f; break;
+                case VeryHigh: half_length = 24; beta = 10.0f; break;
+                default: half_length = 8; beta = 7.0f; break;
+            }
+
+            // factors in processing order
+            int factors[max_stages];
+            stage_count = 0;
+            int rest = total_factor;
+            while (rest % 2 == 0){ factors[stage_count++] = 2; rest /= 2; }
+            while (rest % 3 == 0){ factors[stage_count++] = 3; rest /= 3; }
+            if (!decimate){
+                for (int j = 0; j < stage_count / 2; j++){
+                    int tmp = factors[j];
+                    factors[j] = factors[stage_count - 1 - j];
+                    factors[stage_count - 1 - j] = tmp;
+                }
+            }
+
+            // setup the stages and determine the size of the intermediate buffers:
+            // the transition band is only narrow in the stage at the lowest rate,
+            // so all other stages can be much shorter
+            size_t frames = blockFrames;
+            size_t max_frames = 0;
+            int narrow_stage = decimate ? stage_count - 1 : 0;
+            for (int j = 0; j < stage_count; j++){
+                int len = j == narrow_stage ? half_length : max(3, half_length / 2);
+                if (!stages[j].begin(channels, factors[j], decimate, len, beta, frames)) return false;
+                frames = stages[j].maxOutputFrames(frames);
+                if (j < stage_count - 1) max_frames = max(max_frames, frames);
+            }
+            buffer[0].resize(max_frames * channels);
+            buffer[1].resize(max_frames * channels);
+            LOGI("HalfbandResampler: %s by %d with %d stages", decimate ? "decimation" : "interpolation", total_factor, stage_count);
+            return true;
+        }
+
+        /// Max number of output frames for the indicated input frames
+        size_t maxOutputFrames(size_t inFrames) {
+            return decimate ? inFrames / total_factor + 1 : inFrames * total_factor;
+        }
+
+        /// Resamples the interleaved frames: returns the number of output frames
+        size_t process(const T *in, size_t frames, T *out){
+            size_t result = 0;
+            while (frames > 0){
+                size_t len = min(frames, block_frames);
+                result += processBlock(in, len, out + result * channels);
+                in += len * channels;
+                frames -= len;
+            }
+            return result;
+        }
+
+        /// Resampling factor
+        int factor() { return total_factor; }
+
+        /// Returns true if we reduce the sample rate
+        bool isDecimation() { return decimate; }
+
+    protected:
+        static const int max_stages = 6;
+        HalfbandStage<T> stages[max_stages];
+        Vector<T> buffer[2];
+        int stage_count = 0;
+        int channels = 0;
+        int total_factor = 1;
+        size_t block_frames = 0;
+        bool decimate = true;
+
+        /// Integer factor between the rates or 0 if there is none
+        static int factorOf(int fromRate, int toRate){
+            if (fromRate <= 0 || toRate <= 0) return 0;
+            int high = max(fromRate, toRate);
+            int low = min(fromRate, toRate);
+            return high % low == 0 ? high / low : 0;
+        }
+
+        /// Number of stages for the factor or a big number if it is not a product of 2 and 3
+        static int stageCount(int factor){
+            int result = 0;
+            while (factor % 2 == 0){ factor /= 2; result++; }
+            while (factor % 3 == 0){ factor /= 3; result++; }
+            return factor == 1 ? result : max_stages + 1;
+        }
+
+        size_t processBlock(const T *in, size_t frames, T *out){
+            const T *src = in;
+            for (int j = 0; j < stage_count; j++){
+                T *target = j == stage_count - 1 ? out : buffer[j % 2].data();
+                frames = stages[j].process(src, frames, target);
+                src = target;
+            }
+            return frames;
+        }
+};
+
+/**
+ * @brief Stream which changes the sample rate with the HalfbandResampler: it
+ * supports the resampling on write and on read.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T data type of audio data
+ */
+template<typename T>
+class HalfbandResampleStream : public AudioStreamX {
+    public:
+        HalfbandResampleStream() = default;
+
+        HalfbandResampleStream(Print &out){
+            setOut(out);
+        }
+
+        HalfbandResampleStream(Stream &in){
+            setIn(in);
+        }
+
+        void setOut(Print &out){
+            p_out = &out;
+        }
+
+        void setIn(Stream &in){
+            p_out = &in;
+            p_in = &in;
+        }
+
+        bool begin(int channels, int fromRate, int toRate, ResamplePrecision precision=Medium){
+            this->channels = channels;
+            int block_frames = max(DEFAULT_BUFFER_SIZE / (int)sizeof(T) / channels, 1);
+            if (!resampler.begin(channels, fromRate, toRate, precision, block_frames)) return false;
+            buffer.resize(max((size_t)block_frames, resampler.maxOutputFrames(block_frames)) * channels);
+            pending.resize(resampler.maxOutputFrames(resampler.factor()) * channels);
+            pending_frames = 0;
+            pending_pos = 0;
+            reader.begin(sizeof(T) * channels);
+            return true;
+        }
+
+        int availableForWrite() override { 
+            if (p_out == nullptr) return 0;
+            int result = p_out->availableForWrite();
+            return resampler.isDecimation() ? result * resampler.factor() : result / resampler.factor();
+        }
+
+        /// Writes the resampled data to the final destination
+        size_t write(const uint8_t *src, size_t byte_count) override {
+            if (p_out == nullptr) return 0;
+            size_t frame_bytes = sizeof(T) * channels;
+            size_t frames = byte_count / frame_bytes;
+            size_t block = resampler.isDecimation() ? buffer.size() / channels : buffer.size() / channels / resampler.factor();
+            const T *in = (const T*) src;
+            for (size_t done = 0; done < frames; done += block){
+                size_t len = min(block, frames - done);
+                size_t out_frames = resampler.process(in + done * channels, len, buffer.data());
+                p_out->write((uint8_t*)buffer.data(), out_frames * frame_bytes);
+            }
+            return frames * frame_bytes;
+        }
+
+        int available() override { return p_in != nullptr ? p_in->available() : 0; }
+
+        /// Reads the resampled data: we provide max the requested frames. If less
+        /// frames are requested than the resampler provides for a single input
+        /// frame, we keep the remaining ones for the next call.
+        size_t readBytes(uint8_t *data, size_t byte_count) override {
+            if (p_in == nullptr) return 0;
+            size_t frame_bytes = sizeof(T) * channels;
+            size_t frames = byte_count / frame_bytes;
+            T *out = (T*) data;
+            size_t result = readPending(out, frames);
+            size_t open = frames - result;
+            if (open == 0) return result * frame_bytes;
+            // input frames for which the result fits into the open frames
+            size_t factor = resampler.factor();
+            size_t in_frames = resampler.isDecimation() ? (open - 1) * factor : open / factor;
+            bool is_direct = in_frames > 0;
+            if (!is_direct) in_frames = resampler.isDecimation() ? factor : 1;
+            in_frames = min(in_frames, (size_t)(buffer.size() / channels));
+            size_t read = reader.read(*p_in, (uint8_t*)buffer.data(), in_frames);
+            if (is_direct){
+                result += resampler.process(buffer.data(), read, out + result * channels);
+            } else {
+                pending_frames = resampler.process(buffer.data(), read, pending.data());
+                pending_pos = 0;
+                result += readPending(out + result * channels, open);
+            }
+            return result * frame_bytes;
+        }
+
+    protected:
+        HalfbandResampler<T> resampler;
+        FrameReader reader;
+        Print *p_out = nullptr;
+        Stream *p_in = nullptr;
+        Vector<T> buffer;
+        // resampled frames which did not fit into the last read
+        Vector<T> pending;
+        size_t pending_frames = 0;
+        size_t pending_pos = 0;
+        int channels = 2;
+
+        size_t readPending(T *out, size_t frames){
+            size_t result = min(frames, pending_frames - pending_pos);
+            memcpy(out, pending.data() + pending_pos * channels, result * channels * sizeof(T));
+            pending_pos += result;
+            return result;
+        }
+};
+
 /**
  * @brief Configuration for ResampleStream
  * @author Phil Schatzmann
@@ -435,6 +1315,8 @@ class ResampleParameterEstimator {
 struct ResampleConfig : public AudioBaseInfo {
     int sample_rate_from=0;
     int skip_every_nth=0; // small scale resampling
+    bool use_polyphase=true; // polyphase windowed sinc, otherwise up and downsampling
+    bool use_halfband=true; // halfband cascade for integer factors of 2 and 3
 
     void logInfo(){
         if (skip_every_nth!=0){
@@ -449,7 +1331,11 @@ struct ResampleConfig : public AudioBaseInfo {
 
 /**
  * @brief Flexible Stream class which can be used to resample audio data between
- * different sample rates.
+ * different sample rates. Integer factors of 2 and 3 (e.g. 48000 -> 8000) are
+ * converted with the HalfbandResampler, all other ratios with the
+ * PolyphaseResampler: the ResamplePrecision defines the quality and the cost.
+ * If use_polyphase is false in the ResampleConfig we combine an up- and a
+ * downsampler.
  * @author Phil Schatzmann
  * @copyright GPLv3
  * @tparam T data type of audio data
@@ -466,6 +1352,8 @@ class ResampleStream : public AudioStreamX {
          */
         ResampleStream(Print &out, ResamplePrecision precision = Medium){
             this->precision = precision;
+            p_out = &out;
+            halfband.setOut(out);
             up.setOut(down); // we upsample first
             down.setOut(out); // so that we can downsample to the requested rate
         }
@@ -479,6 +1367,9 @@ class ResampleStream : public AudioStreamX {
          */
         ResampleStream(Stream &in, ResamplePrecision precision = Medium){
             this->precision = precision;
+            p_out = &in;
+            p_in = &in;
+            halfband.setIn(in);
             up.setIn(down); // we upsample first
             down.setIn(in); // so that we can downsample to the requested rate
         }
@@ -510,6 +1401,8 @@ class ResampleStream : public AudioStreamX {
                 LOGE("channels are not defined")
                 return false;
             }
+            is_polyphase = false;
+            is_halfband = false;
             if (cfg.skip_every_nth!=0){
                 // small scale resampling
                 if (up.begin(cfg.channels, 1.0, UPSAMPLE)){
@@ -528,6 +1421,13 @@ class ResampleStream : public AudioStreamX {
                     LOGE("to_rate is not defined")
                     return false;
                 }
+                if (cfg.use_polyphase && cfg.use_halfband && HalfbandResampler<T>::isSupported(cfg.sample_rate_from, cfg.sample_rate)){
+                    is_halfband = halfband.begin(cfg.channels, cfg.sample_rate_from, cfg.sample_rate, precision);
+                    return is_halfband;
+                }
+                if (cfg.use_polyphase && cfg.sample_rate_from!=cfg.sample_rate){
+                    return beginPolyphase();
+                }
                 // calculate up and downsample rates
                 calc.begin(cfg.sample_rate_from, cfg.sample_rate, precision);
 
@@ -550,18 +1450,31 @@ class ResampleStream : public AudioStreamX {
         }
 
         /// Determines the number of bytes which are available for write 
-        int availableForWrite() override { return up.availableForWrite(); }
+        int availableForWrite() override { 
+            if (is_halfband) return halfband.availableForWrite();
+            if (is_polyphase){
+                if (p_out==nullptr) return 0;
+                return static_cast<int64_t>(p_out->availableForWrite()) * polyphase.downFactor() / polyphase.upFactor();
+            }
+            return up.availableForWrite(); 
+        }
 
         /// Writes the data up or downsampled to the final destination
         size_t write(const uint8_t *src, size_t byte_count) override {
-            return up.write(src, byte_count);
+            if (is_halfband) return halfband.write(src, byte_count);
+            return is_polyphase ? writePolyphase(src, byte_count) : up.write(src, byte_count);
         }
         /// Determines the available bytes from the final source stream 
-        int available() override { return up.available(); }
+        int available() override { 
+            if (is_halfband) return halfband.available();
+            if (is_polyphase) return p_in!=nullptr ? p_in->available() : 0;
+            return up.available(); 
+        }
 
         /// Reads the up/downsampled bytes
         size_t readBytes(uint8_t *src, size_t byte_count) override { 
-            return up.readBytes(src, byte_count);
+            if (is_halfband) return halfband.readBytes(src, byte_count);
+            return is_polyphase ? readPolyphase(src, byte_count) : up.readBytes(src, byte_count);
         }
 
         float resampleFactor() {
@@ -575,7 +1488,256 @@ class ResampleStream : public AudioStreamX {
         Resample<T> down;
         ResamplePrecision precision;
         float factor;
+        Print *p_out = nullptr;
+        Stream *p_in = nullptr;
+        PolyphaseResampler<T> polyphase;
+        HalfbandResampleStream<T> halfband;
+        FrameReader reader;
+        // input buffer for reading, output buffer for writing
+        Vector<T> buffer;
+        size_t block_frames = 0;
+        bool is_polyphase = false;
+        bool is_halfband = false;
+
+        bool beginPolyphase() {
+            block_frames = max(DEFAULT_BUFFER_SIZE / (int)sizeof(T) / cfg.channels, 1);
+            if (!polyphase.begin(cfg.channels, cfg.sample_rate_from, cfg.sample_rate, precision, block_frames)){
+                return false;
+            }
+            size_t frames = max(block_frames, polyphase.maxOutputFrames(block_frames));
+            buffer.resize(frames * cfg.channels);
+            reader.begin(sizeof(T) * cfg.channels);
+            is_polyphase = true;
+            return true;
+        }
+
+        size_t writePolyphase(const uint8_t *src, size_t byte_count) {
+            if (p_out==nullptr) return 0;
+            size_t frame_bytes = sizeof(T) * cfg.channels;
+            size_t frames = byte_count / frame_bytes;
+            size_t buffer_frames = buffer.size() / cfg.channels;
+            const T *in = (const T*) src;
+            size_t done = 0;
+            while (done < frames){
+                done += polyphase.addInput(in + done * cfg.channels, frames - done);
+                size_t out_frames;
+                while ((out_frames = polyphase.output(buffer.data(), buffer_frames)) > 0){
+                    p_out->write((uint8_t*)buffer.data(), out_frames * frame_bytes);
+                }
+            }
+            return done * frame_bytes;
+        }
+
+        size_t readPolyphase(uint8_t *data, size_t byte_count) {
+            if (p_in==nullptr) return 0;
+            size_t frame_bytes = sizeof(T) * cfg.channels;
+            size_t frames = byte_count / frame_bytes;
+            T *out = (T*) data;
+            size_t result = polyphase.output(out, frames);
+            if (result < frames){
+                size_t in_frames = polyphase.inputFramesFor(frames - result);
+                in_frames = min(in_frames, polyphase.inputCapacity());
+                in_frames = min(in_frames, (size_t)(buffer.size() / cfg.channels));
+                size_t read = reader.read(*p_in, (uint8_t*)buffer.data(), in_frames);
+                polyphase.addInput(buffer.data(), read);
+                result += polyphase.output(out + result * cfg.channels, frames - result);
+            }
+            return result * frame_bytes;
+        }
+
+};
+
+/**
+ * @brief Configuration for AdaptiveResampleStream
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct AdaptiveResampleConfig : public AudioBaseInfo {
+    /// target fill level of the receive buffer in bytes: 0 uses the level after the settle time
+    int buffer_target = 0;
+    /// time after the first write before we determine the target and start to adjust
+    int settle_ms = 3000;
+    /// interval in which we update the ratio
+    int update_ms = 100;
+    /// time constant of the low pass filter for the measured fill level
+    int smoothing_ms = 5000;
+    /// max correction in ppm
+    float max_ppm = 1000.0f;
+    /// proportional gain: ppm for a deviation of 100% of the target (the defaults fit a target of about 1 second)
+    float kp = 10000.0f;
+    /// integral gain: ppm per second for a deviation of 100% of the target
+    float ki = 25.0f;
+    ResamplePrecision precision = Medium;
+};
+
+/**
+ * @brief Compensates the clock drift between a sender and a receiver which
+ * use their own crystals: we watch the fill level of the receive buffer
+ * (the available() of the receive stream) and continuously adjust the
+ * resampling ratio in ppm with a PI controller, so that the buffer stays at
+ * its target depth. The integral part is the estimated drift.
+ *
+ * AdaptiveResampleStream<int16_t> adaptive(kit, receiver);
+ * EncodedAudioStream decoder(&adaptive, new AACDecoderHelix());
+ *
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T data type of audio data
+ */
+template<typename T>
+class AdaptiveResampleStream : public AudioStreamX {
+    public:
+        /// Constructor: the resampled data is written to out; receiveStream provides the fill level
+        AdaptiveResampleStream(Print &out, Stream &receiveStream){
+            p_out = &out;
+            p_receive = &receiveStream;
+        }
+
+        AdaptiveResampleConfig defaultConfig() {
+            AdaptiveResampleConfig cfg;
+            return cfg;
+        }
+
+        bool begin(AdaptiveResampleConfig config){
+            cfg = config;
+            return begin();
+        }
+
+        bool begin() override {
+            if (cfg.channels<=0){
+                LOGE("channels are not defined");
+                return false;
+            }
+            int block_frames = max(DEFAULT_BUFFER_SIZE / (int)sizeof(T) / cfg.channels, 1);
+            if (!polyphase.beginRatio(cfg.channels, resolution, resolution, cfg.precision, block_frames)){
+                return false;
+            }
+            // some reserve for the max correction
+            buffer.resize((polyphase.maxOutputFrames(block_frames) + 2) * cfg.channels);
+            ppm = 0.0f;
+            drift_ppm = 0.0f;
+            target = cfg.buffer_target;
+            level = 0.0f;
+            level_sum = 0;
+            level_count = 0;
+            start_ms = 0;
+            last_update_ms = 0;
+            is_active = true;
+            return true;
+        }
+
+        void end() override {
+            is_active = false;
+        }
 
+        /// Restarts the processing with the new channels
+        void setAudioInfo(AudioBaseInfo info) override {
+            AudioStream::setAudioInfo(info);
+            cfg.sample_rate = info.sample_rate;
+            cfg.channels = info.channels;
+            cfg.bits_per_sample = info.bits_per_sample;
+            begin();
+        }
+
+        int availableForWrite() override { return p_out->availableForWrite(); }
+
+        /// Resamples the data with the actual ratio and writes it to the output
+        size_t write(const uint8_t *src, size_t byte_count) override {
+            if (!is_active) return 0;
+            updateRatio();
+            size_t frame_bytes = sizeof(T) * cfg.channels;
+            size_t frames = byte_count / frame_bytes;
+            size_t buffer_frames = buffer.size() / cfg.channels;
+            const T *in = (const T*) src;
+            size_t done = 0;
+            while (done < frames){
+                done += polyphase.addInput(in + done * cfg.channels, frames - done);
+                size_t out_frames;
+                while ((out_frames = polyphase.output(buffer.data(), buffer_frames)) > 0){
+                    p_out->write((uint8_t*)buffer.data(), out_frames * frame_bytes);
+                }
+            }
+            return done * frame_bytes;
+        }
+
+        /// Estimated drift of the sender compared to the receiver in ppm: positive if the sender is faster
+        float driftPPM() { return drift_ppm; }
+
+        /// Actual correction in ppm
+        float correctionPPM() { return ppm; }
+
+        /// Target fill level of the receive buffer in bytes: 0 until it is determined
+        int bufferTarget() { return target; }
+
+        /// Smoothed fill level of the receive buffer in bytes
+        float bufferLevel() { return level; }
+
+    protected:
+        // resolution of the ratio: about 1 ppm
+        static const int resolution = 1 << 20;
+        AdaptiveResampleConfig cfg;
+        Print *p_out = nullptr;
+        Stream *p_receive = nullptr;
+        PolyphaseResampler<T> polyphase;
+        Vector<T> buffer;
+        float ppm = 0.0f;
+        float drift_ppm = 0.0f;
+        float level = 0.0f;
+        int target = 0;
+        int64_t level_sum = 0;
+        int level_count = 0;
+        uint32_t start_ms = 0;
+        uint32_t last_update_ms = 0;
+        bool is_active = false;
+
+        /// Time in ms which drives the controller: can be replaced e.g. for a simulation
+        virtual uint32_t currentTimeMs() { return millis(); }
+
+        /// Measures the fill level and updates the ratio in the update interval
+        void updateRatio() {
+            uint32_t now = currentTimeMs();
+            if (start_ms == 0){
+                start_ms = now == 0 ? 1 : now;
+                last_update_ms = now;
+            }
+            level_sum += p_receive->available();
+            level_count++;
+            uint32_t dt_ms = now - last_update_ms;
+            if (dt_ms < (uint32_t)cfg.update_ms) return;
+
+            // low pass filter of the average level of the interval
+            float actual = static_cast<float>(level_sum) / level_count;
+            level_sum = 0;
+            level_count = 0;
+            last_update_ms = now;
+            if (level == 0.0f) {
+                level = actual;
+            } else {
+                float alpha = cfg.smoothing_ms > 0 ? min(1.0f, static_cast<float>(dt_ms) / cfg.smoothing_ms) : 1.0f;
+                level += alpha * (actual - level);
+            }
+
+            if (now - start_ms < (uint32_t)cfg.settle_ms) return;
+            if (target <= 0){
+                target = max(static_cast<int>(level), 1);
+                LOGI("buffer target: %d", target);
+            }
+
+            // PI controller: a growing buffer means that the sender is faster
+            float error = (level - target) / target;
+            drift_ppm += cfg.ki * error * dt_ms / 1000.0f;
+            drift_ppm = clip(drift_ppm);
+            ppm = clip(drift_ppm + cfg.kp * error);
+            int down = resolution + static_cast<int>(lroundf(ppm * resolution / 1000000.0f));
+            polyphase.setDownFactor(down);
+            LOGD("level: %f, target: %d, drift: %f ppm, correction: %f ppm", level, target, drift_ppm, ppm);
+        }
+
+        float clip(float value) {
+            if (value > cfg.max_ppm) return cfg.max_ppm;
+            if (value < -cfg.max_ppm) return -cfg.max_ppm;
+            return value;
+        }
 };
 
 /**
@@ -0,0 +1,330 @@
+#pragma once
+#include "AudioConfig.h"
+#include "AudioBasic/Int24.h"
+#include "AudioTools/AudioLogger.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Properties of the supported sample types which are used by the
+ * SampleFormatConverter: integer samples are converted via a Q31 value, so
+ * that the scaling between the integer types is a simple shift. Float
+ * samples are in the range of -1.0 to 1.0. The acc_t type is used to sum up
+ * the values if we reduce the number of channels.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+template <typename T>
+struct SampleFormat;
+
+template <>
+struct SampleFormat<int8_t> {
+  typedef int32_t acc_t;
+  static acc_t value(int8_t v) { return v; }
+  static int8_t sample(acc_t v) { return v; }
+  static int32_t toQ31(int8_t v) { return (int32_t)v * (1 << 24); }
+  static int8_t fromQ31(int32_t v) { return v >> 24; }
+  static float toFloat(int8_t v) { return v * (1.0f / 128.0f); }
+  static int8_t fromFloat(float v) {
+    float result = v * 128.0f;
+    if (result >= 127.0f) return INT8_MAX;
+    if (result <= -128.0f) return INT8_MIN;
+    return result;
+  }
+};
+
+template <>
+struct SampleFormat<int16_t> {
+  typedef int32_t acc_t;
+  static acc_t value(int16_t v) { return v; }
+  static int16_t sample(acc_t v) { return v; }
+  static int32_t toQ31(int16_t v) { return (int32_t)v * (1 << 16); }
+  static int16_t fromQ31(int32_t v) { return v >> 16; }
+  static float toFloat(int16_t v) { return v * (1.0f / 32768.0f); }
+  static int16_t fromFloat(float v) {
+    float result = v * 32768.0f;
+    if (result >= 32767.0f) return INT16_MAX;
+    if (result <= -32768.0f) return INT16_MIN;
+    return result;
+  }
+};
+
+template <>
+struct SampleFormat<int24_t> {
+  typedef int64_t acc_t;
+  static acc_t value(int24_t v) { return v.toInt(); }
+  static int24_t sample(acc_t v) { return int24_t((int32_t)v); }
+  static int32_t toQ31(int24_t v) { return v.toInt() * (1 << 8); }
+  static int24_t fromQ31(int32_t v) { return int24_t((int32_t)(v >> 8)); }
+  static float toFloat(int24_t v) { return v.toInt() * (1.0f / 8388608.0f); }
+  static int24_t fromFloat(float v) {
+    float result = v * 8388608.0f;
+    if (result >= 8388607.0f) return int24_t((int32_t)INT24_MAX);
+    if (result <= -8388608.0f) return int24_t((int32_t)(-INT24_MAX - 1));
+    return int24_t((int32_t)result);
+  }
+};
+
+template <>
+struct SampleFormat<int32_t> {
+  typedef int64_t acc_t;
+  static acc_t value(int32_t v) { return v; }
+  static int32_t sample(acc_t v) { return v; }
+  static int32_t toQ31(int32_t v) { return v; }
+  static int32_t fromQ31(int32_t v) { return v; }
+  static float toFloat(int32_t v) { return v * (1.0f / 2147483648.0f); }
+  static int32_t fromFloat(float v) {
+    float result = v * 2147483648.0f;
+    // 2147483647 can not be represented as float
+    if (result >= 2147483648.0f) return INT32_MAX;
+    if (result <= -2147483648.0f) return INT32_MIN;
+    return result;
+  }
+};
+
+template <>
+struct SampleFormat<float> {
+  typedef float acc_t;
+  static acc_t value(float v) { return v; }
+  static float sample(acc_t v) { return v; }
+};
+
+/// Conversion of a single sample: integers are scaled with a shift
+template <typename From, typename To>
+struct SampleConversion {
+  static To convert(From v) {
+    return SampleFormat<To>::fromQ31(SampleFormat<From>::toQ31(v));
+  }
+};
+
+template <typename From>
+struct SampleConversion<From, float> {
+  static float convert(From v) { return SampleFormat<From>::toFloat(v); }
+};
+
+template <typename To>
+struct SampleConversion<float, To> {
+  static To convert(float v) { return SampleFormat<To>::fromFloat(v); }
+};
+
+template <>
+struct SampleConversion<float, float> {
+  static float convert(float v) { return v; }
+};
+
+/**
+ * @brief Converts the sample type and the number of channels of interleaved
+ * PCM data in one pass: we provide a fused kernel for each combination of
+ * int8_t, int16_t, int24_t, int32_t and float samples with special versions
+ * for mono to stereo and stereo to mono and a generic one for N channels.
+ * The kernel is selected in begin(), so that the conversion itself is a
+ * simple loop which can be vectorized by the compiler.
+ *
+ * If we reduce the number of channels, the first channels are copied and the
+ * remaining ones are averaged into the last target channel. If we increase
+ * the number of channels, the last source channel is repeated.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SampleFormatConverter {
+ public:
+  SampleFormatConverter() = default;
+
+  /// Selects the kernel for the indicated bits per sample (8, 16, 24 or 32)
+  /// and channels
+  bool begin(int fromBits, int fromChannels, int toBits, int toChannels) {
+    if (!setChannels(fromChannels, toChannels)) return false;
+    bool result = false;
+    switch (fromBits) {
+      case 8:
+        result = selectTarget<int8_t>(toBits);
+        break;
+      case 16:
+        result = selectTarget<int16_t>(toBits);
+        break;
+      case 24:
+        result = selectTarget<int24_t>(toBits);
+        break;
+      case 32:
+        result = selectTarget<int32_t>(toBits);
+        break;
+    }
+    if (!result) {
+      LOGE("bit combination not supported %d -> %d", fromBits, toBits);
+      p_kernel = nullptr;
+    }
+    return result;
+  }
+
+  /// Selects the kernel for the indicated sample types: e.g. to convert
+  /// from or to float
+  template <typename From, typename To>
+  bool begin(int fromChannels, int toChannels) {
+    if (!setChannels(fromChannels, toChannels)) return false;
+    return selectKernel<From, To>();
+  }
+
+  /// Selects the kernel which converts integer samples with the indicated
+  /// bits per sample to float
+  bool beginToFloat(int fromBits, int channels = 1) {
+    switch (fromBits) {
+      case 8:
+        return begin<int8_t, float>(channels, channels);
+      case 16:
+        return begin<int16_t, float>(channels, channels);
+      case 24:
+        return begin<int24_t, float>(channels, channels);
+      case 32:
+        return begin<int32_t, float>(channels, channels);
+    }
+    LOGE("Unsupported bits_per_sample: %d", fromBits);
+    p_kernel = nullptr;
+    return false;
+  }
+
+  /// Selects the kernel which converts float samples to integer samples with
+  /// the indicated bits per sample
+  bool beginFromFloat(int toBits, int channels = 1) {
+    switch (toBits) {
+      case 8:
+        return begin<float, int8_t>(channels, channels);
+      case 16:
+        return begin<float, int16_t>(channels, channels);
+      case 24:
+        return begin<float, int24_t>(channels, channels);
+      case 32:
+        return begin<float, int32_t>(channels, channels);
+    }
+    LOGE("Unsupported bits_per_sample: %d", toBits);
+    p_kernel = nullptr;
+    return false;
+  }
+
+  /// Converts the full frames of the input data: returns the number of
+  /// bytes which were written to out
+  size_t convert(const uint8_t *in, size_t inBytes, uint8_t *out) {
+    if (p_kernel == nullptr) return 0;
+    size_t frames = inBytes / inputFrameSize();
+    (this->*p_kernel)(in, out, frames);
+    return frames * outputFrameSize();
+  }
+
+  /// Number of bytes which are needed for the result of inBytes
+  size_t resultSize(size_t inBytes) {
+    return inBytes / inputFrameSize() * outputFrameSize();
+  }
+
+  /// Number of bytes of an input frame
+  int inputFrameSize() { return from_sample_size * from_channels; }
+
+  /// Number of bytes of an output frame
+  int outputFrameSize() { return to_sample_size * to_channels; }
+
+  /// Returns true if a kernel has been selected
+  bool isValid() { return p_kernel != nullptr; }
+
+ protected:
+  typedef void (SampleFormatConverter::*Kernel)(const uint8_t *in,
+                                                uint8_t *out, size_t frames);
+  Kernel p_kernel = nullptr;
+  int from_channels = 1;
+  int to_channels = 1;
+  int from_sample_size = 2;
+  int to_sample_size = 2;
+
+  bool setChannels(int fromChannels, int toChannels) {
+    if (fromChannels <= 0 || toChannels <= 0) {
+      LOGE("Invalid channels: %d -> %d", fromChannels, toChannels);
+      p_kernel = nullptr;
+      return false;
+    }
+    from_channels = fromChannels;
+    to_channels = toChannels;
+    return true;
+  }
+
+  template <typename From>
+  bool selectTarget(int toBits) {
+    switch (toBits) {
+      case 8:
+        return selectKernel<From, int8_t>();
+      case 16:
+        return selectKernel<From, int16_t>();
+      case 24:
+        return selectKernel<From, int24_t>();
+      case 32:
+        return selectKernel<From, int32_t>();
+    }
+    return false;
+  }
+
+  template <typename From, typename To>
+  bool selectKernel() {
+    from_sample_size = sizeof(From);
+    to_sample_size = sizeof(To);
+    if (from_channels == to_channels) {
+      p_kernel = &SampleFormatConverter::convertSamples<From, To>;
+    } else if (from_channels == 1 && to_channels == 2) {
+      p_kernel = &SampleFormatConverter::convertFrames<From, To, 1, 2>;
+    } else if (from_channels == 2 && to_channels == 1) {
+      p_kernel = &SampleFormatConverter::convertFrames<From, To, 2, 1>;
+    } else {
+      p_kernel = &SampleFormatConverter::convertFrames<From, To, 0, 0>;
+    }
+    return true;
+  }
+
+  /// Kernel for an unchanged number of channels
+  template <typename From, typename To>
+  void convertSamples(const uint8_t *in, uint8_t *out, size_t frames) {
+    const From *src = (const From *)in;
+    To *dst = (To *)out;
+    size_t count = frames * from_channels;
+    for (size_t j = 0; j < count; j++) {
+      dst[j] = SampleConversion<From, To>::convert(src[j]);
+    }
+  }
+
+  /// Kernel which changes the number of channels: FROM_CH and TO_CH are the
+  /// number of channels or 0 for N channels
+  template <typename From, typename To, int FROM_CH, int TO_CH>
+  void convertFrames(const uint8_t *in, uint8_t *out, size_t frames) {
+    typedef typename SampleFormat<From>::acc_t acc_t;
+    const From *src = (const From *)in;
+    To *dst = (To *)out;
+    const int from_ch = FROM_CH == 0 ? from_channels : FROM_CH;
+    const int to_ch = TO_CH == 0 ? to_channels : TO_CH;
+    if (to_ch < from_ch) {
+      // copy the first to_ch-1 channels and average the remaining ones
+      const int reduce_div = from_ch - to_ch + 1;
+      for (size_t f = 0; f < frames; f++) {
+        for (int ch = 0; ch < to_ch - 1; ch++) {
+          dst[ch] = SampleConversion<From, To>::convert(src[ch]);
+        }
+        acc_t total = 0;
+        for (int ch = to_ch - 1; ch < from_ch; ch++) {
+          total += SampleFormat<From>::value(src[ch]);
+        }
+        From value = SampleFormat<From>::sample(total / reduce_div);
+        dst[to_ch - 1] = SampleConversion<From, To>::convert(value);
+        src += from_ch;
+        dst += to_ch;
+      }
+    } else {
+      // copy the available channels and repeat the last one
+      for (size_t f = 0; f < frames; f++) {
+        To value = dst[0] = SampleConversion<From, To>::convert(src[0]);
+        for (int ch = 1; ch < from_ch; ch++) {
+          value = dst[ch] = SampleConversion<From, To>::convert(src[ch]);
+        }
+        for (int ch = from_ch; ch < to_ch; ch++) {
+          dst[ch] = value;
+        }
+        src += from_ch;
+        dst += to_ch;
+      }
+    }
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,116 @@
+// Simulates a sender with a known clock drift which fills the receive buffer
+// while the receiver outputs the data from the AdaptiveResampleStream with its
+// own clock. We use a virtual time, so that we can cover one hour: after the
+// settle time the estimated drift must be close to the real one and the fill
+// level must stay close to its target.
+#include "Arduino.h"
+#include "AudioTools.h"
+
+const int sample_rate = 8000;
+const int chunk_bytes = 512;         // data which is decoded at a time
+const uint32_t step_ms = 10;         // resolution of the simulation
+const uint32_t duration_ms = 3600000;
+const uint32_t settled_ms = 1800000; // we check the results after this time
+
+/// Receive buffer which only records its fill level
+class ReceiveBuffer : public Stream {
+ public:
+  int available() override { return level; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override { return 0; }
+  int level = 0;
+};
+
+/// Output with the clock of the receiver which counts the frames
+class FrameCounter : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    frames += len / sizeof(int16_t);
+    return len;
+  }
+  uint64_t frames = 0;
+};
+
+/// AdaptiveResampleStream which is driven by the virtual time
+class SimulatedResampleStream : public AdaptiveResampleStream<int16_t> {
+ public:
+  SimulatedResampleStream(Print &out, Stream &in)
+      : AdaptiveResampleStream<int16_t>(out, in) {}
+  uint32_t now_ms = 1;
+
+ protected:
+  uint32_t currentTimeMs() override { return now_ms; }
+};
+
+bool simulate(float drift_ppm) {
+  ReceiveBuffer receive;
+  FrameCounter out;
+  SimulatedResampleStream adaptive(out, receive);
+  auto cfg = adaptive.defaultConfig();
+  cfg.sample_rate = sample_rate;
+  cfg.channels = 1;
+  cfg.bits_per_sample = 16;
+  adaptive.begin(cfg);
+
+  // start with 1 second of data
+  receive.level = sample_rate * sizeof(int16_t);
+  int16_t data[chunk_bytes / sizeof(int16_t)] = {0};
+  double sender_rate = sample_rate * (1.0 + drift_ppm / 1000000.0);
+  uint64_t sent_frames = 0;
+  int max_deviation = 0;
+  bool ok = true;
+
+  for (uint32_t t = step_ms; t <= duration_ms && ok; t += step_ms) {
+    adaptive.now_ms = t;
+    // the sender fills the receive buffer
+    uint64_t frames = sender_rate * t / 1000.0;
+    receive.level += (frames - sent_frames) * sizeof(int16_t);
+    sent_frames = frames;
+    // the receiver decodes until its output is satisfied
+    uint64_t needed = (uint64_t)sample_rate * t / 1000;
+    while (out.frames < needed) {
+      if (receive.level < chunk_bytes) {
+        Serial.println("Buffer underflow");
+        ok = false;
+        break;
+      }
+      receive.level -= chunk_bytes;
+      adaptive.write((const uint8_t *)data, chunk_bytes);
+    }
+    if (t >= settled_ms) {
+      int deviation = abs(receive.level - adaptive.bufferTarget());
+      if (deviation > max_deviation) max_deviation = deviation;
+    }
+  }
+
+  float error = adaptive.driftPPM() - drift_ppm;
+  Serial.print("drift: ");
+  Serial.print(drift_ppm);
+  Serial.print(" ppm - estimated: ");
+  Serial.print(adaptive.driftPPM());
+  Serial.print(" ppm - target: ");
+  Serial.print(adaptive.bufferTarget());
+  Serial.print(" - max deviation: ");
+  Serial.println(max_deviation);
+  if (fabs(error) > 1.0f) {
+    Serial.println("Invalid drift estimate");
+    ok = false;
+  }
+  // the level may deviate by the decoded chunk and the filter delay
+  if (adaptive.bufferTarget() <= 0 || max_deviation > 2 * chunk_bytes) {
+    Serial.println("Buffer level out of bounds");
+    ok = false;
+  }
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = simulate(100.0f) && simulate(-80.0f) && simulate(0.0f);
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
@@ -0,0 +1,124 @@
+// Executes the processing chains of the test sketches (w/o PortAudio) and
+// verifies that they do not allocate any heap memory after the warm-up
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioTools/AudioPipeline.h"
+#include "AudioTools/AllocationAudit.h"
+
+AudioBaseInfo cfg;
+float coef[] = {0.021, 0.096, 0.146, 0.096, 0.021};
+SineWaveGenerator<int16_t> sine(32000);
+GeneratedSoundStream<int16_t> sound(sine);
+NullStream out;
+AllocationAudit audit;
+
+// generator: sine -> reducer -> out
+void auditGenerator() {
+  ChannelReducer<int16_t> reducer(1, cfg.channels);
+  StreamCopy copier(out, sound);
+  audit.check("generator", [&]() { copier.copy(reducer); });
+}
+
+// effects: sine -> adsr -> out
+void auditEffects() {
+  ADSRGain adsr(0.0001, 0.0001, 0.9, 0.0002);
+  AudioEffects<SineWaveGenerator<int16_t>> effects(sine);
+  GeneratedSoundStream<int16_t> in(effects);
+  effects.addEffect(adsr);
+  effects.begin(cfg);
+  in.begin(cfg);
+  adsr.keyOn();
+  StreamCopy copier(out, in);
+  audit.check("effects", [&]() { copier.copy(); });
+}
+
+// filter: sine -> fir -> out
+void auditFilter() {
+  FilteredStream<int16_t, float> filtered(sound, cfg.channels);
+  filtered.setFilter(0, new FIR<float>(coef));
+  filtered.setFilter(1, new FIR<float>(coef));
+  StreamCopy copier(out, filtered, 1012);
+  audit.check("filter", [&]() { copier.copy(); });
+}
+
+// resample: sine -> resample -> out
+void auditResample() {
+  ResampleStream<int16_t> resample(out);
+  resample.begin(cfg.channels, cfg.sample_rate, cfg.sample_rate * 2);
+  StreamCopy copier(resample, sound, 1012);
+  audit.check("resample", [&]() { copier.copy(); });
+}
+
+// volume: sine -> volume -> out
+void auditVolume() {
+  VolumeStream volume(out);
+  volume.begin(cfg);
+  volume.setVolume(0.5);
+  StreamCopy copier(volume, sound);
+  audit.check("volume", [&]() { copier.copy(); });
+}
+
+// converter: sine -> 32 bits mono -> out
+void auditConverter() {
+  FormatConverterStream converter(out);
+  AudioBaseInfo to = cfg;
+  to.channels = 1;
+  to.bits_per_sample = 32;
+  converter.begin(cfg, to);
+  StreamCopy copier(converter, sound);
+  audit.check("format-converter", [&]() { copier.copy(); });
+}
+
+// filter-wav: sine -> fir -> wav encoder -> out
+void auditEncoder() {
+  FilteredStream<int16_t, float> filtered(sound, cfg.channels);
+  filtered.setFilter(1, new FIR<float>(coef));
+  WAVEncoder wav;
+  EncodedAudioStream encoded(&out, &wav);
+  encoded.begin(cfg);
+  StreamCopy copier(encoded, filtered);
+  audit.check("filter-wav", [&]() { copier.copy(); });
+}
+
+// pipeline: sine -> queue -> volume -> out executed alternately in one task
+void auditPipeline() {
+  PipelineQueue queue(16 * 1024);
+  VolumeStream volume(out);
+  volume.begin(cfg);
+  volume.setVolume(0.5);
+  StreamCopy generate(queue, sound, 1024);
+  StreamCopy play(volume, queue, 1024);
+  audit.check("pipeline", [&]() {
+    generate.copy();
+    play.copy();
+  });
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+
+  cfg = sine.defaultConfig();
+  cfg.sample_rate = 44100;
+  cfg.channels = 2;
+  cfg.bits_per_sample = 16;
+  sine.begin(cfg, N_B4);
+  sound.begin();
+
+  auditGenerator();
+  auditEffects();
+  auditFilter();
+  auditResample();
+  auditVolume();
+  auditConverter();
+  auditEncoder();
+  auditPipeline();
+
+  Serial.print(audit.failedCount());
+  Serial.print(" of ");
+  Serial.print(audit.checkCount());
+  Serial.println(" audits failed");
+  exit(audit.failedCount() == 0 ? 0 : 1);
+}
+
+void loop() {}
@@ -0,0 +1,166 @@
+// Simple benchmark harness for the audio processing classes: each benchmark
+// is executed repeatedly for a minimum time and we report ns/sample and MB/s.
+// On x86 we also report cycles/sample (measured with the time stamp counter).
+// The results are printed and written as json so that they can be compared
+// between commits (see compare.py)
+#pragma once
+#include "Arduino.h"
+#include "AudioTools.h"
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef BENCHMARK_MIN_TIME_MS
+#define BENCHMARK_MIN_TIME_MS 200
+#endif
+
+namespace audio_tools {
+
+/// Result of a single benchmark
+struct BenchmarkResult {
+  const char *name;
+  double ns_per_sample;
+  double mb_per_sec;
+  double cycles_per_sample;
+  uint64_t samples;
+  uint64_t bytes;
+};
+
+/// Stream which discards the written data and provides the read data w/o
+/// any processing: the cost should be close to 0
+class BenchmarkSink : public AudioStreamX {
+ public:
+  size_t write(const uint8_t *data, size_t len) override { return len; }
+  size_t readBytes(uint8_t *data, size_t len) override { return len; }
+  int available() override { return DEFAULT_BUFFER_SIZE; }
+  int availableForWrite() override { return DEFAULT_BUFFER_SIZE; }
+};
+
+/// Endless source of a 16 bit sine wave which is copied from a table
+class BenchmarkSource : public AudioStreamX {
+ public:
+  BenchmarkSource() {
+    for (int j = 0; j < table_len; j++) {
+      table[j] = 16000 * sin(2.0 * PI * j / table_len);
+    }
+  }
+  size_t readBytes(uint8_t *data, size_t len) override {
+    size_t result = 0;
+    const uint8_t *src = (const uint8_t *)table;
+    while (result < len) {
+      size_t n = min(len - result, sizeof(table) - pos);
+      memcpy(data + result, src + pos, n);
+      result += n;
+      pos = (pos + n) % sizeof(table);
+    }
+    return len;
+  }
+  int available() override { return DEFAULT_BUFFER_SIZE; }
+
+ protected:
+  static const int table_len = 1000;
+  int16_t table[table_len];
+  size_t pos = 0;
+};
+
+/// Executes the benchmarks and collects the results
+class Benchmark {
+ public:
+  Benchmark(const char *suite) { this->suite = suite; }
+
+  /// Calls func repeatedly: each call processes bytesPerCall bytes with
+  /// bytesPerSample bytes per (single channel) sample
+  template <typename F>
+  BenchmarkResult &run(const char *name, size_t bytesPerCall,
+                       int bytesPerSample, F func) {
+    // warm up
+    func();
+    uint64_t calls = 0;
+    uint64_t start_cycles = cycles();
+    unsigned long start = micros();
+    unsigned long elapsed = 0;
+    while (elapsed < BENCHMARK_MIN_TIME_MS * 1000ul) {
+      for (int j = 0; j < 10; j++) func();
+      calls += 10;
+      elapsed = micros() - start;
+    }
+    uint64_t elapsed_cycles = cycles() - start_cycles;
+    BenchmarkResult result;
+    result.name = name;
+    result.bytes = calls * bytesPerCall;
+    result.samples = result.bytes / bytesPerSample;
+    result.ns_per_sample = 1000.0 * elapsed / result.samples;
+    result.mb_per_sec = (double)result.bytes / elapsed;
+    result.cycles_per_sample = (double)elapsed_cycles / result.samples;
+    results.push_back(result);
+    print(result);
+    return results[results.size() - 1];
+  }
+
+  /// Prints the result as a table row
+  void print(BenchmarkResult &r) {
+    char msg[160];
+    int len = snprintf(msg, sizeof(msg), "%-40s %10.2f ns/sample %10.2f MB/s",
+                       r.name, r.ns_per_sample, r.mb_per_sec);
+    if (r.cycles_per_sample > 0) {
+      snprintf(msg + len, sizeof(msg) - len, " %10.1f cycles/sample",
+               r.cycles_per_sample);
+    }
+    Serial.println(msg);
+  }
+
+  /// Writes all results as json: the file name can be defined with the
+  /// environment variable BENCHMARK_JSON, the commit with GIT_COMMIT
+  bool writeJson(const char *defaultPath = "benchmarks.json") {
+    const char *path = getenv("BENCHMARK_JSON");
+    if (path == nullptr) path = defaultPath;
+    const char *commit = getenv("GIT_COMMIT");
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+      LOGE("Could not open %s", path);
+      return false;
+    }
+    fprintf(file, "{\n  \"suite\": \"%s\",\n  \"commit\": \"%s\",\n", suite,
+            commit == nullptr ? "" : commit);
+    fprintf(file, "  \"results\": [\n");
+    for (int j = 0; j < results.size(); j++) {
+      BenchmarkResult &r = results[j];
+      fprintf(file,
+              "    {\"name\": \"%s\", \"ns_per_sample\": %.3f, \"mb_per_sec\": "
+              "%.3f, \"cycles_per_sample\": %.3f, \"samples\": %llu}%s\n",
+              r.name, r.ns_per_sample, r.mb_per_sec, r.cycles_per_sample,
+              (unsigned long long)r.samples,
+              j < results.size() - 1 ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    Serial.print("Results written to ");
+    Serial.println(path);
+    return true;
+  }
+
+  /// Provides the result with the indicated name
+  BenchmarkResult *result(const char *name) {
+    for (int j = 0; j < results.size(); j++) {
+      if (strcmp(results[j].name, name) == 0) return &results[j];
+    }
+    return nullptr;
+  }
+
+ protected:
+  const char *suite;
+
+  /// Cycle counter of the cpu (time stamp counter on x86): 0 if not available
+  static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+  }
+  Vector<BenchmarkResult> results;
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,81 @@
+// Compares the per element readArray/writeArray with the bulk memcpy implementation
+#include "Arduino.h"
+#include "AudioTools.h"
+
+const int buffer_size = 100 * 1024;   // same as the ESP-NOW receive buffer
+const int packet_size = 250;          // ESP-NOW payload
+const long total_bytes = 200l * 1024l * 1024l;
+RingBuffer<uint8_t> ring(buffer_size);
+uint8_t packet[packet_size];
+
+// writes and reads total_bytes in packets: returns bytes/sec
+template <bool bulk>
+double measure(BaseBuffer<uint8_t> &buffer) {
+  buffer.reset();
+  unsigned long start = micros();
+  long processed = 0;
+  while (processed < total_bytes) {
+    // fill up half of the buffer
+    while (buffer.availableForWrite() >= packet_size && buffer.available() < buffer_size / 2) {
+      bulk ? buffer.writeArray(packet, packet_size)
+           : buffer.BaseBuffer<uint8_t>::writeArray(packet, packet_size);
+    }
+    // and drain it again
+    while (buffer.available() > 0) {
+      int len = bulk ? buffer.readArray(packet, packet_size)
+                     : buffer.BaseBuffer<uint8_t>::readArray(packet, packet_size);
+      processed += len;
+    }
+  }
+  unsigned long run_time_us = micros() - start;
+  return run_time_us == 0 ? 0 : 1000000.0 * processed / run_time_us;
+}
+
+// uses the zero copy span api to move the data
+double measureSpan(BaseBuffer<uint8_t> &buffer) {
+  buffer.reset();
+  unsigned long start = micros();
+  long processed = 0;
+  int len = 0;
+  while (processed < total_bytes) {
+    while (buffer.available() < buffer_size / 2) {
+      uint8_t *data = buffer.writeSpan(len);
+      if (data == nullptr) break;
+      len = MIN(len, packet_size);
+      memset(data, processed, len);
+      buffer.commitWrite(len);
+    }
+    uint8_t *data = buffer.peekSpan(len);
+    while (data != nullptr) {
+      processed += buffer.commitRead(len);
+      data = buffer.peekSpan(len);
+    }
+  }
+  unsigned long run_time_us = micros() - start;
+  return run_time_us == 0 ? 0 : 1000000.0 * processed / run_time_us;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  for (int j = 0; j < packet_size; j++) packet[j] = j;
+
+  double per_element = measure<false>(ring);
+  double bulk = measure<true>(ring);
+  double span = measureSpan(ring);
+
+  Serial.print("RingBuffer per element: ");
+  Serial.print(per_element / 1000000.0);
+  Serial.println(" MB/s");
+  Serial.print("RingBuffer bulk: ");
+  Serial.print(bulk / 1000000.0);
+  Serial.println(" MB/s");
+  Serial.print("RingBuffer span: ");
+  Serial.print(span / 1000000.0);
+  Serial.println(" MB/s");
+  Serial.print("Gain bulk: ");
+  Serial.print(per_element > 0 ? bulk / per_element : 0.0);
+  Serial.println("x");
+}
+
+void loop() { stop(); }
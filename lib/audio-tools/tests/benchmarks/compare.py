@@ -0,0 +1,37 @@
+#!/usr/bin/env python3
+# Compares two benchmark json files: python3 compare.py base.json new.json [threshold_percent]
+# Returns 1 if any benchmark got slower by more then the threshold (default 10%)
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {r["name"]: r for r in json.load(f)["results"]}
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("usage: compare.py base.json new.json [threshold_percent]")
+        return 2
+    base = load(sys.argv[1])
+    new = load(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 10.0
+    regressions = 0
+    for name, result in new.items():
+        if name not in base:
+            print(f"{name:45} new: {result['ns_per_sample']:.2f} ns/sample")
+            continue
+        old_ns = base[name]["ns_per_sample"]
+        new_ns = result["ns_per_sample"]
+        change = 100.0 * (new_ns - old_ns) / old_ns if old_ns > 0 else 0.0
+        flag = ""
+        if change > threshold:
+            flag = "  <-- REGRESSION"
+            regressions += 1
+        print(f"{name:45} {old_ns:10.2f} -> {new_ns:10.2f} ns/sample {change:+7.1f}%{flag}")
+    return 1 if regressions > 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
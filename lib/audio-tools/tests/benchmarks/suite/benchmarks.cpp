@@ -0,0 +1,468 @@
+// Measures ns/sample and MB/s of the classes in the sample hot path and
+// writes the results to benchmarks.json
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioLibs/AudioRealFFT.h"
+#include "AudioLibs/AudioFFTConvolution.h"
+#include "../Benchmark.h"
+
+const int channels = 2;
+const int buffer_bytes = 1024;
+const int sample_rate = 44100;
+Benchmark benchmark("audio-tools");
+BenchmarkSource source;
+BenchmarkSink sink;
+uint8_t data[buffer_bytes];
+uint8_t result[buffer_bytes * 4];
+AudioBaseInfo info;
+
+void benchmarkBuffers() {
+  RingBuffer<int16_t> ring(buffer_bytes);
+  benchmark.run("RingBuffer", buffer_bytes, 2, [&]() {
+    ring.writeArray((int16_t *)data, buffer_bytes / 2);
+    ring.readArray((int16_t *)result, buffer_bytes / 2);
+  });
+
+  NBuffer<int16_t> nbuffer(buffer_bytes / 2, 4);
+  benchmark.run("NBuffer", buffer_bytes, 2, [&]() {
+    nbuffer.writeArray((int16_t *)data, buffer_bytes / 2);
+    nbuffer.readArray((int16_t *)result, buffer_bytes / 2);
+  });
+}
+
+void benchmarkStreamCopy() {
+  StreamCopy copier(sink, source, buffer_bytes);
+  benchmark.run("StreamCopy", buffer_bytes, 2, [&]() { copier.copy(); });
+}
+
+// float implementation of the VolumeStream before the fixed point kernels
+void volumeFloatReference(int16_t *samples, size_t size, float *factors,
+                          int channels) {
+  const float max_value = 32767;
+  for (size_t j = 0; j < size; j++) {
+    float result = factors[j % channels] * samples[j];
+    if (result > max_value) result = max_value;
+    if (result < -max_value) result = -max_value;
+    samples[j] = static_cast<int16_t>(result);
+  }
+}
+
+void benchmarkVolume(const char *name, int bits, int channels) {
+  VolumeStream volume(sink);
+  AudioBaseInfo cfg = info;
+  cfg.bits_per_sample = bits;
+  cfg.channels = channels;
+  volume.begin(cfg);
+  volume.setVolume(0.5);
+  benchmark.run(name, buffer_bytes, bits / 8,
+                [&]() { volume.write(data, buffer_bytes); });
+}
+
+void benchmarkVolumeStream() {
+  float factors[] = {0.5, 0.5};
+  benchmark.run("VolumeStream float (reference)", buffer_bytes, 2, [&]() {
+    volumeFloatReference((int16_t *)data, buffer_bytes / 2, factors, 2);
+  });
+  benchmarkVolume("VolumeStream", 16, 2);
+  benchmarkVolume("VolumeStream 16 bit mono", 16, 1);
+  benchmarkVolume("VolumeStream 16 bit 6 channels", 16, 6);
+  benchmarkVolume("VolumeStream 24 bit stereo", 24, 2);
+  benchmarkVolume("VolumeStream 32 bit stereo", 32, 2);
+}
+
+void benchmarkResampleStream() {
+  ResampleStream<int16_t> up(sink);
+  up.begin(channels, 22050, 44100);
+  benchmark.run("ResampleStream 22050->44100", buffer_bytes, 2,
+                [&]() { up.write(data, buffer_bytes); });
+
+  ResampleStream<int16_t> down(sink);
+  down.begin(channels, 44100, 22050);
+  benchmark.run("ResampleStream 44100->22050", buffer_bytes, 2,
+                [&]() { down.write(data, buffer_bytes); });
+
+  // arbitrary ratio with the different presets
+  static const char *names[] = {"ResampleStream 44100->48000 Low",
+                                "ResampleStream 44100->48000 Medium",
+                                "ResampleStream 44100->48000 High",
+                                "ResampleStream 44100->48000 VeryHigh"};
+  for (int precision = Low; precision <= VeryHigh; precision++) {
+    ResampleStream<int16_t> resample(sink, (ResamplePrecision)precision);
+    resample.begin(channels, 44100, 48000);
+    benchmark.run(names[precision], buffer_bytes, 2,
+                  [&]() { resample.write(data, buffer_bytes); });
+  }
+  // integer factors: halfband cascade compared to the polyphase resampler
+  ResampleStream<int16_t> voice(sink);
+  voice.begin(channels, 48000, 8000);
+  benchmark.run("ResampleStream 48000->8000", buffer_bytes, 2,
+                [&]() { voice.write(data, buffer_bytes); });
+  ResampleStream<int16_t> voice_polyphase(sink);
+  ResampleConfig cfg = voice_polyphase.defaultConfig();
+  cfg.channels = channels;
+  cfg.sample_rate_from = 48000;
+  cfg.sample_rate = 8000;
+  cfg.use_halfband = false;
+  voice_polyphase.begin(cfg);
+  benchmark.run("ResampleStream 48000->8000 polyphase", buffer_bytes, 2,
+                [&]() { voice_polyphase.write(data, buffer_bytes); });
+  ResampleStream<int16_t> voice_up(sink);
+  voice_up.begin(channels, 8000, 48000);
+  benchmark.run("ResampleStream 8000->48000", buffer_bytes, 2,
+                [&]() { voice_up.write(data, buffer_bytes); });
+  cfg.sample_rate_from = 8000;
+  cfg.sample_rate = 48000;
+  voice_polyphase.begin(cfg);
+  benchmark.run("ResampleStream 8000->48000 polyphase", buffer_bytes, 2,
+                [&]() { voice_polyphase.write(data, buffer_bytes); });
+}
+
+void benchmarkConverters() {
+  FormatConverterStream format(sink);
+  AudioBaseInfo to = info;
+  to.bits_per_sample = 32;
+  format.begin(info, to);
+  benchmark.run("FormatConverterStream 16->32", buffer_bytes, 2,
+                [&]() { format.write(data, buffer_bytes); });
+
+  // bits and channels are converted in one pass
+  FormatConverterStream format_mono(sink);
+  to.channels = 1;
+  format_mono.begin(info, to);
+  benchmark.run("FormatConverterStream 16->32 2->1", buffer_bytes, 2,
+                [&]() { format_mono.write(data, buffer_bytes); });
+
+  NumberFormatConverterStream number(sink);
+  number.begin(16, 32);
+  benchmark.run("NumberFormatConverterStream 16->32", buffer_bytes, 2,
+                [&]() { number.write(data, buffer_bytes); });
+
+  ChannelFormatConverterStream mono_to_stereo(sink);
+  mono_to_stereo.begin(1, 2);
+  benchmark.run("ChannelFormatConverterStream 1->2", buffer_bytes, 2,
+                [&]() { mono_to_stereo.write(data, buffer_bytes); });
+
+  ChannelFormatConverterStream stereo_to_mono(sink);
+  stereo_to_mono.begin(2, 1);
+  benchmark.run("ChannelFormatConverterStream 2->1", buffer_bytes, 2,
+                [&]() { stereo_to_mono.write(data, buffer_bytes); });
+}
+
+void benchmarkMixers() {
+  BenchmarkSource source1, source2;
+  InputMixer<int16_t> input_mixer;
+  input_mixer.add(source1);
+  input_mixer.add(source2);
+  benchmark.run("InputMixer 2 inputs", buffer_bytes * 2, 2,
+                [&]() { input_mixer.readBytes(result, buffer_bytes); });
+
+  BenchmarkSource source3, source4;
+  InputMixer<int16_t> input_mixer4;
+  input_mixer4.add(source1);
+  input_mixer4.add(source2);
+  input_mixer4.add(source3, 0.5);
+  input_mixer4.add(source4, 0.5);
+  benchmark.run("InputMixer 4 inputs", buffer_bytes * 4, 2,
+                [&]() { input_mixer4.readBytes(result, buffer_bytes); });
+
+  OutputMixer<int16_t> output_mixer(sink, 2);
+  output_mixer.begin(buffer_bytes);
+  benchmark.run("OutputMixer 2 outputs", buffer_bytes * 2, 2, [&]() {
+    output_mixer.write(data, buffer_bytes);
+    output_mixer.write(data, buffer_bytes);
+  });
+}
+
+void benchmarkFilters() {
+  static float coef[] = {0.021, 0.096, 0.146, 0.096, 0.021};
+  FilteredStream<int16_t, float> filtered(sink, channels);
+  filtered.setFilter(0, new FIR<float>(coef));
+  filtered.setFilter(1, new FIR<float>(coef));
+  benchmark.run("FilteredStream FIR 5 taps", buffer_bytes, 2, [&]() {
+    memcpy(result, data, buffer_bytes);
+    filtered.write(result, buffer_bytes);
+  });
+
+  static float coef64[64];
+  for (int j = 0; j < 64; j++) coef64[j] = 1.0f / 64;
+  FilteredStream<int16_t, float> filtered64(sink, channels);
+  filtered64.setFilter(0, new FIR<float>(coef64));
+  filtered64.setFilter(1, new FIR<float>(coef64));
+  benchmark.run("FilteredStream FIR 64 taps", buffer_bytes, 2, [&]() {
+    memcpy(result, data, buffer_bytes);
+    filtered64.write(result, buffer_bytes);
+  });
+
+  static float b[3] = {0.2, 0.3, 0.2};
+  static float a[3] = {1.0, -0.5, 0.2};
+  FilteredStream<int16_t, float> biquad(sink, channels);
+  biquad.setFilter(0, new BiQuadDF2<float>(b, a));
+  biquad.setFilter(1, new BiQuadDF2<float>(b, a));
+  benchmark.run("FilteredStream BiQuadDF2", buffer_bytes, 2, [&]() {
+    memcpy(result, data, buffer_bytes);
+    biquad.write(result, buffer_bytes);
+  });
+
+  Equilizer3Bands eq(sink);
+  ConfigEquilizer3Bands cfg_eq;
+  cfg_eq.channels = channels;
+  cfg_eq.sample_rate = sample_rate;
+  cfg_eq.gain_low = 0.5;
+  cfg_eq.gain_medium = 0.8;
+  cfg_eq.gain_high = 1.0;
+  eq.begin(cfg_eq);
+  benchmark.run("Equilizer3Bands", buffer_bytes, 2, [&]() {
+    memcpy(result, data, buffer_bytes);
+    eq.write(result, buffer_bytes);
+  });
+
+  // 10 bands: the budget for 48 kHz stereo on an ESP32 core
+  ParametricEqualizer peq(sink);
+  ConfigParametricEqualizer cfg_peq = peq.defaultConfig();
+  cfg_peq.channels = channels;
+  cfg_peq.sample_rate = 48000;
+  peq.begin(cfg_peq);
+  static const float freq[10] = {31,  62,   125,  250,  500,
+                                 1000, 2000, 4000, 8000, 16000};
+  for (int j = 0; j < 10; j++) {
+    peq.setBand(j, j == 0 ? EQLowShelf : j == 9 ? EQHighShelf : EQPeaking,
+                freq[j], j % 2 == 0 ? 3.0 : -3.0, 1.0);
+  }
+  benchmark.run("ParametricEqualizer 10 bands", buffer_bytes, 2, [&]() {
+    memcpy(result, data, buffer_bytes);
+    peq.write(result, buffer_bytes);
+  });
+}
+
+// level metering as it is used on every sink
+void benchmarkMetering() {
+  VolumePrint meter;
+  LevelMeterConfig cfg = meter.defaultConfig();
+  cfg.channels = channels;
+  cfg.sample_rate = sample_rate;
+  meter.begin(cfg);
+  benchmark.run("VolumePrint", buffer_bytes, 2,
+                [&]() { meter.write(data, buffer_bytes); });
+
+  VolumePrint peak_meter;
+  cfg.true_peak = false;
+  cfg.loudness = false;
+  peak_meter.begin(cfg);
+  benchmark.run("VolumePrint peak+rms", buffer_bytes, 2,
+                [&]() { peak_meter.write(data, buffer_bytes); });
+}
+
+void setupEqualizer(ParametricEqualizer &eq, bool useFloat) {
+  ConfigParametricEqualizer cfg = eq.defaultConfig();
+  cfg.channels = channels;
+  cfg.sample_rate = sample_rate;
+  cfg.bits_per_sample = useFloat ? 32 : 16;
+  cfg.use_float = useFloat;
+  eq.begin(cfg);
+  eq.setBand(0, EQLowShelf, 100, 3.0);
+  eq.setBand(1, EQPeaking, 1000, -3.0);
+  eq.setBand(2, EQHighShelf, 8000, 3.0);
+}
+
+// receiver chain equalizer -> volume -> filter with 16 bit data and with float
+// data which is converted only at the ingress and egress
+void benchmarkPipelineModes() {
+  static float b[3] = {0.2, 0.3, 0.2};
+  static float a[3] = {1.0, -0.5, 0.2};
+
+  FilteredStream<int16_t, float> filter16(sink, channels);
+  filter16.setFilter(0, new BiQuadDF2<float>(b, a));
+  filter16.setFilter(1, new BiQuadDF2<float>(b, a));
+  VolumeStream volume16(filter16);
+  volume16.begin(info);
+  volume16.setVolume(0.5);
+  ParametricEqualizer eq16(volume16);
+  setupEqualizer(eq16, false);
+  benchmark.run("Pipeline int16 EQ+volume+filter", buffer_bytes, 2, [&]() {
+    memcpy(result, data, buffer_bytes);
+    eq16.write(result, buffer_bytes);
+  });
+
+  FloatFormatConverterStream egress(sink);
+  egress.begin(16, FloatToPCM);
+  FilteredStream<float, float> filter_float(egress, channels);
+  filter_float.setFilter(0, new BiQuadDF2<float>(b, a));
+  filter_float.setFilter(1, new BiQuadDF2<float>(b, a));
+  VolumeStream volume_float(filter_float);
+  VolumeStreamConfig cfg_volume = volume_float.defaultConfig();
+  cfg_volume.channels = channels;
+  cfg_volume.sample_rate = sample_rate;
+  cfg_volume.bits_per_sample = 32;
+  cfg_volume.use_float = true;
+  volume_float.begin(cfg_volume);
+  volume_float.setVolume(0.5);
+  ParametricEqualizer eq_float(volume_float);
+  setupEqualizer(eq_float, true);
+  FloatFormatConverterStream ingress(eq_float);
+  ingress.begin(16, PCMToFloat);
+  benchmark.run("Pipeline float EQ+volume+filter", buffer_bytes, 2,
+                [&]() { ingress.write(data, buffer_bytes); });
+}
+
+// direct FIR vs FFT convolution to determine the crossover point
+void benchmarkConvolution() {
+  static float ir[1024];
+  static char names[12][60];
+  int name_idx = 0;
+  for (int j = 0; j < 1024; j++) ir[j] = 1.0f / (j + 1);
+  for (int taps = 32; taps <= 1024; taps *= 2) {
+    FilteredStream<int16_t, float> fir(sink, channels);
+    FilteredStream<int16_t, float> conv(sink, channels);
+    for (int ch = 0; ch < channels; ch++) {
+      fir.setFilter(ch, FIR<float>::fromPointer(ir, taps));
+      conv.setFilter(ch, new FFTConvolution(new FFTDriverRealFFT(), ir, taps));
+    }
+    char *name = names[name_idx++];
+    snprintf(name, 60, "FIR %d taps", taps);
+    benchmark.run(name, buffer_bytes, 2, [&]() {
+      memcpy(result, data, buffer_bytes);
+      fir.write(result, buffer_bytes);
+    });
+    name = names[name_idx++];
+    snprintf(name, 60, "FFTConvolution %d taps", taps);
+    benchmark.run(name, buffer_bytes, 2, [&]() {
+      memcpy(result, data, buffer_bytes);
+      conv.write(result, buffer_bytes);
+    });
+  }
+}
+
+// prints the number of FFTs per second for the indicated hop size
+void printFFTsPerSecond(BenchmarkResult &result, int hop) {
+  double frames_per_sec = 1.0e9 / result.ns_per_sample / channels;
+  char msg[120];
+  snprintf(msg, sizeof(msg), "%-40s %10.0f FFTs/sec", result.name,
+           frames_per_sec / hop);
+  Serial.println(msg);
+}
+
+void benchmarkFFT() {
+  AudioRealFFT fft;
+  auto cfg = fft.defaultConfig();
+  cfg.length = 1024;
+  cfg.channels = channels;
+  cfg.sample_rate = sample_rate;
+  cfg.bits_per_sample = 16;
+  fft.begin(cfg);
+  BenchmarkResult &r1 = benchmark.run("AudioRealFFT 1024", buffer_bytes, 2,
+                                      [&]() { fft.write(data, buffer_bytes); });
+  printFFTsPerSecond(r1, 1024);
+
+  // 75% overlap with a window function
+  AudioRealFFT stft;
+  Hann hann;
+  cfg.window_function = &hann;
+  cfg.stride = 256;
+  stft.begin(cfg);
+  BenchmarkResult &r2 =
+      benchmark.run("AudioRealFFT 1024 hann stride 256", buffer_bytes, 2,
+                    [&]() { stft.write(data, buffer_bytes); });
+  printFFTsPerSecond(r2, 256);
+}
+
+template <class G>
+void benchmarkGenerator(const char *name, G &generator) {
+  generator.begin(info);
+  benchmark.run(name, buffer_bytes, 2,
+                [&]() { generator.readBytes(result, buffer_bytes); });
+}
+
+void benchmarkGenerators() {
+  SineWaveGenerator<int16_t> sine(16000);
+  sine.begin(info, 440);
+  benchmark.run("SineWaveGenerator", buffer_bytes, 2,
+                [&]() { sine.readBytes(result, buffer_bytes); });
+
+  SquareWaveGenerator<int16_t> square(16000);
+  square.begin(info, 440);
+  benchmark.run("SquareWaveGenerator", buffer_bytes, 2,
+                [&]() { square.readBytes(result, buffer_bytes); });
+
+  // 8 channels at 48 kHz rendered by the GeneratedSoundStream
+  AudioBaseInfo info8 = info;
+  info8.channels = 8;
+  info8.sample_rate = 48000;
+  SineWaveGenerator<int16_t> sine8(16000);
+  GeneratedSoundStream<int16_t> sine8_stream(sine8);
+  sine8_stream.begin(info8);
+  sine8.setFrequency(1000);
+  benchmark.run("SineWaveGenerator 8 channels", buffer_bytes, 2,
+                [&]() { sine8_stream.readBytes(result, buffer_bytes); });
+
+  SineFromTable<int16_t> table(16000);
+  table.begin(info, 440);
+  benchmark.run("SineFromTable", buffer_bytes, 2,
+                [&]() { table.readBytes(result, buffer_bytes); });
+
+  NoiseGenerator<int16_t> noise(16000);
+  benchmarkGenerator("NoiseGenerator", noise);
+
+  SilenceGenerator<int16_t> silence;
+  benchmarkGenerator("SilenceGenerator", silence);
+
+  GeneratorFixedValue<int16_t> fixed;
+  fixed.setValue(1000);
+  benchmarkGenerator("GeneratorFixedValue", fixed);
+
+  static int16_t array[] = {0, 1000, 2000, 1000, 0, -1000, -2000, -1000};
+  GeneratorFromArray<int16_t> from_array(array, 0, false);
+  benchmarkGenerator("GeneratorFromArray", from_array);
+
+  GeneratorFromStream<int16_t> from_stream(source);
+  benchmarkGenerator("GeneratorFromStream", from_stream);
+
+  TestGenerator<int16_t> test;
+  benchmarkGenerator("TestGenerator", test);
+
+  SineWaveGenerator<int16_t> sine1(16000), sine2(16000);
+  sine1.begin(info, 440);
+  sine2.begin(info, 880);
+  GeneratorMixer<int16_t> mixer;
+  mixer.add(sine1);
+  mixer.add(sine2);
+  benchmarkGenerator("GeneratorMixer 2 sines", mixer);
+
+  SineWaveGenerator<int16_t> sine3(16000);
+  sine3.begin(info, 440);
+  AudioEffects<SineWaveGenerator<int16_t>> effects(sine3);
+  Boost boost(0.8);
+  Distortion distortion(8000, 10000);
+  Tremolo tremolo(500, 50, sample_rate);
+  Delay delay(100, 30, sample_rate);
+  effects.addEffect(boost);
+  effects.addEffect(distortion);
+  effects.addEffect(tremolo);
+  effects.addEffect(delay);
+  benchmarkGenerator("AudioEffects 4 effects", effects);
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  info.channels = channels;
+  info.sample_rate = sample_rate;
+  info.bits_per_sample = 16;
+  source.readBytes(data, buffer_bytes);
+
+  benchmarkBuffers();
+  benchmarkStreamCopy();
+  benchmarkVolumeStream();
+  benchmarkResampleStream();
+  benchmarkConverters();
+  benchmarkMixers();
+  benchmarkFilters();
+  benchmarkPipelineModes();
+  benchmarkMetering();
+  benchmarkConvolution();
+  benchmarkFFT();
+  benchmarkGenerators();
+
+  benchmark.writeJson();
+}
+
+void loop() { stop(); }
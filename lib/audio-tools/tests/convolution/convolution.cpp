@@ -0,0 +1,96 @@
+// Compares the output of the FFTConvolution with the direct form FIR filter
+// for an impulse and for a random signal with the RealFFT and the KissFFT
+// driver and checks that a driver without inverse FFT passes the data through
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioLibs/AudioRealFFT.h"
+#include "AudioLibs/AudioKissFFT.h"
+#include "AudioLibs/AudioFFTConvolution.h"
+
+const int taps = 300;
+const int block_size = 64;
+const int samples = 4096;
+float ir[taps];
+float input[samples];
+float expected[samples];
+float actual[samples];
+
+// max difference of the convolution (delayed by its latency) to the FIR
+float maxError(FFTConvolution &conv, FIR<float> &fir) {
+  fir.processBlock(input, expected, samples);
+  conv.processBlock(input, actual, samples);
+  float result = 0.0f;
+  int latency = conv.latency();
+  for (int j = 0; j < samples - latency; j++) {
+    float diff = fabs(actual[j + latency] - expected[j]);
+    if (diff > result) result = diff;
+  }
+  return result;
+}
+
+/// Driver which does not support the inverse FFT
+class NoInverseDriver : public FFTDriver {
+ public:
+  void begin(int len) override {}
+  void end() override {}
+  void setValue(int pos, int value) override {}
+  void fft() override {}
+  float magnitude(int idx) override { return 0.0f; }
+  bool isValid() override { return true; }
+};
+
+FFTDriver *createDriver(bool isKiss) {
+  if (isKiss) return new FFTDriverKissFFT();
+  return new FFTDriverRealFFT();
+}
+
+bool test(const char *name, bool isImpulse, bool isKiss) {
+  for (int j = 0; j < samples; j++) {
+    input[j] = isImpulse ? (j == 10 ? 1.0f : 0.0f)
+                         : (rand() % 20001 - 10000) / 10000.0f;
+  }
+  FIR<float> *fir = FIR<float>::fromPointer(ir, taps);
+  FFTConvolution conv(createDriver(isKiss), ir, taps, block_size);
+  float error = maxError(conv, *fir);
+  delete fir;
+  bool ok = conv.isValid() && error < 1e-4f;
+  Serial.print(isKiss ? "kiss " : "real ");
+  Serial.print(name);
+  Serial.print(" - max error: ");
+  Serial.println(error, 8);
+  return ok;
+}
+
+// an invalid convolution (no inverse FFT or blockSize which is not a power
+// of 2) returns the input
+bool testPassThrough(const char *name, FFTDriver *driver, int blockSize) {
+  FFTConvolution conv(driver, ir, taps, blockSize);
+  for (int j = 0; j < samples; j++) input[j] = j;
+  conv.processBlock(input, actual, samples);
+  bool ok = !conv.isValid() && conv.latency() == 0 &&
+            memcmp(input, actual, sizeof(input)) == 0 &&
+            conv.process(1.5f) == 1.5f;
+  Serial.print(name);
+  Serial.print(" - pass through: ");
+  Serial.println(ok ? "ok" : "failed");
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  srand(1);
+  for (int j = 0; j < taps; j++) {
+    ir[j] = (rand() % 2001 - 1000) / 1000.0f / (1 + j / 10);
+  }
+  bool ok = true;
+  for (bool isKiss : {false, true}) {
+    ok = test("impulse", true, isKiss) && test("random", false, isKiss) && ok;
+  }
+  ok = testPassThrough("no inverse", new NoInverseDriver(), block_size) && ok;
+  ok = testPassThrough("block size 100", new FFTDriverRealFFT(), 100) && ok;
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
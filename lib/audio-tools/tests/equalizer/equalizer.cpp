@@ -0,0 +1,104 @@
+// Measures the frequency response of the ParametricEqualizer: the gain of a
+// peaking band at its center frequency must match the defined gain, no matter
+// if the band is defined before or after begin()
+#include "Arduino.h"
+#include "AudioTools.h"
+
+const int sample_rate = 48000;
+const int frames = sample_rate / 2;
+
+/// Measures the rms of the second channel after the settle time
+class RMSPrint : public Print {
+ public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *data, size_t len) override {
+    const int16_t *samples = (const int16_t *)data;
+    for (size_t j = 1; j < len / sizeof(int16_t); j += 2, frame++) {
+      if (frame > sample_rate / 10) {
+        sum += (double)samples[j] * samples[j];
+        count++;
+      }
+    }
+    return len;
+  }
+  float rms() { return count == 0 ? 0.0f : sqrt(sum / count); }
+
+ protected:
+  double sum = 0;
+  long count = 0;
+  long frame = 0;
+};
+
+/// Gain in dB of the equalizer for a sine with the indicated frequency
+float measure(ParametricEqualizer &eq, RMSPrint &out, float frequency) {
+  static int16_t data[2 * 256];
+  const float amplitude = 8000.0f;
+  for (int frame = 0; frame < frames;) {
+    for (int j = 0; j < 256; j++, frame++) {
+      int16_t value = amplitude * sin(2.0 * M_PI * frequency * frame / sample_rate);
+      data[2 * j] = value;
+      data[2 * j + 1] = value;
+    }
+    eq.write((uint8_t *)data, sizeof(data));
+  }
+  return 20.0f * log10f(out.rms() / (amplitude / sqrtf(2.0f)));
+}
+
+bool check(const char *name, float actual, float expected) {
+  bool ok = fabs(actual - expected) < 0.1f;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(actual, 2);
+  Serial.print(" dB expected: ");
+  Serial.println(expected, 2);
+  return ok;
+}
+
+// band defined before begin() with the config from defaultConfig()
+bool testBandBeforeBegin(float frequency, float expected) {
+  RMSPrint out;
+  ParametricEqualizer eq(out);
+  auto cfg = eq.defaultConfig();
+  cfg.sample_rate = sample_rate;
+  eq.setBand(0, EQPeaking, 1000, 6);
+  eq.begin(cfg);
+  return check("before begin", measure(eq, out, frequency), expected);
+}
+
+// band defined in the config
+bool testBandInConfig() {
+  RMSPrint out;
+  ParametricEqualizer eq(out);
+  auto cfg = eq.defaultConfig();
+  cfg.sample_rate = sample_rate;
+  cfg.bands[2].frequency = 1000;
+  cfg.bands[2].gain_db = 6;
+  cfg.bands[2].active = true;
+  eq.begin(cfg);
+  return check("config", measure(eq, out, 1000), 6.0f);
+}
+
+// band changed after begin(): the change is ramped
+bool testBandAfterBegin() {
+  RMSPrint out;
+  ParametricEqualizer eq(out);
+  auto cfg = eq.defaultConfig();
+  cfg.sample_rate = sample_rate;
+  eq.begin(cfg);
+  eq.setBand(0, EQPeaking, 1000, -6);
+  return check("after begin", measure(eq, out, 1000), -6.0f);
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = testBandBeforeBegin(1000, 6.0f);
+  // 2 octaves below the center frequency (RBJ peaking filter with q=0.707)
+  ok = testBandBeforeBegin(250, 0.78f) && ok;
+  ok = testBandInConfig() && ok;
+  ok = testBandAfterBegin() && ok;
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
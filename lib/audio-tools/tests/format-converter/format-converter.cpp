@@ -0,0 +1,135 @@
+// Converts data which is written and read in chunks that split the frames
+// (e.g. by ESP-NOW or UDP): every frame must arrive with the correct value
+#include "Arduino.h"
+#include "AudioTools.h"
+#include <vector>
+
+const int frames = 2000;
+const size_t chunks[] = {1023, 7, 1, 13, 998, 3, 1024};
+
+/// Collects the written data
+class Collector : public Print {
+ public:
+  std::vector<uint8_t> data;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t len) override {
+    data.insert(data.end(), buffer, buffer + len);
+    return len;
+  }
+};
+
+/// Provides the data in reads of max 7 bytes
+class ChunkedStream : public Stream {
+ public:
+  ChunkedStream(const uint8_t *data, size_t len) : p_data(data), size(len) {}
+  int available() override { return size - pos; }
+  int read() override { return pos < size ? p_data[pos++] : -1; }
+  int peek() override { return pos < size ? p_data[pos] : -1; }
+  size_t readBytes(uint8_t *buffer, size_t len) override {
+    len = min(len, min((size_t)7, size - pos));
+    memcpy(buffer, p_data + pos, len);
+    pos += len;
+    return len;
+  }
+  size_t write(uint8_t) override { return 0; }
+
+ protected:
+  const uint8_t *p_data;
+  size_t size;
+  size_t pos = 0;
+};
+
+void writeInChunks(Print &out, const uint8_t *data, size_t len) {
+  size_t pos = 0;
+  for (int j = 0; pos < len; j++) {
+    size_t n = min(chunks[j % 7], len - pos);
+    out.write(data + pos, n);
+    pos += n;
+  }
+}
+
+// requests which are smaller than a frame return 0
+size_t readInChunks(Stream &in, Stream &source, uint8_t *data, size_t len) {
+  size_t pos = 0;
+  for (int j = 0; pos < len; j++) {
+    size_t n = in.readBytes(data + pos, min(chunks[j % 7], len - pos));
+    if (n == 0 && source.available() == 0) break;
+    pos += n;
+  }
+  return pos;
+}
+
+bool report(const char *name, size_t count, size_t expectedCount,
+            int errors) {
+  bool ok = count == expectedCount && errors == 0;
+  Serial.print(name);
+  Serial.print(" - samples: ");
+  Serial.print((int)count);
+  Serial.print(" errors: ");
+  Serial.println(errors);
+  return ok;
+}
+
+// 24 bit samples in 32 bit containers to 16 bits
+bool testNumberFormat() {
+  static int32_t in[frames];
+  for (int j = 0; j < frames; j++) in[j] = (uint32_t)j * 2654435761u;
+  Collector out;
+  NumberFormatConverterStream conv(out);
+  conv.begin(24, 16);
+  writeInChunks(conv, (uint8_t *)in, sizeof(in));
+  int16_t *result = (int16_t *)out.data.data();
+  size_t count = out.data.size() / sizeof(int16_t);
+  int errors = 0;
+  for (size_t j = 0; j < count && j < frames; j++) {
+    if (result[j] != (int16_t)(in[j] >> 16)) errors++;
+  }
+  return report("number 24->16 write", count, frames, errors);
+}
+
+// 16 bit stereo to 32 bit mono on write and on read
+bool testFormat() {
+  static int16_t in[frames * 2];
+  for (int j = 0; j < frames; j++) {
+    in[2 * j] = j * 7;
+    in[2 * j + 1] = -j * 3;
+  }
+  AudioBaseInfo from, to;
+  from.channels = 2;
+  from.bits_per_sample = 16;
+  to.channels = 1;
+  to.bits_per_sample = 32;
+
+  Collector out;
+  FormatConverterStream conv_write(out);
+  conv_write.begin(from, to);
+  writeInChunks(conv_write, (uint8_t *)in, sizeof(in));
+
+  static int32_t result[frames];
+  ChunkedStream source((uint8_t *)in, sizeof(in));
+  FormatConverterStream conv_read(source);
+  conv_read.begin(from, to);
+  size_t read_count = readInChunks(conv_read, source, (uint8_t *)result, sizeof(result)) / sizeof(int32_t);
+
+  const int32_t *written = (const int32_t *)out.data.data();
+  size_t write_count = out.data.size() / sizeof(int32_t);
+  int write_errors = 0, read_errors = 0;
+  for (int j = 0; j < frames; j++) {
+    int32_t expected = ((in[2 * j] + in[2 * j + 1]) / 2) * 65536;
+    if (j < (int)write_count && written[j] != expected) write_errors++;
+    if (j < (int)read_count && result[j] != expected) read_errors++;
+  }
+  bool ok = report("format 16/2->32/1 write", write_count, frames, write_errors);
+  return report("format 16/2->32/1 read", read_count, frames, read_errors) && ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = testNumberFormat();
+  ok = testFormat() && ok;
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
@@ -0,0 +1,62 @@
+// Measures a 1 kHz sine with -20 dBFS on the left and -26 dBFS on the right
+// channel with the VolumePrint: the data is written in chunks which split the
+// frames, so that a misalignment would swap the channels
+#include "Arduino.h"
+#include "AudioTools.h"
+
+const int sample_rate = 48000;
+const float amplitude[2] = {0.1f, 0.05f};
+
+bool check(const char *name, float actual, float expected, float tolerance) {
+  bool ok = fabs(actual - expected) <= tolerance;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(actual, 3);
+  Serial.print(" expected: ");
+  Serial.println(expected, 3);
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  VolumePrint out;
+  auto cfg = out.defaultConfig();
+  cfg.sample_rate = sample_rate;
+  cfg.channels = 2;
+  cfg.bits_per_sample = 16;
+  out.begin(cfg);
+
+  // 4 seconds of data to fill the 3 s loudness window
+  static int16_t data[1024];
+  const int chunks[] = {7, 1, 13, 998, 3, 2048};
+  int frame = 0, chunk = 0;
+  while (frame < 4 * sample_rate) {
+    for (int j = 0; j < 512; j++, frame++) {
+      for (int ch = 0; ch < 2; ch++) {
+        data[2 * j + ch] = 32767.0f * amplitude[ch] * sin(2.0 * M_PI * 1000.0 * frame / sample_rate);
+      }
+    }
+    size_t pos = 0;
+    while (pos < sizeof(data)) {
+      size_t len = min((size_t)chunks[chunk++ % 6], sizeof(data) - pos);
+      out.write((uint8_t *)data + pos, len);
+      pos += len;
+    }
+  }
+
+  bool ok = true;
+  for (int ch = 0; ch < 2; ch++) {
+    float peak_db = 20.0f * log10f(amplitude[ch]);
+    ok = check("peak dBFS", LevelMeter::toDB(out.peak(ch)), peak_db, 0.1f) && ok;
+    ok = check("true peak dBFS", LevelMeter::toDB(out.truePeak(ch)), peak_db, 0.1f) && ok;
+    ok = check("rms dBFS", LevelMeter::toDB(out.rms(ch)), peak_db - 3.01f, 0.1f) && ok;
+  }
+  // K-weighting has a gain of +0.691 dB at 1 kHz which compensates the offset
+  float mean_square = (amplitude[0] * amplitude[0] + amplitude[1] * amplitude[1]) / 2.0f;
+  ok = check("loudness LUFS", out.loudness(), 10.0f * log10f(mean_square), 0.1f) && ok;
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
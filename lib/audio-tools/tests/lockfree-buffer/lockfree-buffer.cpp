@@ -0,0 +1,152 @@
+// Stress test for the LockFreeRingBuffer: a producer thread writes a counting
+// sequence which is verified by the consumer. We also check that the NBuffer
+// keeps the order of the blocks when its counters wrap around
+#include <thread>
+#include "Arduino.h"
+#include "AudioTools.h"
+
+const uint32_t total = 1000000;
+
+// rand() is not thread safe
+int randomLen(uint32_t &seed) {
+  seed = seed * 1103515245 + 12345;
+  return 1 + (seed >> 16) % 64;
+}
+
+// writes/reads packets of random size and checks the sequence
+bool test(OverflowPolicy policy) {
+  LockFreeRingBuffer<uint32_t> buffer(1000, policy);
+  bool ok = true;
+  uint32_t received = 0;
+
+  std::thread producer([&]() {
+    uint32_t data[64];
+    uint32_t next = 0;
+    uint32_t seed = 1;
+    uint32_t writes = 0;
+    while (next < total) {
+      int len = min((uint32_t)randomLen(seed), total - next);
+      // pace the producer: with DropOldest only every 100th write can overflow
+      if (policy == DropOldest && writes++ % 100 != 0) {
+        while (buffer.availableForWrite() < len) std::this_thread::yield();
+      }
+      for (int j = 0; j < len; j++) data[j] = next + j;
+      // with DropNewest we might not write all
+      int written = buffer.writeArray(data, len);
+      next += written;
+      if (written < len) std::this_thread::yield();
+    }
+  });
+
+  uint32_t data[64];
+  uint32_t seed = 2;
+  uint32_t last = 0;
+  bool first = true;
+  unsigned long timeout = millis() + 60000;
+  while (last + 1 < total && millis() < timeout) {
+    int len = buffer.readArray(data, randomLen(seed));
+    for (int j = 0; j < len; j++) {
+      // the sequence must be ascending: with DropOldest gaps are allowed
+      bool valid = policy == DropNewest ? (first ? data[j] == 0 : data[j] == last + 1)
+                                        : (first || data[j] > last);
+      if (!valid) {
+        Serial.print("Invalid sequence at ");
+        Serial.println(last);
+        ok = false;
+        break;
+      }
+      last = data[j];
+      first = false;
+      received++;
+    }
+    if (!ok) break;
+  }
+  producer.join();
+
+  Serial.print(policy == DropNewest ? "DropNewest" : "DropOldest");
+  Serial.print(" - received: ");
+  Serial.print(received);
+  Serial.print(" overflows: ");
+  Serial.print(buffer.overflowCount());
+  Serial.print(" dropped: ");
+  Serial.println(buffer.droppedCount());
+  // all data must have been checked or dropped: DropNewest retries the writes
+  uint32_t dropped = policy == DropOldest ? buffer.droppedCount() : 0;
+  if (received + dropped != total) {
+    Serial.println("Missing data");
+    ok = false;
+  }
+  // most of the data must have been checked
+  if (received < total * 9 / 10) {
+    Serial.println("Not enough data was checked");
+    ok = false;
+  }
+  return ok;
+}
+
+// spans are only provided if the producer can not overwrite them
+bool testSpan() {
+  uint32_t data[8] = {0};
+  int len = 0;
+  LockFreeRingBuffer<uint32_t> newest(16, DropNewest);
+  newest.writeArray(data, 8);
+  bool ok = newest.peekSpan(len) != nullptr && len == 8;
+  LockFreeRingBuffer<uint32_t> oldest(16, DropOldest);
+  oldest.writeArray(data, 8);
+  ok = ok && oldest.peekSpan(len) == nullptr && len == 0;
+  if (!ok) Serial.println("Invalid span");
+  return ok;
+}
+
+// only writes which really drop data are counted as overflow
+bool testOverflow() {
+  uint32_t data[16] = {0};
+  LockFreeRingBuffer<uint32_t> buffer(16, DropOldest);
+  buffer.writeArray(data, 16);
+  buffer.readArray(data, 8);
+  buffer.writeArray(data, 8);
+  bool ok = buffer.overflowCount() == 0 && buffer.droppedCount() == 0;
+  buffer.writeArray(data, 4);
+  ok = ok && buffer.overflowCount() == 1 && buffer.droppedCount() == 4;
+  if (!ok) Serial.println("Invalid overflow count");
+  return ok;
+}
+
+// NBuffer with 3 blocks which starts just before the wrap around of the counters
+class WrappingNBuffer : public NBuffer<uint32_t> {
+ public:
+  WrappingNBuffer() : NBuffer<uint32_t>(4, 3) {
+    setWriteCount(UINT32_MAX - 5);
+    setReadCount(UINT32_MAX - 5);
+  }
+};
+
+bool testNBufferWrap() {
+  WrappingNBuffer buffer;
+  uint32_t data[4];
+  uint32_t next = 0, expected = 0;
+  bool ok = true;
+  // the reader lags 2 blocks behind the writer
+  for (int j = 0; j < 20 && ok; j++) {
+    for (int i = 0; i < 4; i++) data[i] = next++;
+    ok = buffer.writeArray(data, 4) == 4;
+    if (j < 2) continue;
+    ok = ok && buffer.readArray(data, 4) == 4 && buffer.filledCount() == 2;
+    for (int i = 0; i < 4; i++) {
+      if (data[i] != expected++) ok = false;
+    }
+  }
+  if (!ok) Serial.println("Invalid NBuffer sequence");
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = testSpan() && testOverflow() && testNBufferWrap() && test(DropNewest) &&
+            test(DropOldest);
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
@@ -0,0 +1,71 @@
+// Measures the wake up latency of a StreamCopy which waits on the notifier of
+// the source compared to the polling with delay()
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioTools/AudioPipeline.h"
+#include <thread>
+
+const int count = 200;
+
+/// Determines the time between the write into the queue and the output
+class LatencyPrint : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    unsigned long now = micros();
+    for (size_t j = 0; j + sizeof(uint32_t) <= len; j += sizeof(uint32_t)) {
+      uint32_t start;
+      memcpy(&start, data + j, sizeof(start));
+      unsigned long latency = now - start;
+      total_us += latency;
+      if (latency > max_us) max_us = latency;
+      received++;
+    }
+    return len;
+  }
+  uint64_t total_us = 0;
+  unsigned long max_us = 0;
+  int received = 0;
+};
+
+unsigned long measure(bool notify) {
+  PipelineQueue queue(1024);
+  LatencyPrint out;
+  StreamCopyT<uint32_t> copier(out, queue, sizeof(uint32_t));
+  copier.setNotify(notify);
+  copier.setDelayOnNoData(10);
+
+  std::thread producer([&queue]() {
+    for (int j = 0; j < count; j++) {
+      delay(3);
+      uint32_t now = micros();
+      queue.write((const uint8_t *)&now, sizeof(now));
+    }
+  });
+  while (out.received < count) {
+    copier.copy();
+  }
+  producer.join();
+
+  unsigned long avg = out.total_us / count;
+  Serial.print(notify ? "notify: " : "delay: ");
+  Serial.print("avg latency us: ");
+  Serial.print(avg);
+  Serial.print(" - max latency us: ");
+  Serial.println(out.max_us);
+  return avg;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+
+  unsigned long with_notify = measure(true);
+  unsigned long with_delay = measure(false);
+  if (with_notify >= with_delay) {
+    Serial.println("Notification is not faster than polling");
+    exit(1);
+  }
+  stop();
+}
+
+void loop() {}
@@ -0,0 +1,80 @@
+// Runs a generator -> queue -> volume -> null output chain in 2 threads and
+// checks that all data which was queued has been processed and that the
+// pipeline ends w/o any error
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioTools/AudioPipeline.h"
+
+/// Counts the logged errors
+class ErrorCounter : public Stream {
+ public:
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t len) override {
+    for (size_t j = 0; j < len; j++) {
+      if (data[j] == '\n') lines++;
+    }
+    return Serial.write(data, len);
+  }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  int lines = 0;
+};
+
+uint16_t sample_rate = 44100;
+uint8_t channels = 2;
+SineWaveGenerator<int16_t> sine_wave(32000);
+GeneratedSoundStream<int16_t> sound(sine_wave);
+PipelineQueue queue(16 * 1024);
+NullStream out;
+VolumeStream volume(out);
+StreamCopy generate(queue, sound, 1024);   // stage 1: generator -> queue
+StreamCopy play(volume, queue, 1024);      // stage 2: queue -> volume -> out
+PipelineRunner pipeline;
+ErrorCounter errors;
+
+bool check(bool ok, const char *msg) {
+  if (!ok) {
+    Serial.print("Failed: ");
+    Serial.println(msg);
+  }
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(errors, AudioLogger::Error);
+
+  auto cfg = sine_wave.defaultConfig();
+  cfg.sample_rate = sample_rate;
+  cfg.channels = channels;
+  sine_wave.begin(cfg, N_B4);
+  sound.begin();
+  volume.begin(cfg);
+  volume.setVolume(0.5);
+  play.setDelayOnNoData(1);
+
+  pipeline.add("generate", generate);
+  pipeline.add("play", play);
+  pipeline.add(queue);
+  pipeline.begin();
+  delay(2000);
+  pipeline.end();
+  pipeline.printStatistics(Serial);
+
+  PipelineStage &first = pipeline.stage(0);
+  PipelineStage &second = pipeline.stage(1);
+  bool ok = check(first.processedBytes() > 0, "no data generated");
+  ok = check(first.processedBytes() ==
+                 second.processedBytes() + queue.depth(),
+             "data was lost") && ok;
+  ok = check(queue.maxDepth() <= queue.size(), "invalid queue depth") && ok;
+  ok = check(second.stallCount() <= second.stepCount(), "invalid stalls") && ok;
+  ok = check(first.busyPercent() > 0.0f && first.busyPercent() <= 100.0f,
+             "invalid busy time") && ok;
+  ok = check(errors.lines == 0, "errors were logged") && ok;
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
@@ -0,0 +1,81 @@
+// Checks the zero copy of the StreamCopy: it must be requested explicitly and
+// it must keep the semantics of the buffered copy
+#include "Arduino.h"
+#include "AudioTools.h"
+
+/// Source which pretends to have data but does not provide any
+class EmptySource : public AudioStream {
+ public:
+  int available() override { return 100; }
+  size_t readBytes(uint8_t *data, size_t len) override {
+    read_count++;
+    return 0;
+  }
+  size_t write(const uint8_t *data, size_t len) override { return 0; }
+  size_t write(uint8_t c) override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  int read_count = 0;
+};
+
+/// Sink which accepts only a few bytes at a time
+class SlowSink : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    len = min(len, (size_t)10);
+    for (size_t j = 0; j < len; j++) {
+      if (data[j] != (uint8_t)received++) is_valid = false;
+    }
+    return len;
+  }
+  int received = 0;
+  bool is_valid = true;
+};
+
+void fill(RingBufferStream &stream, int len) {
+  for (int j = 0; j < len; j++) stream.write((uint8_t)j);
+}
+
+// by default the copy buffer is used
+bool testDefault() {
+  RingBufferStream source(200), sink(200);
+  fill(source, 100);
+  StreamCopy copier(sink, source, 100);
+  bool ok = copier.copy() == 100 && copier.zeroCopyBytes() == 0;
+  if (!ok) Serial.println("Zero copy is active by default");
+  return ok;
+}
+
+// the source is read only once if it does not provide any data
+bool testSingleRead() {
+  EmptySource source;
+  RingBufferStream sink(200);
+  StreamCopy copier(sink, source, 100);
+  copier.setZeroCopy(true);
+  bool ok = copier.copy() == 0 && source.read_count == 1;
+  if (!ok) Serial.println("The source was read more than once");
+  return ok;
+}
+
+// the data of the source is written with the usual retries
+bool testRetry() {
+  RingBufferStream source(200);
+  fill(source, 100);
+  SlowSink sink;
+  StreamCopy copier(sink, source, 100);
+  copier.setZeroCopy(true);
+  bool ok = copier.copy() == 100 && sink.received == 100 && sink.is_valid &&
+            copier.zeroCopyBytes() == 100 && source.available() == 0;
+  if (!ok) Serial.println("The data was not written completely");
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = testDefault() && testSingleRead() && testRetry();
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
@@ -0,0 +1,42 @@
+// Traces a generator -> volume -> output chain and exports a Chrome trace
+#include "Arduino.h"
+#include "AudioTools.h"
+
+SineWaveGenerator<int16_t> sine_wave(32000);
+GeneratedSoundStream<int16_t> sound(sine_wave);
+NullStream out;
+TracingStream trace_out("output", out);
+VolumeStream volume(trace_out);
+TracingStream trace_volume("volume", volume);
+TracingStream trace_in("generator", sound, true);  // capture
+StreamCopy copier(trace_volume, trace_in, 1024);
+unsigned long end_time;
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+
+  auto cfg = sine_wave.defaultConfig();
+  cfg.channels = 2;
+  sine_wave.begin(cfg, N_B4);
+  sound.begin();
+  volume.begin(cfg);
+  volume.setVolume(0.5);
+  end_time = millis() + 2000;
+}
+
+void loop() {
+  copier.copy();
+  if (millis() > end_time) {
+    AudioTracer &tracer = AudioTracer::instance();
+    tracer.printStatistics(Serial);
+    for (int j = 0; j < tracer.size(); j++) {
+      if (tracer.processingTime(j).count() == 0) {
+        Serial.println("No data traced");
+        exit(1);
+      }
+    }
+    tracer.writeChromeTrace("trace.json");
+    stop();
+  }
+}
@@ -0,0 +1,61 @@
+// Checks that the VolumeStream also scales the samples of an incomplete
+// frame: we write an odd number of stereo samples with different volumes for
+// the left and the right channel
+#include "Arduino.h"
+#include "AudioTools.h"
+
+const int count = 19;  // odd number of samples: more than a SIMD vector
+
+/// Keeps the last written data
+class Collector : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    memcpy(buffer, data, len);
+    return len;
+  }
+  uint8_t buffer[count * sizeof(int32_t)];
+};
+
+template <typename T>
+bool test(int bits, bool useFloat) {
+  Collector out;
+  LinearVolumeControl linear;
+  VolumeStream volume(out);
+  volume.setVolumeControl(linear);
+  VolumeStreamConfig cfg;
+  cfg.channels = 2;
+  cfg.bits_per_sample = bits;
+  cfg.use_float = useFloat;
+  volume.begin(cfg);
+  volume.setVolume(0.5, 0);
+  volume.setVolume(0.25, 1);
+
+  T data[count];
+  for (int j = 0; j < count; j++) data[j] = 1000;
+  volume.write((const uint8_t *)data, sizeof(data));
+
+  T *result = (T *)out.buffer;
+  bool ok = true;
+  for (int j = 0; j < count; j++) {
+    float expected = j % 2 == 0 ? 500 : 250;
+    if (fabs(result[j] - expected) > 1) ok = false;
+  }
+  if (!ok) {
+    Serial.print("Invalid volume for ");
+    Serial.print(useFloat ? "float" : "int");
+    Serial.print(" with bits: ");
+    Serial.println(bits);
+  }
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = test<int16_t>(16, false) && test<int32_t>(32, false) &&
+            test<float>(32, true);
+  Serial.println(ok ? "OK" : "FAILED");
+  if (!ok) exit(1);
+}
+
+void loop() { stop(); }
@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include "fdk_log.h"
 #include "libAACenc/aacenc_lib.h"
+#ifndef ARDUINO
+#include <chrono>
+#endif
 
 namespace aac_fdk {
 
@@ -227,7 +230,9 @@ public:
 		out_buf.bufSizes = &out_size;
 		out_buf.bufElSizes = &out_elem_size;
 		
+		uint32_t start = timeUs();
 		err = aacEncEncode(handle, &in_buf, &out_buf, &in_args, &out_args);
+		encode_time_us = timeUs() - start;
 		if (err != AACENC_OK) {
 			// error
 			if (err != AACENC_ENCODE_EOF) {
@@ -241,6 +246,14 @@ public:
 		return in_size;
 	}
 
+	/// encodes the buffered samples at the end of the stream: returns false when everything has been flushed
+	bool flush(){
+		LOG_FDK(FDKDebug,__FUNCTION__);
+		if (!active) return false;
+		write(nullptr, 0);
+		return err == AACENC_OK;
+	}
+
 	/// closes the processing and release resources
 	void end(){
 		LOG_FDK(FDKDebug,__FUNCTION__);
@@ -264,6 +277,16 @@ public:
 		return aacEncoder_SetParam(handle, param, value);
 	}
 
+	/// Number of input samples (frameLength * channels) which are consumed per frame: available after begin()
+	int frameSamples() {
+		return active ? info.frameLength * info.inputChannels : 0;
+	}
+
+	/// Time in us which was needed by the encoder in the last write (w/o the output of the result)
+	uint32_t encodeTimeUs() {
+		return encode_time_us;
+	}
+
 	operator boolean(){
 		return active;
 	}
@@ -297,9 +320,10 @@ protected:
 	UINT openEncModules = 0; 
 	int openChannels = 0;
 	int sce=0, cpe=0; // for bitrate determination
+	uint32_t encode_time_us = 0;
 
 #ifdef ARDUINO
-	Print *out;
+	Print *out = nullptr;
 #endif
 
 	/// starts the processing
@@ -441,6 +465,15 @@ protected:
 		return 0;
 	}
 
+	/// current time in us
+	uint32_t timeUs() {
+#ifdef ARDUINO
+		return micros();
+#else
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
 	/// return the result PWM data
 	void provideResult(uint8_t *data, size_t len){
 		if (len>0){
@@ -18,7 +18,8 @@
 
 ESPNowStream now;
 AudioKitStream kit;
-EncodedAudioStream decoder(&kit, new AACDecoderHelix()); // decode and write to I2S - ESP Now is limited to 256 bytes
+AdaptiveResampleStream<int16_t> adaptive(kit, now); // compensates the clock drift to the sender
+EncodedAudioStream decoder(&adaptive, new AACDecoderHelix()); // decode and write to I2S - ESP Now is limited to 256 bytes
 StreamCopy copier(decoder, now); 
 const char *peers[] = {MAC_SENDER};
 
@@ -44,12 +45,22 @@ void setup() {
   kit.begin(config);
   Serial.println("AudioKit started");
 
+  auto adaptive_cfg = adaptive.defaultConfig();
+  adaptive_cfg.setAudioInfo(config);
+  adaptive.setNotifyAudioChange(kit);
+  adaptive.begin(adaptive_cfg);
+
   decoder.setNotifyAudioChange(now);
   decoder.begin();
 
   Serial.println("Receiver started...");
 }
 
+unsigned long lastReport = millis();
 void loop() { 
   copier.copy();
+  if (millis() - lastReport > 10 * 1000) {
+    lastReport = millis();
+    Serial.printf("drift: %.1f ppm, buffer: %d/%d\n", adaptive.driftPPM(), (int)adaptive.bufferLevel(), adaptive.bufferTarget());
+  }
 }
\ No newline at end of file
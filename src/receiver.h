@@ -23,7 +23,8 @@ const char* password = "87934hzft9oeu4389nv8o437893hf978";
 
 AudioKitStream kit;
 URLStream url(ssid,password, 16*1024);
-EncodedAudioStream dec(&kit, new AACDecoderHelix()); // Decoding stream
+AdaptiveResampleStream<int16_t> adaptive(kit, url); // compensates the clock drift to the sender
+EncodedAudioStream dec(&adaptive, new AACDecoderHelix()); // Decoding stream
 StreamCopy copier(dec, url, 16*1024); // copy url to decoder
 // ICYStream urlStream(ssid, password, 64*1024);
 // AudioSourceURL source(urlStream, urls, "audio/aac");
@@ -59,6 +60,11 @@ void setup(){
   kit.begin(config);
   Serial.println("AudioKit started");
 
+  auto adaptive_cfg = adaptive.defaultConfig();
+  adaptive_cfg.setAudioInfo(config);
+  adaptive.setNotifyAudioChange(kit);
+  adaptive.begin(adaptive_cfg);
+
   // player.setVolume(1.);
   // player.begin();
 
@@ -80,12 +86,18 @@ void setup(){
 }
 
 unsigned long lastAvailable = millis();
+unsigned long lastReport = millis();
 void loop(){
   copier.copy();
   if(url.available())
     lastAvailable = millis();
+  // the drift is compensated: we only restart if the connection is lost
   if(millis()-lastAvailable > 1*1000)
     ESP.restart();
+  if(millis()-lastReport > 10*1000){
+    lastReport = millis();
+    Serial.printf("drift: %.1f ppm, buffer: %d/%d\n", adaptive.driftPPM(), (int)adaptive.bufferLevel(), adaptive.bufferTarget());
+  }
   // pit.processActiolayer.copy();
   // kns();
 }